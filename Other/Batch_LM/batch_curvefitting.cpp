@@ -0,0 +1,64 @@
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include "batch_solver.h"
+#include "curve_models.h"
+#include "fixed_lm_solver.h"
+#include "data_generate.h"
+
+using namespace std;
+
+// fits many independent copies of the data.csv curve at once, problem i is the data scaled by exp(0.001 i),
+// i.e. the same curve with c shifted by 0.001 i
+int main(int argc, char** argv) {
+
+    std::string filePath = argc > 1 ? argv[1] : "..\\..\\..\\..\\..\\Other\\data\\data.csv"; // Update this to your actual file path
+    size_t problem_count = argc > 2 ? std::stoul(argv[2]) : 10000;
+
+    vector<double> x_data, y_data;
+    streamCsvColumns(filePath, 2, [&](const csv_chunk_reader& reader, size_t rows) {
+        for (size_t r = 0; r < rows; r++) {
+            x_data.push_back(reader.value(r, 0));
+            y_data.push_back(reader.value(r, 1));
+        }
+        });
+
+    batch_solver<exponential_quadratic_model> solver(problem_count, x_data.size());
+    batch_solver<exponential_quadratic_model>::Parameters initial_est(1, 5, 3);
+    for (size_t i = 0; i < problem_count; i++) {
+        double scale = std::exp(0.001 * static_cast<double>(i % 1000));
+        for (size_t j = 0; j < x_data.size(); j++)
+            solver.setPoint(i, j, x_data[j], scale * y_data[j]);
+        solver.setInitialEstimate(i, initial_est);
+    }
+
+    solver.setRobust(true, 10);
+
+    chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+    solver.solve();
+    chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+    chrono::duration<double> time_used = chrono::duration_cast<chrono::duration<double>>(t2 - t1);
+
+    std::cout << "problems: " << problem_count << " | converged: " << solver.getConvergedCount()
+        << " | solve time cost = " << time_used.count() << " seconds, " << problem_count / time_used.count() << " problems/s" << endl;
+    std::cout << "problem 0: estimated abc = " << solver.getParameters(0).transpose() << " | iterations: " << solver.getIterations(0) << endl;
+    std::cout << "problem 999: estimated abc = " << solver.getParameters(999 % problem_count).transpose() << endl;
+
+    //the same problem 0 through the fixed size solver, one problem at a time
+    fixed_lm_solver<exponential_quadratic_model> fixed_solver;
+    fixed_solver.setRobust(true, 10);
+    fixed_lm_solver<exponential_quadratic_model>::Parameters fixed_est;
+    fixed_lm_result fixed_result;
+    size_t repeats = 1000;
+    t1 = chrono::steady_clock::now();
+    for (size_t i = 0; i < repeats; i++) {
+        fixed_est = initial_est;
+        fixed_result = fixed_solver.solve(x_data.data(), y_data.data(), x_data.size(), fixed_est);
+    }
+    t2 = chrono::steady_clock::now();
+    time_used = chrono::duration_cast<chrono::duration<double>>(t2 - t1);
+    std::cout << "fixed size solver: estimated abc = " << fixed_est.transpose() << " | iterations: " << fixed_result.iterations
+        << " | " << 1e6 * time_used.count() / repeats << " us per solve" << endl;
+
+    return 0;
+}
@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "Optimization_general.h"
+
+// microbenchmarks of the optimizer kernels on synthetic curve fitting problems:
+// `size` independent exp(a x^2 + b x + c) curves with points_per_curve samples each, so the parameter count grows
+// linearly and the normal equations stay block diagonal (dense and sparse backends see the same problem)
+//
+// usage: optimizer_bench [--format=console|csv|json] [--out=file] [--filter=substring] [--min_time=seconds] [--max_size=n]
+
+struct bench_options {
+    std::string format = "console";
+    std::string out;
+    std::string filter;
+    double min_time = 0.2; // seconds spent in the measured repetitions of one benchmark
+    int max_size = 16;
+    int repetitions = 5;
+};
+
+struct bench_result {
+    std::string name;
+    int size = 0;
+    size_t iterations = 0; // calls per repetition
+    double min_ns = 0, median_ns = 0, mean_ns = 0;
+};
+
+// grants the benchmarks access to the private kernels of Optimization_General
+class optimizer_benchmark
+{
+public:
+    static const int points_per_curve = 25;
+
+    static void buildCurves(Optimization_General& optimizer, int curves, unsigned seed = 1) {
+        std::mt19937 rng(seed);
+        std::normal_distribution<double> noise(0.0, 0.05);
+        std::uniform_real_distribution<double> offset(-0.2, 0.2);
+
+        for (int k = 0; k < curves; k++) {
+            double a = 1 + offset(rng), b = 2 + offset(rng), c = 1 + offset(rng);
+            Eigen::VectorXd initial(3);
+            initial << a + 0.3, b - 0.3, c + 0.3;
+            optimizer.addVertex(k, initial, 0, false);
+
+            Eigen::VectorXd x(1), y(1);
+            for (int j = 0; j < points_per_curve; j++) {
+                int id = curves + k * points_per_curve + j;
+                x[0] = static_cast<double>(j) / points_per_curve;
+                y[0] = std::exp(a * x[0] * x[0] + b * x[0] + c) + noise(rng);
+                optimizer.addVertex(id, x, 1, true);
+                optimizer.addEdge(id, y, 1, k, id);
+            }
+        }
+        optimizer.initialize();
+    }
+
+    //layout, covariance, residuals and jacobian ready like at the start of a solve
+    static void linearize(Optimization_General& optimizer) {
+        if (!optimizer.layout_valid)
+            optimizer.buildLayout();
+        optimizer.prepareCovariance();
+        optimizer.estimates_valid = false;
+        optimizer.buildErrorVecndJacobian();
+    }
+
+    static void resetEstimates(Optimization_General& optimizer, int curves, const std::vector<Eigen::VectorXd>& initial) {
+        for (int k = 0; k < curves; k++)
+            optimizer.findVertex(k)->setParameters(initial[k]);
+    }
+
+    static std::vector<bench_result> run(const bench_options& options);
+};
+
+static bench_result measure(const bench_options& options, const std::string& name, int size, const std::function<void()>& body) {
+    using clock = std::chrono::steady_clock;
+    auto timeCalls = [&](size_t calls) {
+        clock::time_point start = clock::now();
+        for (size_t i = 0; i < calls; i++)
+            body();
+        return std::chrono::duration<double>(clock::now() - start).count();
+        };
+
+    //warm up, then grow the calls per repetition until one repetition takes its share of min_time
+    body();
+    double target = options.min_time / options.repetitions;
+    size_t iterations = 1;
+    double elapsed = timeCalls(iterations);
+    while (elapsed < target && iterations < 1000000000) {
+        double scale = elapsed > 0 ? std::min(10.0, 1.4 * target / elapsed) : 10.0;
+        iterations = std::max(iterations + 1, static_cast<size_t>(iterations * scale));
+        elapsed = timeCalls(iterations);
+    }
+
+    std::vector<double> per_call;
+    per_call.push_back(1e9 * elapsed / iterations);
+    for (int r = 1; r < options.repetitions; r++)
+        per_call.push_back(1e9 * timeCalls(iterations) / iterations);
+    std::sort(per_call.begin(), per_call.end());
+
+    bench_result result;
+    result.name = name;
+    result.size = size;
+    result.iterations = iterations;
+    result.min_ns = per_call.front();
+    result.median_ns = per_call[per_call.size() / 2];
+    double sum = 0;
+    for (double t : per_call)
+        sum += t;
+    result.mean_ns = sum / per_call.size();
+    return result;
+}
+
+std::vector<bench_result> optimizer_benchmark::run(const bench_options& options) {
+    std::vector<bench_result> results;
+    auto selected = [&](const std::string& name) {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+        };
+    auto add = [&](const std::string& name, int size, const std::function<void()>& body) {
+        if (!selected(name))
+            return;
+        results.push_back(measure(options, name, size, body));
+        if (options.format == "console")
+            std::cerr << "  " << name << "/" << size << " done\n";
+        };
+
+    //per edge kernels on a single curve
+    {
+        std::vector<int> edge_sizes = { 1 };
+        std::vector<int> vertex_sizes = { 3,1 };
+        Optimization_General optimizer(edge_sizes, vertex_sizes);
+        buildCurves(optimizer, 1);
+        linearize(optimizer);
+        general_edge* edge_ptr = optimizer.active_edges[0];
+        Eigen::VectorXd parameters = edge_ptr->getFirstVertex()->getParameters();
+        Eigen::VectorXd constants = edge_ptr->getSecondVertex()->getParameters();
+        Eigen::VectorXd y_est, error;
+        Eigen::MatrixXd J(1, 3);
+
+        add("computeError", 1, [&]() { optimizer.computeError(edge_ptr, y_est, error); });
+        add("computeJacobianVertex", 1, [&]() { optimizer.computeJacobianVertex(parameters, constants, J); });
+        optimizer.computeError(edge_ptr, y_est, error);
+        add("computeJacobianVertex/shared_y0", 1, [&]() { optimizer.computeJacobianVertex(parameters, constants, J, false, &y_est); });
+    }
+
+    for (int size = 1; size <= options.max_size; size *= 4) {
+        for (LinearSolverType solver : { LinearSolverType::DenseLDLT, LinearSolverType::SparseLDLT }) {
+            std::string backend = solver == LinearSolverType::DenseLDLT ? "dense" : "sparse";
+            std::vector<int> edge_sizes = { 1 };
+            std::vector<int> vertex_sizes = { 3,1 };
+            Optimization_General optimizer(edge_sizes, vertex_sizes);
+            optimizer.setLinearSolver(solver);
+            buildCurves(optimizer, size);
+            std::vector<Eigen::VectorXd> initial;
+            for (int k = 0; k < size; k++)
+                initial.push_back(optimizer.getVertexParameters(k));
+            linearize(optimizer);
+
+            //the linearization and assembly do not depend on the backend
+            if (solver == LinearSolverType::DenseLDLT) {
+                add("buildErrorVecndJacobian", size, [&]() {
+                    optimizer.estimates_valid = false;
+                    optimizer.buildErrorVecndJacobian();
+                    });
+                add("buildNormalEquations", size, [&]() { optimizer.buildNormalEquations(optimizer.A, optimizer.b); });
+            }
+
+            optimizer.buildNormalEquations(optimizer.A, optimizer.b);
+            Eigen::MatrixXd damped = optimizer.A + 1e-3 * Eigen::MatrixXd::Identity(optimizer.A.rows(), optimizer.A.cols());
+            Eigen::VectorXd x;
+            add("solveLinearSystem/" + backend, size, [&]() { optimizer.solveLinearSystem(damped, optimizer.b, x); });
+
+            add("optimizeWithLM/" + backend, size, [&]() {
+                resetEstimates(optimizer, size, initial);
+                optimizer.optimizeWithLM(100);
+                });
+        }
+    }
+    return results;
+}
+
+static void writeResults(std::ostream& stream, const bench_options& options, const std::vector<bench_result>& results) {
+    if (options.format == "csv") {
+        stream << "name,size,iterations,min_ns,median_ns,mean_ns\n";
+        for (const bench_result& r : results)
+            stream << r.name << "," << r.size << "," << r.iterations << "," << r.min_ns << "," << r.median_ns << "," << r.mean_ns << "\n";
+    }
+    else if (options.format == "json") {
+        //same shape as google benchmark's --benchmark_format=json so its compare tooling can read it
+        stream << "{\n  \"context\": {\"points_per_curve\": " << optimizer_benchmark::points_per_curve << ", \"repetitions\": " << options.repetitions << "},\n";
+        stream << "  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const bench_result& r = results[i];
+            stream << "    {\"name\": \"" << r.name << "/" << r.size << "\", \"iterations\": " << r.iterations
+                << ", \"real_time\": " << r.median_ns << ", \"cpu_time\": " << r.median_ns << ", \"min_time\": " << r.min_ns
+                << ", \"mean_time\": " << r.mean_ns << ", \"time_unit\": \"ns\"}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        stream << "  ]\n}\n";
+    }
+    else {
+        stream << "benchmark                                   size   iterations       min [ns]    median [ns]      mean [ns]\n";
+        for (const bench_result& r : results) {
+            stream << r.name << std::string(r.name.size() < 42 ? 42 - r.name.size() : 1, ' ')
+                << std::string(6 - std::min<size_t>(6, std::to_string(r.size).size()), ' ') << r.size
+                << std::string(13 - std::min<size_t>(13, std::to_string(r.iterations).size()), ' ') << r.iterations;
+            for (double t : { r.min_ns, r.median_ns, r.mean_ns }) {
+                std::string value = std::to_string(static_cast<long long>(std::llround(t)));
+                stream << std::string(15 - std::min<size_t>(15, value.size()), ' ') << value;
+            }
+            stream << "\n";
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    bench_options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&](const std::string& key) { return arg.substr(key.size()); };
+        if (arg.rfind("--format=", 0) == 0)
+            options.format = value("--format=");
+        else if (arg.rfind("--out=", 0) == 0)
+            options.out = value("--out=");
+        else if (arg.rfind("--filter=", 0) == 0)
+            options.filter = value("--filter=");
+        else if (arg.rfind("--min_time=", 0) == 0)
+            options.min_time = std::stod(value("--min_time="));
+        else if (arg.rfind("--max_size=", 0) == 0)
+            options.max_size = std::stoi(value("--max_size="));
+        else {
+            std::cerr << "unknown argument " << arg << "\n"
+                << "usage: optimizer_bench [--format=console|csv|json] [--out=file] [--filter=substring] [--min_time=seconds] [--max_size=n]\n";
+            return 1;
+        }
+    }
+
+    std::vector<bench_result> results = optimizer_benchmark::run(options);
+
+    if (options.out.empty()) {
+        writeResults(std::cout, options, results);
+    }
+    else {
+        std::ofstream file(options.out);
+        if (!file) {
+            std::cerr << "cannot open " << options.out << "\n";
+            return 1;
+        }
+        writeResults(file, options, results);
+    }
+    return 0;
+}
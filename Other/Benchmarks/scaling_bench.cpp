@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Bundle_Adjustment.h"
+#include "data_generate.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define SCALING_BENCH_FORK 1
+#elif defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+// end-to-end scaling runs: generated bundle adjustment problems over a matrix of sizes and thread counts,
+// each solved with optimizeWithLM and reported with wall time, the per phase split of the solve, peak rss and
+// iteration counts. rows are appended to a results csv and can be compared against a stored baseline csv,
+// the exit code is 1 when a case got slower, bigger or numerically different than the tolerance allows
+//
+// usage: scaling_bench [--sizes=25,50,100] [--threads=1,2,4] [--observations=n] [--iterations=n] [--rig=trajectory|ring]
+//                      [--repetitions=n] [--sparse] [--precision=double|single|mixed]
+//                      [--cg=jacobi|block_jacobi|schur_jacobi|cluster_jacobi] [--implicit] [--out=results.csv] [--baseline=baseline.csv] [--tolerance=0.1]
+
+struct scaling_options {
+    std::vector<int> sizes = { 25,50,100 }; // landmarks, the cameras grow with them
+    std::vector<int> threads = { 1,2,4 };
+    int observations_per_landmark = 4;
+    int iterations = 20;
+    int repetitions = 3; // solves per case, the fastest one is reported
+    RigType rig = RigType::Trajectory;
+    LinearSolverType solver = LinearSolverType::DenseLDLT;
+    SolverPrecision precision = SolverPrecision::Double;
+    PreconditionerType preconditioner = PreconditionerType::SchurJacobi;
+    std::string preconditioner_name; // --cg value, part of the case names
+    bool implicit_schur = false;
+    std::string out;
+    std::string baseline;
+    double tolerance = 0.1; // relative slack on time and memory before a case counts as a regression
+};
+
+// plain data so a forked child can hand it back through a pipe
+struct scaling_result {
+    int cameras = 0, landmarks = 0, observations = 0, threads = 0;
+    int iterations = 0, accepted = 0;
+    double wall_time = 0, setup_time = 0, residual_time = 0, jacobian_time = 0, assembly_time = 0;
+    double factorization_time = 0, solve_time = 0, step_time = 0;
+    double peak_rss_kb = 0;
+    double initial_cost = 0, final_cost = 0;
+    bool ok = false;
+};
+
+static const std::vector<std::string> csv_header = { "case","cameras","landmarks","observations","threads","iterations","accepted",
+    "wall_s","setup_s","residual_s","jacobian_s","assembly_s","factorization_s","solve_s","step_s","peak_rss_kb","initial_cost","final_cost" };
+
+static std::vector<double> csvValues(const scaling_result& r) {
+    return { double(r.cameras), double(r.landmarks), double(r.observations), double(r.threads), double(r.iterations), double(r.accepted),
+        r.wall_time, r.setup_time, r.residual_time, r.jacobian_time, r.assembly_time, r.factorization_time, r.solve_time, r.step_time,
+        r.peak_rss_kb, r.initial_cost, r.final_cost };
+}
+
+// peak resident set of this process in kilobytes, 0 where it cannot be queried
+static double peakRssKb() {
+#if defined(SCALING_BENCH_FORK)
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024.0; // bytes on macos
+#else
+    return static_cast<double>(usage.ru_maxrss);
+#endif
+#elif defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize / 1024.0;
+#else
+    return 0;
+#endif
+}
+
+static std::string caseName(const scaling_options& options, int size, int threads) {
+    std::string solver = options.solver == LinearSolverType::SparseLDLT ? "sparse" : options.solver == LinearSolverType::ConjugateGradient ? "cg_" + options.preconditioner_name + (options.implicit_schur ? "_implicit" : "") : "dense";
+    return std::string(options.rig == RigType::Ring ? "ring" : "trajectory") + "/" + solver
+        + (options.precision == SolverPrecision::Single ? "/single" : options.precision == SolverPrecision::Mixed ? "/mixed" : "")
+        + "/l" + std::to_string(size) + "/t" + std::to_string(threads);
+}
+
+static void fillResult(const ba_problem& problem, const solver_summary& summary, int threads, scaling_result& result) {
+    iteration_statistics totals = summary.totals();
+    result.cameras = problem.camera_count;
+    result.landmarks = problem.landmark_count;
+    result.observations = static_cast<int>(problem.observationCount());
+    result.threads = threads;
+    result.iterations = static_cast<int>(summary.iterations.size());
+    result.accepted = summary.acceptedSteps();
+    result.setup_time = summary.setup_time;
+    result.residual_time = totals.residual_time;
+    result.jacobian_time = totals.jacobian_time;
+    result.assembly_time = totals.assembly_time;
+    result.factorization_time = totals.factorization_time;
+    result.solve_time = totals.solve_time;
+    result.step_time = totals.step_time;
+    result.initial_cost = summary.initial_cost;
+    result.final_cost = summary.final_cost;
+    result.ok = true;
+}
+
+static scaling_result runCase(const scaling_options& options, int size, int threads) {
+    ba_generator_config config;
+    config.rig = options.rig;
+    config.landmarks = size;
+    config.cameras = std::max(4, size / 25 + 3);
+    config.observations_per_landmark = options.observations_per_landmark;
+    ba_problem problem = generateBundleAdjustment(config);
+
+    scaling_result result;
+    for (int repetition = 0; repetition < options.repetitions; repetition++) {
+        auto start = std::chrono::steady_clock::now();
+        bundle_adjustment optimizer(problem.intrinsics);
+        optimizer.setNumThreads(threads);
+        optimizer.setLinearSolver(options.solver);
+        optimizer.setPrecision(options.precision);
+        optimizer.setIterativeSolver(options.preconditioner);
+        optimizer.setImplicitSchur(options.implicit_schur);
+        optimizer.setEliminationGroups({ 1,0 });
+        optimizer.buildProblem(problem.arrays());
+        optimizer.optimizeWithLM(options.iterations);
+        double wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (result.ok && wall_time >= result.wall_time)
+            continue;
+        result.wall_time = wall_time;
+        fillResult(problem, optimizer.getSummary(), threads, result);
+    }
+    result.peak_rss_kb = peakRssKb();
+    return result;
+}
+
+// every case runs in its own child process where possible, so its peak rss is its own and a crash only loses that case
+static scaling_result runIsolated(const scaling_options& options, int size, int threads) {
+#if defined(SCALING_BENCH_FORK)
+    int channel[2];
+    if (pipe(channel) != 0)
+        return runCase(options, size, threads);
+    //the parent only runs a case itself when pipe() fails, otherwise no child inherits started pool threads
+    std::cout.flush();
+    pid_t child = fork();
+    if (child == 0) {
+        close(channel[0]);
+        scaling_result result = runCase(options, size, threads);
+        ssize_t written = write(channel[1], &result, sizeof(result));
+        close(channel[1]);
+        _exit(written == static_cast<ssize_t>(sizeof(result)) ? 0 : 1);
+    }
+    close(channel[1]);
+    scaling_result result;
+    size_t received = 0;
+    while (child > 0 && received < sizeof(result)) {
+        ssize_t n = read(channel[0], reinterpret_cast<char*>(&result) + received, sizeof(result) - received);
+        if (n <= 0)
+            break;
+        received += static_cast<size_t>(n);
+    }
+    close(channel[0]);
+    if (child > 0)
+        waitpid(child, nullptr, 0);
+    if (received != sizeof(result))
+        return scaling_result();
+    return result;
+#else
+    return runCase(options, size, threads);
+#endif
+}
+
+static std::vector<int> parseList(const std::string& list) {
+    std::vector<int> values;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        values.push_back(std::stoi(item));
+    return values;
+}
+
+// compares every case against the last baseline row of the same name, returns the number of regressions
+static int compareWithBaseline(const scaling_options& options, const std::vector<std::pair<std::string, scaling_result>>& results) {
+    std::vector<std::pair<std::string, std::vector<double>>> baseline = readResultsCsv(options.baseline);
+    const size_t wall_column = 6, rss_column = 14, iterations_column = 4, cost_column = 16; // indices into csvValues
+
+    std::cout << "\ncomparison with " << options.baseline << " (tolerance " << 100 * options.tolerance << "%)\n";
+    std::cout << std::left << std::setw(32) << "case" << std::right << std::setw(12) << "wall" << std::setw(12) << "peak rss"
+        << std::setw(12) << "iterations" << std::setw(14) << "final cost" << "  verdict\n";
+    int regressions = 0;
+    for (const auto& entry : results) {
+        const std::vector<double>* reference = nullptr;
+        for (const auto& row : baseline) {
+            if (row.first == entry.first && row.second.size() == csv_header.size() - 1)
+                reference = &row.second;
+        }
+        std::cout << std::left << std::setw(32) << entry.first << std::right;
+        if (!reference) {
+            std::cout << "  not in baseline\n";
+            continue;
+        }
+        if (!entry.second.ok) {
+            std::cout << "  failed\n";
+            regressions++;
+            continue;
+        }
+
+        std::vector<double> current = csvValues(entry.second);
+        auto ratio = [&](size_t column) { return (*reference)[column] > 0 ? current[column] / (*reference)[column] : 1.0; };
+        //the csv keeps 6 significant digits
+        double cost_change = std::abs(current[cost_column] - (*reference)[cost_column]) / std::max(1.0, std::abs((*reference)[cost_column]));
+        bool slower = ratio(wall_column) > 1 + options.tolerance;
+        bool bigger = ratio(rss_column) > 1 + options.tolerance;
+        bool different = cost_change > 1e-4 || current[iterations_column] != (*reference)[iterations_column];
+
+        std::cout << std::fixed << std::setprecision(2) << std::setw(11) << ratio(wall_column) << "x" << std::setw(11) << ratio(rss_column) << "x"
+            << std::setw(12) << static_cast<int>(current[iterations_column]) << std::scientific << std::setw(14) << cost_change << std::defaultfloat << std::setprecision(6) << "  ";
+        if (slower || bigger || different) {
+            regressions++;
+            std::cout << (slower ? "slower " : "") << (bigger ? "bigger " : "") << (different ? "numerics changed" : "") << "\n";
+        }
+        else {
+            std::cout << "ok\n";
+        }
+    }
+    return regressions;
+}
+
+int main(int argc, char** argv) {
+    scaling_options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&](const std::string& key) { return arg.substr(key.size()); };
+        if (arg.rfind("--sizes=", 0) == 0)
+            options.sizes = parseList(value("--sizes="));
+        else if (arg.rfind("--threads=", 0) == 0)
+            options.threads = parseList(value("--threads="));
+        else if (arg.rfind("--observations=", 0) == 0)
+            options.observations_per_landmark = std::stoi(value("--observations="));
+        else if (arg.rfind("--iterations=", 0) == 0)
+            options.iterations = std::stoi(value("--iterations="));
+        else if (arg.rfind("--rig=", 0) == 0)
+            options.rig = value("--rig=") == "ring" ? RigType::Ring : RigType::Trajectory;
+        else if (arg.rfind("--repetitions=", 0) == 0)
+            options.repetitions = std::max(1, std::stoi(value("--repetitions=")));
+        else if (arg == "--sparse")
+            options.solver = LinearSolverType::SparseLDLT;
+        else if (arg.rfind("--cg=", 0) == 0) {
+            options.solver = LinearSolverType::ConjugateGradient;
+            options.preconditioner_name = value("--cg=");
+            if (options.preconditioner_name == "jacobi")
+                options.preconditioner = PreconditionerType::Jacobi;
+            else if (options.preconditioner_name == "block_jacobi")
+                options.preconditioner = PreconditionerType::BlockJacobi;
+            else if (options.preconditioner_name == "cluster_jacobi")
+                options.preconditioner = PreconditionerType::ClusterJacobi;
+            else
+                options.preconditioner_name = "schur_jacobi";
+        }
+        else if (arg == "--implicit")
+            options.implicit_schur = true;
+        else if (arg.rfind("--precision=", 0) == 0)
+            options.precision = value("--precision=") == "single" ? SolverPrecision::Single : value("--precision=") == "mixed" ? SolverPrecision::Mixed : SolverPrecision::Double;
+        else if (arg.rfind("--out=", 0) == 0)
+            options.out = value("--out=");
+        else if (arg.rfind("--baseline=", 0) == 0)
+            options.baseline = value("--baseline=");
+        else if (arg.rfind("--tolerance=", 0) == 0)
+            options.tolerance = std::stod(value("--tolerance="));
+        else {
+            std::cerr << "unknown argument " << arg << "\n"
+                << "usage: scaling_bench [--sizes=25,50,100] [--threads=1,2,4] [--observations=n] [--iterations=n] [--rig=trajectory|ring]\n"
+                << "                     [--repetitions=n] [--sparse] [--precision=double|single|mixed]\n"
+                << "                     [--cg=jacobi|block_jacobi|schur_jacobi|cluster_jacobi] [--implicit] [--out=results.csv] [--baseline=baseline.csv] [--tolerance=0.1]\n";
+            return 1;
+        }
+    }
+
+    std::cout << std::left << std::setw(32) << "case" << std::right << std::setw(9) << "obs" << std::setw(7) << "iter" << std::setw(11) << "wall [s]"
+        << std::setw(11) << "setup" << std::setw(11) << "residual" << std::setw(11) << "jacobian" << std::setw(11) << "assembly"
+        << std::setw(11) << "factor" << std::setw(11) << "rss [MB]" << "\n";
+
+    std::vector<std::pair<std::string, scaling_result>> results;
+    for (int size : options.sizes) {
+        for (int threads : options.threads) {
+            std::string name = caseName(options, size, threads);
+            scaling_result result = runIsolated(options, size, threads);
+            results.emplace_back(name, result);
+
+            std::cout << std::left << std::setw(32) << name << std::right;
+            if (!result.ok) {
+                std::cout << "  failed\n";
+                continue;
+            }
+            std::cout << std::setw(9) << result.observations << std::setw(7) << result.iterations << std::fixed << std::setprecision(4);
+            for (double t : { result.wall_time, result.setup_time, result.residual_time, result.jacobian_time, result.assembly_time, result.factorization_time })
+                std::cout << std::setw(11) << t;
+            std::cout << std::setprecision(1) << std::setw(11) << result.peak_rss_kb / 1024 << std::defaultfloat << std::setprecision(6) << "\n";
+
+            if (!options.out.empty())
+                writeResultsCsv(options.out, csv_header, name, csvValues(result));
+        }
+    }
+
+    if (!options.baseline.empty())
+        return compareWithBaseline(options, results) > 0 ? 1 : 0;
+    return 0;
+}
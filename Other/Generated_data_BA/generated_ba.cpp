@@ -0,0 +1,122 @@
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include "Bundle_Adjustment.h"
+
+// bundle adjustment on a generated problem: synthesize a camera rig, landmarks and noisy observations,
+// solve from perturbed initial estimates and report the reprojection error and timings
+//
+// usage: Generated_data_BA [--rig=trajectory|ring] [--cameras=n] [--landmarks=n] [--observations=n]
+//                          [--noise=pixels] [--outliers=ratio] [--seed=n] [--iterations=n] [--dense] [--precision=double|single|mixed]
+//                          [--cg=jacobi|block_jacobi|schur_jacobi|cluster_jacobi] [--implicit]
+
+static PreconditionerType parsePreconditioner(const std::string& name) {
+    if (name == "jacobi")
+        return PreconditionerType::Jacobi;
+    if (name == "block_jacobi")
+        return PreconditionerType::BlockJacobi;
+    if (name == "cluster_jacobi")
+        return PreconditionerType::ClusterJacobi;
+    return PreconditionerType::SchurJacobi;
+}
+
+int main(int argc, char** argv) {
+    //small enough for the dense normal equations assembly, the generator itself scales to millions of observations
+    ba_generator_config config;
+    config.cameras = 8;
+    config.landmarks = 150;
+    int iterations = 50;
+    LinearSolverType solver = LinearSolverType::SparseLDLT;
+    SolverPrecision precision = SolverPrecision::Double;
+    PreconditionerType preconditioner = PreconditionerType::SchurJacobi;
+    bool implicit_schur = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&](const std::string& key) { return arg.substr(key.size()); };
+        if (arg.rfind("--rig=", 0) == 0)
+            config.rig = value("--rig=") == "ring" ? RigType::Ring : RigType::Trajectory;
+        else if (arg.rfind("--cameras=", 0) == 0)
+            config.cameras = std::stoi(value("--cameras="));
+        else if (arg.rfind("--landmarks=", 0) == 0)
+            config.landmarks = std::stoi(value("--landmarks="));
+        else if (arg.rfind("--observations=", 0) == 0)
+            config.observations_per_landmark = std::stoi(value("--observations="));
+        else if (arg.rfind("--noise=", 0) == 0)
+            config.pixel_noise = std::stod(value("--noise="));
+        else if (arg.rfind("--outliers=", 0) == 0)
+            config.outlier_ratio = std::stod(value("--outliers="));
+        else if (arg.rfind("--seed=", 0) == 0)
+            config.seed = static_cast<unsigned>(std::stoul(value("--seed=")));
+        else if (arg.rfind("--iterations=", 0) == 0)
+            iterations = std::stoi(value("--iterations="));
+        else if (arg == "--dense")
+            solver = LinearSolverType::DenseLDLT;
+        else if (arg.rfind("--cg=", 0) == 0) {
+            solver = LinearSolverType::ConjugateGradient;
+            preconditioner = parsePreconditioner(value("--cg="));
+        }
+        else if (arg == "--implicit")
+            implicit_schur = true;
+        else if (arg.rfind("--precision=", 0) == 0)
+            precision = value("--precision=") == "single" ? SolverPrecision::Single : value("--precision=") == "mixed" ? SolverPrecision::Mixed : SolverPrecision::Double;
+        else {
+            std::cerr << "unknown argument " << arg << "\n"
+                << "usage: Generated_data_BA [--rig=trajectory|ring] [--cameras=n] [--landmarks=n] [--observations=n]\n"
+                << "                         [--noise=pixels] [--outliers=ratio] [--seed=n] [--iterations=n] [--dense] [--precision=double|single|mixed]\n"
+                << "                         [--cg=jacobi|block_jacobi|schur_jacobi|cluster_jacobi] [--implicit]\n";
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    ba_problem problem = generateBundleAdjustment(config);
+    auto generated = std::chrono::high_resolution_clock::now();
+
+    std::cout << "cameras: " << problem.camera_count << " | landmarks: " << problem.landmark_count
+        << " | observations: " << problem.observationCount() << std::endl;
+    std::cout << "initial rms reprojection error: " << problem.rmsReprojectionError(problem.cameras.data(), problem.landmarks.data()) << " px" << std::endl;
+
+    bundle_adjustment optimizer(problem.intrinsics);
+    optimizer.setLinearSolver(solver);
+    optimizer.setPrecision(precision);
+    optimizer.setIterativeSolver(preconditioner);
+    optimizer.setImplicitSchur(implicit_schur);
+    optimizer.setEliminationGroups({ 1,0 }); // landmarks first, the schur complement order
+    if (config.outlier_ratio > 0)
+        optimizer.setRobust(true, 3);
+    optimizer.buildProblem(problem.arrays());
+    optimizer.optimizeWithLM(iterations);
+    auto solved = std::chrono::high_resolution_clock::now();
+
+    //read the estimates back in the generator's layout, vertex ids are the vertex indices
+    std::vector<double> cameras(problem.cameras.size()), landmarks(problem.landmarks.size());
+    for (int c = 0; c < problem.camera_count; c++)
+        Eigen::Map<Eigen::VectorXd>(&cameras[6 * c], 6) = optimizer.getVertexParameters(c);
+    for (int l = 0; l < problem.landmark_count; l++)
+        Eigen::Map<Eigen::VectorXd>(&landmarks[3 * l], 3) = optimizer.getVertexParameters(problem.camera_count + l);
+
+    double landmark_error = 0;
+    for (size_t k = 0; k < landmarks.size(); k++)
+        landmark_error += (landmarks[k] - problem.true_landmarks[k]) * (landmarks[k] - problem.true_landmarks[k]);
+
+    std::cout << "final rms reprojection error: " << problem.rmsReprojectionError(cameras.data(), landmarks.data()) << " px" << std::endl;
+    std::cout << "rms reprojection error at the truth: " << problem.rmsReprojectionError(problem.true_cameras.data(), problem.true_landmarks.data()) << " px" << std::endl;
+    std::cout << "rms landmark error: " << std::sqrt(landmark_error / problem.landmark_count) << std::endl;
+    std::cout << "generation time: " << std::chrono::duration<double>(generated - start).count() << " s | solve time: "
+        << std::chrono::duration<double>(solved - generated).count() << " s" << std::endl;
+    optimizer.getSummary().print(std::cout);
+    optimizer.getMemoryUsage().print(std::cout);
+
+    //uncertainty of the newest camera, the cameras are the last columns of the landmarks-first order
+    int last_camera = problem.camera_count - 1;
+    auto covariance_start = std::chrono::high_resolution_clock::now();
+    Eigen::MatrixXd covariance = optimizer.getMarginalCovariance(last_camera);
+    auto covariance_end = std::chrono::high_resolution_clock::now();
+    if (covariance.size() > 0) {
+        std::cout << "standard deviations of camera " << last_camera << " (rotation, translation): " << covariance.diagonal().cwiseSqrt().transpose()
+            << " | " << std::chrono::duration<double>(covariance_end - covariance_start).count() << " s" << std::endl;
+    }
+
+    return 0;
+}
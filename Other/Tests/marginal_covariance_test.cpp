@@ -0,0 +1,74 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Bundle_Adjustment.h"
+#include "ba_generate.h"
+
+// marginal covariance blocks of the sparse selected inverse against the dense back substitution, for every
+// fill-reducing ordering with the landmarks eliminated first
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::printf("FAILED: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+static const char* orderingName(OrderingType ordering) {
+    switch (ordering) {
+    case OrderingType::Natural: return "natural";
+    case OrderingType::AMD: return "amd";
+    case OrderingType::COLAMD: return "colamd";
+    case OrderingType::NestedDissection: return "nested dissection";
+    }
+    return "";
+}
+
+static void compareOrderings(RigType rig) {
+    ba_generator_config config;
+    config.rig = rig;
+    config.cameras = 8;
+    config.landmarks = 120;
+    ba_problem problem = generateBundleAdjustment(config);
+
+    bundle_adjustment optimizer(problem.intrinsics);
+    optimizer.setLinearSolver(LinearSolverType::DenseLDLT);
+    optimizer.buildProblem(problem.arrays());
+    optimizer.optimizeWithLM(20);
+
+    //free cameras and landmarks from both ends of the vertex range, the first cameras are fixed
+    std::vector<int> ids = { config.fixed_cameras, config.cameras - 1, config.cameras, config.cameras + config.landmarks / 2, config.cameras + config.landmarks - 1 };
+    std::vector<Eigen::MatrixXd> dense;
+    check(optimizer.computeMarginalCovariances(ids, dense), "dense marginal covariances");
+
+    for (OrderingType ordering : { OrderingType::AMD, OrderingType::COLAMD, OrderingType::NestedDissection }) {
+        std::string name = std::string(rig == RigType::Ring ? "ring, " : "trajectory, ") + orderingName(ordering);
+        optimizer.setLinearSolver(LinearSolverType::SparseLDLT);
+        optimizer.setOrdering(ordering);
+        optimizer.setEliminationGroups({ 1, 0 }); // cameras after the landmarks
+        std::vector<Eigen::MatrixXd> sparse;
+        check(optimizer.computeMarginalCovariances(ids, sparse), name + ": sparse marginal covariances");
+        if (sparse.size() != dense.size())
+            continue;
+        double difference = 0;
+        for (size_t i = 0; i < ids.size(); i++)
+            difference = std::max(difference, (sparse[i] - dense[i]).cwiseAbs().maxCoeff() / dense[i].cwiseAbs().maxCoeff());
+        std::printf("%s: largest relative difference %g\n", name.c_str(), difference);
+        check(difference <= 1e-9, name + ": sparse blocks agree with the dense ones");
+        optimizer.setLinearSolver(LinearSolverType::DenseLDLT);
+    }
+}
+
+int main(int argc, char** argv) {
+    compareOrderings(RigType::Trajectory);
+    compareOrderings(RigType::Ring);
+    if (failures > 0) {
+        std::printf("%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("marginal covariances agree\n");
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Bundle_Adjustment.h"
+#include "ba_generate.h"
+
+// snapshot round trip: a problem with a marginal prior is saved, loaded into a fresh optimizer and must hold and
+// solve to the same values. a truncated file must be rejected when it is opened
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::printf("FAILED: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+static bool sameMatrix(const Eigen::MatrixXd& a, const Eigen::MatrixXd& b, double tolerance) {
+    if (a.rows() != b.rows() || a.cols() != b.cols())
+        return false;
+    return a.size() == 0 || (a - b).cwiseAbs().maxCoeff() <= tolerance * std::max(1.0, a.cwiseAbs().maxCoeff());
+}
+
+static bool samePrior(const marginal_prior& a, const marginal_prior& b) {
+    if (a.getRows() != b.getRows() || a.getVertices().size() != b.getVertices().size())
+        return false;
+    for (size_t i = 0; i < a.getVertices().size(); i++) {
+        if (a.getVertices()[i]->getGlobalId() != b.getVertices()[i]->getGlobalId())
+            return false;
+    }
+    return sameMatrix(a.getJacobian(), b.getJacobian(), 0) && sameMatrix(a.getLinearizationPoint(), b.getLinearizationPoint(), 0)
+        && sameMatrix(a.getResidual0(), b.getResidual0(), 0);
+}
+
+static void roundTrip(const std::string& path) {
+    ba_generator_config config;
+    config.cameras = 6;
+    config.landmarks = 60;
+    ba_problem problem = generateBundleAdjustment(config);
+    int vertex_count = problem.camera_count + problem.landmark_count;
+
+    bundle_adjustment saved(problem.intrinsics);
+    saved.setLinearSolver(LinearSolverType::SparseLDLT);
+    saved.buildProblem(problem.arrays());
+    saved.optimizeWithLM(20);
+    //a marginalized camera leaves a prior on the vertices it shared edges with, the version 2 sections
+    saved.marginalizeVertices({ 3 });
+    check(saved.getPrior().getRows() > 0, "marginalizing a camera leaves a prior");
+    saved.saveSnapshot(path);
+
+    bundle_adjustment loaded(problem.intrinsics);
+    loaded.setLinearSolver(LinearSolverType::SparseLDLT);
+    loaded.loadSnapshot(path);
+    check(samePrior(saved.getPrior(), loaded.getPrior()), "the prior survives the round trip");
+    for (int id = 0; id < vertex_count; id++) {
+        if (id != 3)
+            check(sameMatrix(saved.getVertexParameters(id), loaded.getVertexParameters(id), 0), "parameters of vertex " + std::to_string(id));
+    }
+
+    saved.optimizeWithLM(5);
+    loaded.optimizeWithLM(5);
+    const solver_summary& a = saved.getSummary();
+    const solver_summary& b = loaded.getSummary();
+    check(a.initial_cost == b.initial_cost, "initial cost after loading");
+    check(std::abs(a.final_cost - b.final_cost) <= 1e-12 * a.final_cost, "final cost after loading");
+    check(a.iterations.size() == b.iterations.size(), "iterations after loading");
+    for (int id = 0; id < vertex_count; id++) {
+        if (id != 3)
+            check(sameMatrix(saved.getVertexParameters(id), loaded.getVertexParameters(id), 1e-12), "solved parameters of vertex " + std::to_string(id));
+    }
+}
+
+static void truncatedFile(const std::string& path, const std::string& truncated_path) {
+    std::vector<char> bytes;
+    {
+        std::ifstream file(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    check(bytes.size() > 8, "the snapshot was written");
+    {
+        std::ofstream file(truncated_path, std::ios::binary | std::ios::trunc);
+        file.write(bytes.data(), static_cast<std::streamsize>(bytes.size() - 8));
+    }
+
+    problem_snapshot snapshot;
+    bool rejected = false;
+    try {
+        snapshot.open(truncated_path);
+    }
+    catch (const std::runtime_error& e) {
+        rejected = true;
+        std::printf("truncated file rejected: %s\n", e.what());
+    }
+    check(rejected && !snapshot.isOpen(), "open() rejects a truncated file");
+}
+
+int main(int argc, char** argv) {
+    std::filesystem::path directory = std::filesystem::temp_directory_path();
+    std::string path = (directory / "ba_snapshot_test.snap").string();
+    std::string truncated_path = (directory / "ba_snapshot_test_truncated.snap").string();
+
+    roundTrip(path);
+    truncatedFile(path, truncated_path);
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(truncated_path);
+    if (failures > 0) {
+        std::printf("%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("snapshot round trip passed\n");
+    return 0;
+}
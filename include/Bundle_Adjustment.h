@@ -4,6 +4,24 @@
 #include <vector> // Include the <vector> header file
 #include <chrono>
 
-#include "Optimization_General.h"
-#include "data_generate.h"
+#include "Optimization_general.h"
+#include "ba_generate.h"
 
+// bundle adjustment on top of the general optimizer: vertex type 0 are cameras (angle-axis rotation, translation),
+// type 1 landmarks (3d points) and every edge is the 2d pixel of its landmark seen by its camera,
+// with the pinhole intrinsics fixed and shared by all cameras
+class bundle_adjustment : public Optimization_General
+{
+private:
+    ba_intrinsics intrinsics;
+
+protected:
+    void estimateY(std::vector<std::reference_wrapper<Eigen::VectorXd>>& input, Eigen::VectorXd& output) override;
+    void estimateYBatch(const Eigen::MatrixXd& first_parameters, const Eigen::MatrixXd& second_parameters, Eigen::MatrixXd& output) override;
+
+public:
+    explicit bundle_adjustment(const ba_intrinsics& intrinsics);
+
+    void setIntrinsics(const ba_intrinsics& intrinsics);
+    const ba_intrinsics& getIntrinsics();
+};
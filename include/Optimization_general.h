@@ -1,12 +1,33 @@
 #ifndef Optmization_General_H
 #define Optmization_General_H
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <functional>
+#include <cmath>
+#include <limits>
 //#include <opencv2/opencv.hpp>
 #include <Eigen/Core>
 #include <Eigen/Dense>
+#include <Eigen/Sparse>
 #include <vector>
+#include <string>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
  #include "Basic_functions.h"
+#include "problem_snapshot.h"
+#include "object_pool.h"
+#include "graph_adjacency.h"
+#include "vertex_ordering.h"
+#include "marginal_prior.h"
+#include "solver_statistics.h"
+#include "memory_usage.h"
+#include "iterative_solver.h"
+#include "logger.h"
+#include "parallel_for.h"
 
 class general_vertex;
 class general_edge;
@@ -14,8 +35,45 @@ class general_edge;
 #include "general_vertex.h"
 #include "general_edge.h"
 
+enum class LinearSolverType {
+    DenseLDLT,  // dense ldlt of the full normal equations
+    SparseLDLT, // simplicial ldlt, fill is controlled by the vertex ordering
+    ConjugateGradient // preconditioned conjugate gradients, see setIterativeSolver
+};
+
+enum class SolverPrecision {
+    Double, // everything in double
+    Single, // J^T W J assembled and factorized in float, the gradient and the residuals stay double
+    Mixed   // Single plus iterative refinement of every step against the normal equations in double
+};
+
+enum class DifferenceMethod {
+    Forward, // (y(x + h) - y(x)) / h, one extra model evaluation per parameter
+    Central, // (y(x + h) - y(x - h)) / 2h, two per parameter
+    Ridders  // richardson extrapolation of central differences over shrinking steps, 2 * ridders levels per parameter
+};
+
+// contiguous description of a whole problem, consumed by Optimization_General::buildProblem in one pass
+// vertices are indexed 0..n-1 type block after type block, edges refer to those indices
+struct problem_arrays {
+    std::vector<const double*> parameters; // per type: row-major vertex_counts[t] x vertex_sizes[t]
+    std::vector<size_t> vertex_counts;     // per type
+    const int* vertex_ids = nullptr;       // optional global ids, default is the vertex index
+    const uint8_t* vertex_fixed = nullptr; // optional fixedness per vertex, default is not fixed
+
+    size_t edge_count = 0;
+    const double* measurements = nullptr;  // row-major edge_count x edge_size
+    const double* w_sigmas = nullptr;      // optional per edge, default is w_sigma for every edge
+    double w_sigma = 1;
+    const int* edge_vertices = nullptr;    // (first, second) vertex index pairs, edge_count x 2
+    const int* edge_ids = nullptr;         // optional global ids, default is the edge index
+};
+
 class Optimization_General{
 
+    //the benchmarks in Other/Benchmarks time the private kernels directly
+    friend class optimizer_benchmark;
+
 private:
     size_t general_edge_count;
     size_t vertex_count;
@@ -38,38 +96,197 @@ private:
     std::vector<general_edge*> general_edges;
     std::map<int, general_edge*> temp_edges;
 
+    //added since the last initialize() / initialized since the last solve
+    std::vector<general_vertex*> pending_vertices;
+    std::vector<general_edge*> pending_edges;
+    std::vector<general_edge*> incremental_edges;
+
+    //id lookup for problems made by buildProblem, sorted by id
+    std::vector<std::pair<int, general_vertex*>> vertex_lookup;
+    std::vector<std::pair<int, general_edge*>> edge_lookup;
+
+    //topology over dense vertex indices, free vertices (type-major) first and fixed vertices after them
+    std::vector<general_vertex*> dense_vertices;
+    graph_adjacency adjacency;
+
+    //parameter layout: column of every free vertex, assigned along the elimination order
+    OrderingType ordering_type;
+    LinearSolverType linear_solver;
+    std::vector<int> type_elimination_groups; // group per vertex type, lower groups are eliminated first
+    std::vector<int> elimination_order;
+    std::vector<int> vertex_columns; // per dense index, -1 for fixed or inactive vertices
+    size_t parameter_count;
+    bool layout_valid;
+
+    //the part of the graph in the current linear system, everything for a full solve
+    std::vector<int> active_vertices; // dense indices in column order
+    std::vector<general_edge*> active_edges; // row order
+    int incremental_depth; // rings of neighbours re-optimized around new edges
+
+    //sliding window: information of marginalized vertices, appended after the edge rows of every linear system
+    marginal_prior prior;
+    int window_size; // free vertices of window_type kept by slideWindow(), 0 disables the window
+    int window_type;
+
+    //warm start: keep the damping, covariance, symbolic factorization and unchanged edge jacobians between solves on the same layout
+    bool warm_start;
+    double relinearize_threshold; // accumulated update norm of a vertex before its edges' jacobians are recomputed
+    double last_mu;
+    bool covariance_valid;
+    bool symbolic_valid;
+    Eigen::SparseMatrix<double> sparse_A; // fixed block pattern of the normal equations
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>, Eigen::Lower, Eigen::NaturalOrdering<int>> sparse_solver;
+
+    //single and mixed precision: the jacobian, the weights and the normal equations are held in float instead of double
+    SolverPrecision precision;
+    int refinement_steps; // mixed precision refinement steps per linear solve
+    Eigen::MatrixXf Jacobian_float;
+    Eigen::VectorXf weights_float; // float copy of weights
+    Eigen::MatrixXf A_float; // J^T W J, undamped
+    Eigen::SparseMatrix<float> sparse_A_float;
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<float>, Eigen::Lower, Eigen::NaturalOrdering<int>> sparse_solver_float;
+
+    //conjugate gradients: the preconditioner blocks and the reduced camera system are analysed with the symbolic factorization
+    PreconditionerType preconditioner_type;
+    int cg_max_iterations;
+    double cg_tolerance; // relative residual the steps are solved to
+    int cluster_size; // reduced vertices per cluster of ClusterJacobi
+    block_preconditioner preconditioner;
+    //reduced camera system: the lowest elimination group is eliminated, its vertices must not share edges with each other
+    bool schur_valid;
+    std::vector<int> schur_eliminated; // dense indices of the eliminated vertices
+    std::vector<int> schur_reduced; // dense indices of the reduced vertices, in reduced system order
+    std::vector<int> schur_offsets; // per dense index, row in the reduced system or -1
+    int schur_size;
+    bool implicit_schur; // apply the reduced system through the edge jacobian blocks instead of forming it
+    //set for the steps of optimize / levenbergMarquardt when the implicit schur solve applies. J and A are not built
+    //then, the solve works on the blocks and vectors below
+    bool implicit_solve;
+    //set the same way for double precision SparseLDLT: J and A are not built either, J^T W J goes from the edge blocks
+    //straight into the values of sparse_A
+    bool sparse_solve;
+    std::vector<Eigen::MatrixXd> edge_jacobians; // robustified J block of every active edge as 2 e + side, empty without a column
+    Eigen::VectorXd A_diagonal; // diagonal of J^T W J, for the initial damping and the damped diagonal of sparse_A
+    std::atomic<size_t> jacobian_evaluations; // vertex jacobians requested / actually differentiated in the last solve
+    std::atomic<size_t> jacobian_relinearizations;
+    std::atomic<size_t> model_evaluations; // estimateY points evaluated in the last solve
+
+    //estimate of every active edge at the current parameters, filled by buildErrorVector so the jacobian pass at the
+    //same point reuses it, both for the residual and as the base point of forward differences
+    Eigen::VectorXd edge_estimates;
+    bool estimates_valid; // cleared whenever the vertices move
+
+    //statistics of the last solve, iteration_stats is the record of the step in progress
+    solver_summary summary;
+    iteration_statistics iteration_stats;
+    iteration_callback callback;
+    void recordIteration();
+    void finishSummary(std::chrono::steady_clock::time_point solve_start);
+
+    //numeric differentiation of the edge jacobians, the step of parameter i is relative_step * max(|x_i|, 1)
+    DifferenceMethod difference_method;
+    double relative_step;
+    int ridders_levels;
+    bool batched_differences; // evaluate all perturbed points of a vertex with one estimateYBatch call
+
+    //threads evaluating edges in the residual and jacobian passes, every edge writes only its own rows
+    int num_threads;
+
+    //solves whose estimated peak memory is above the budget are refused before allocating, 0 is unlimited
+    size_t memory_budget;
+
     // std::unordered_map<int,int> general_vertices_map;//map to store the id of the vertex and its index in the vertices vector
     // std::unordered_map<int,int> general_edges_map;//map to store the id of the edge and its index in the edges vector
 
-    Eigen::VectorXd* errorVec;
-    Eigen::MatrixXd* Cov;
-    Eigen::MatrixXd* CovI;
-    Eigen::MatrixXd* Jacobian;
+    Eigen::VectorXd errorVec;
+    Eigen::VectorXd weights; // W = CovI, 1 / sigma^2 of every row. the covariance is diagonal by construction, only its diagonal is held
+    Eigen::MatrixXd Jacobian;
 
-    Eigen::VectorXd* deltaX;
-    Eigen::MatrixXd* A;
-    Eigen::VectorXd* b;
+    Eigen::VectorXd deltaX;
+    Eigen::MatrixXd A;
+    Eigen::VectorXd b;
 
+    //the optimizer owns every vertex and edge, freed together on reset or destruction
+    object_pool<general_vertex> vertex_pool;
+    object_pool<general_edge> edge_pool;
+
+protected:
     //function to estimate the measurements from the pose and landmark vertices, this function is passed to the optimization class
-    //last element of the vector should contain the reference to the output vector
-    void estimateY(std::vector<std::reference_wrapper<Eigen::VectorXd>>& input, Eigen::VectorXd& output);
-    void computeJacobianVertex(const Eigen::VectorXd& parameters, const Eigen::VectorXd& constants, const double step_size, Eigen::MatrixXd& J);
-    //compute the error between the estimated parameters and the actual measurements
-    void computeError(const Eigen::VectorXd& estimatedParameters1, const Eigen::VectorXd& estimatedParameters2, const Eigen::VectorXd& Measurements, Eigen::VectorXd& errorVec);
+    //last element of the vector should contain the reference to the output vector.
+    //the default is the exp(a x^2 + b x + c) curve, other models (e.g. bundle_adjustment) override both functions
+    virtual void estimateY(std::vector<std::reference_wrapper<Eigen::VectorXd>>& input, Eigen::VectorXd& output);
+    //estimateY for many points at once, column k of the parameter matrices is one evaluation and column k of output its y
+    virtual void estimateYBatch(const Eigen::MatrixXd& first_parameters, const Eigen::MatrixXd& second_parameters, Eigen::MatrixXd& output);
+
+private:
+    //y at every column of perturbed (parameters of the differentiated vertex) with the other vertex held at constants
+    void evaluatePerturbed(const Eigen::MatrixXd& perturbed, const Eigen::VectorXd& constants, bool second_vertex, Eigen::MatrixXd& Y);
+    //y0 is y at the unperturbed parameters if the caller already has it, forward differences then skip that evaluation
+    void computeJacobianVertex(const Eigen::VectorXd& parameters, const Eigen::VectorXd& constants, Eigen::MatrixXd& J, bool second_vertex = false, const Eigen::VectorXd* y0 = nullptr);
+    //compute the estimate of the edge at the current parameters and its error against the measurement
+    void computeError(general_edge* edge_ptr, Eigen::VectorXd& y_est, Eigen::VectorXd& errorVec);
     void buildJacobian();//take pose_vertices and landmark_vertices and build the jacobian
-    void buildErrorVector();//take pose_vertices and landmark_vertices and build the error vector
+    void buildErrorVector(Eigen::VectorXd& eVec);//take pose_vertices and landmark_vertices and build the error vector
     void buildErrorVecndJacobian();//take pose_vertices and landmark_vertices and build the error vector and jacobian
-    void buildCovarianceMatrix();//make the covariance matrix from w_sigma in the edges
+    void forEachEdgeChunk(const std::function<void(size_t, size_t)>& process);//process(begin, end) over chunks of the active edges on num_threads threads
+    void computeEdgeJacobian(general_edge* edge_ptr, bool second_vertex, Eigen::MatrixXd& J, const Eigen::VectorXd* y0 = nullptr);//jacobian of one vertex of the edge, cached on warm starts
+    void buildWeightVector(Eigen::VectorXd& weights);//diagonal of CovI straight from w_sigma in the edges
+    void prepareCovariance();//build the weights (weights_float in single and mixed precision) unless a warm start can keep them
     void updateEstimates(Eigen::VectorXd& deltaX);//update the pose and landmark vertices with the new estimates
     void revertEstimates();//revert the pose and landmark vertices to the previous estimates
     void RobustKernel(Eigen::VectorXd& estimateVec, Eigen::VectorXd& measurementVec, Eigen::VectorXd& Error);
 
+    general_vertex* findVertex(int id);
+    general_edge* findEdge(int id);
+    void printProblemSummary();
+    //verbose trace of the linearized system, the float copies in single and mixed precision
+    void traceLinearSystem(const Eigen::MatrixXd& A, const Eigen::VectorXd& b, bool with_jacobian);
+    bool holdsProblem();//staged or built vertices and edges exist
+    void buildAdjacency();
+    void appendDenseVertex(general_vertex* vertex_ptr);//next dense index and an isolated adjacency vertex
+    void buildLayout();
+    void buildIncrementalLayout();
+    void levenbergMarquardt(int iterations);
+    //A = J^T W J and b = -J^T W e from the current jacobian and error vector. in single and mixed precision A is left
+    //empty and A_float is assembled instead, the implicit schur solve only gets b and A_diagonal, the sparse solve the
+    //lower triangle in sparse_A as well
+    void buildNormalEquations(Eigen::MatrixXd& A, Eigen::VectorXd& b);
+    bool lowPrecision();//the normal equations are held in float: single or mixed precision with an ldlt solver
+    bool sparseSolveApplies();//double precision SparseLDLT, the normal equations are assembled into sparse_A
+    void solveLinearSystem(const Eigen::MatrixXd& A, const Eigen::VectorXd& b, Eigen::VectorXd& x);
+    void solveSparseSystem(double damping, const Eigen::VectorXd& b, Eigen::VectorXd& x);//sparse_A + damping I from the assembled values
+    void solveLinearSystemFloat(const Eigen::MatrixXf& A, const Eigen::VectorXd& b, Eigen::VectorXd& x);//float factorization, refined in double for mixed precision
+    void buildSparsePattern();
+    void analyzeIterativeSolve();//schur partition and preconditioner blocks for the current layout
+    void solveConjugateGradient(const Eigen::MatrixXd& A, const Eigen::VectorXd& b, Eigen::VectorXd& x);
+    //S = A_rr - A_re A_ee^-1 A_er and its right hand side, A_ee^-1 of every eliminated vertex for the back substitution
+    void buildReducedSystem(const Eigen::MatrixXd& A, const Eigen::VectorXd& b, Eigen::MatrixXd& S, Eigen::VectorXd& b_reduced,
+        std::vector<Eigen::MatrixXd>& eliminated_inverses);
+    //A_ll^-1 of every eliminated vertex, block(l) gives A_ll of dense index l
+    void invertEliminatedBlocks(const std::function<Eigen::MatrixXd(int)>& block, std::vector<Eigen::MatrixXd>& eliminated_inverses);
+    bool implicitSchurApplies();//implicit schur requested and an independent elimination group exists, analyses the layout if needed
+    //cg on S = A_rr - A_re A_ee^-1 A_er applied as sum_e J_er^T W_e (J_er x_r - J_el A_ll^-1 z_l) with z = A_er x_r, S is never formed.
+    //A = J^T diag(weights) J + diag(damping) is never formed either, every product runs over edge_jacobians and the prior
+    void solveImplicitSchur(const Eigen::VectorXd& weights, const Eigen::VectorXd& damping, const Eigen::VectorXd& b, Eigen::VectorXd& x);
+    void invalidateWarmStart();
+    size_t getResidualRows();
+    void appendPriorRows(Eigen::VectorXd* eVec, Eigen::MatrixXd* J, Eigen::MatrixXf* J_float = nullptr);
+    void eraseVertices(std::vector<char>& erased, const std::vector<int>& edge_indices);
+    //peak memory of a solve over a rows x columns system: what is held now plus the buffers the solve allocates
+    memory_usage estimateSolveMemory(size_t rows, size_t columns);
+    size_t countHessianEntries();//entries in the lower triangle of the block pattern over all free vertices
+    size_t countFactorEntries();//entries of the sparse factor with fill over the active vertices, block symbolic factorization in column order
+    void checkMemoryEstimate();//pre-flight log of the estimate after initialize() / buildProblem()
+    bool withinMemoryBudget();//false and an error when the solve over the current layout would exceed the budget
+    //takahashi recursion over the factor in sparse_solver: the inverse on the pattern of L for columns >= first_column
+    void selectedInverse(int first_column, std::vector<double>& inverse_values, Eigen::VectorXd& inverse_diagonal);
+
 
 public:
 
     Optimization_General();
     Optimization_General(std::vector<int> edge_sizes, std::vector<int> vertex_sizes);
-    ~Optimization_General();
+    virtual ~Optimization_General();
 
     void setVertexSize(int vertex_size);
     void setVertexSizes(std::vector<int> vertex_sizes);
@@ -79,8 +296,32 @@ public:
     double getDelta();
     void setEdgeSize(int edge_size);
     void setEdgeSizes(std::vector<int> edge_sizes);
+    //matrix and per edge dumps of this optimizer at trace level, independent of the logger's level
     void setVerbose(bool verbose);
 
+    void setOrdering(OrderingType ordering_type);
+    OrderingType getOrdering();
+    //elimination group per vertex type, e.g. {1, 0} eliminates type 1 (landmarks) before type 0 for schur style solves
+    void setEliminationGroups(std::vector<int> type_groups);
+    void setLinearSolver(LinearSolverType linear_solver);
+    LinearSolverType getLinearSolver();
+    //precision of the jacobian, the normal equations and their factorization, refinement_steps is the cap of double
+    //refinements per step in mixed mode. conjugate gradients always run in double
+    void setPrecision(SolverPrecision precision, int refinement_steps = 2);
+    SolverPrecision getPrecision();
+    //settings of LinearSolverType::ConjugateGradient. the schur preconditioners eliminate the lowest elimination group
+    //(setEliminationGroups) and fall back to BlockJacobi when there is none or its vertices share edges
+    void setIterativeSolver(PreconditionerType preconditioner, int max_iterations = 500, double tolerance = 1e-8, int cluster_size = 4);
+    PreconditionerType getPreconditioner();
+    //the schur preconditioners run cg on the reduced camera system without forming it: every product goes through the
+    //edge jacobian blocks and the inverted landmark blocks, only the preconditioner blocks of it are assembled
+    void setImplicitSchur(bool implicit_schur = true);
+    bool getImplicitSchur();
+    const std::vector<int>& getEliminationOrder();
+
+    //drop the whole problem and free every vertex, edge and work buffer, keeping the settings
+    void reset();
+
     void addVertex(int id, Eigen::VectorXd vertex_data, int vertex_type, bool isFixed = false);
     void removeVertex(int id);
     Eigen::VectorXd getVertexParameters(int id);
@@ -88,12 +329,77 @@ public:
     void addEdge(int id, Eigen::VectorXd measurement, double w_sigma, int first_vertex_id, int second_vertex_id);
     void removeEdge(int id);
     Eigen::VectorXd getEdgeMeasurement(int id);
+    //replace the measurement of an initialized edge, e.g. before a warm-started re-solve
+    void setEdgeMeasurement(int id, Eigen::VectorXd measurement);
+    void setEdgeMeasurement(int id, Eigen::VectorXd measurement, double w_sigma);
 
     void initialize();
 
+    //build and initialize the whole problem from contiguous arrays, skipping the addVertex/addEdge staging maps
+    void buildProblem(const problem_arrays& arrays);
+
+    const graph_adjacency& getAdjacency();
+
+    //binary snapshot of the initialized problem and its marginal prior, loading maps the file and builds the problem from its views
+    void saveSnapshot(const std::string& path);
+    void loadSnapshot(const problem_snapshot& snapshot);
+    void loadSnapshot(const std::string& path);
+
 
     void optimize(int iterations);
     void optimizeWithLM(int iterations);
 
+    //re-solve only the vertices touched by the edges added since the last solve and their neighbours up to the
+    //incremental depth, holding the rest of the graph fixed. vertices/edges not initialized yet are initialized first
+    void optimizeIncremental(int iterations);
+    void setIncrementalDepth(int depth);
+
+    //re-solves on an unchanged layout start from the last damping, covariance and symbolic factorization,
+    //and edges whose vertices moved less than relinearize_threshold keep their jacobians
+    void setWarmStart(bool warm_start = true, double relinearize_threshold = 1e-8);
+    bool getWarmStart();
+    //edge jacobians are re-differentiated only once the norms of the updates applied to one of its vertices
+    //since the last differentiation add up to more than the threshold, 0 re-differentiates every iteration
+    void setRelinearizeThreshold(double relinearize_threshold);
+    double getRelinearizeThreshold();
+
+    //relative_step 0 picks the usual step of the method: sqrt(eps) forward, cbrt(eps) central, 1e-3 for the first ridders step.
+    //batched evaluates all perturbed points of a vertex in one estimateYBatch call instead of one estimateY call each
+    void setNumericDifferentiation(DifferenceMethod method, double relative_step = 0, bool batched = false);
+    DifferenceMethod getDifferenceMethod();
+
+    //threads used for the residual and jacobian passes over the edges and the schur elimination over the eliminated
+    //vertices, the results do not depend on it
+    void setNumThreads(int num_threads);
+    int getNumThreads();
+
+    //bytes held right now by every internal structure, the per solve buffers (damped hessian, dense factor, product temporaries) are freed after a solve
+    memory_usage getMemoryUsage();
+    //estimated peak of a full solve with the current settings, available right after initialize() and before anything big is allocated.
+    //before the first solve builds the layout the sparse factor is counted without fill, a lower bound for that field
+    memory_usage estimateMemory();
+    //solves estimated above budget bytes log an error and return without touching the estimates, 0 disables the check
+    void setMemoryBudget(size_t budget);
+    size_t getMemoryBudget();
+
+    //remove the vertices and their edges from the problem, keeping their information as a dense prior on the
+    //remaining neighbours (schur complement at the current estimates). fixed vertices left without edges are dropped too
+    void marginalizeVertices(const std::vector<int>& ids);
+    //keep only the newest window_size free vertices of vertex_type, slideWindow() marginalizes the oldest ones
+    void setSlidingWindow(int window_size, int vertex_type = 0);
+    void slideWindow();
+    const marginal_prior& getPrior();
+
+    //marginal covariance blocks (J^T W J)^-1 of free vertices at the current estimates, one per id in order.
+    //the sparse solver recovers them by selective inversion of one factorization, only the entries of the factor
+    //pattern from the first requested column on are computed, so landmarks-first orderings make pose queries cheap
+    bool computeMarginalCovariances(const std::vector<int>& ids, std::vector<Eigen::MatrixXd>& covariances);
+    Eigen::MatrixXd getMarginalCovariance(int id);//empty when the covariance cannot be recovered
+
+    //called after every attempted step of optimize() / optimizeWithLM() with its timings and convergence numbers
+    void setIterationCallback(iteration_callback callback);
+    //statistics of the last solve, print() gives the time split and optionally a row per step
+    const solver_summary& getSummary();
+
 };
 #endif
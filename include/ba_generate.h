@@ -0,0 +1,275 @@
+#ifndef BA_GENERATE_H
+#define BA_GENERATE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <random>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include "Optimization_general.h"
+
+// synthetic bundle adjustment problems for scaling studies
+// cameras are 6 parameters (angle-axis rotation, translation) mapping world to camera: X_c = R X + t,
+// landmarks are 3d points and every observation is the pinhole projection of a landmark in one camera
+
+struct ba_intrinsics {
+    double focal = 500;
+    double cx = 320;
+    double cy = 240;
+    double width = 640;
+    double height = 480;
+};
+
+// X_c = R(angle_axis) X + t, rodrigues with a first order fallback near zero rotation
+inline void transformPoint(const double* camera, const double* point, double* camera_point) {
+    double theta2 = camera[0] * camera[0] + camera[1] * camera[1] + camera[2] * camera[2];
+    double w_cross_x[3] = { camera[1] * point[2] - camera[2] * point[1], camera[2] * point[0] - camera[0] * point[2], camera[0] * point[1] - camera[1] * point[0] };
+    if (theta2 > 1e-16) {
+        double theta = std::sqrt(theta2);
+        double cos_theta = std::cos(theta), sin_theta = std::sin(theta);
+        double w[3] = { camera[0] / theta, camera[1] / theta, camera[2] / theta };
+        double w_dot_x = w[0] * point[0] + w[1] * point[1] + w[2] * point[2];
+        for (int i = 0; i < 3; i++)
+            camera_point[i] = point[i] * cos_theta + w_cross_x[i] / theta * sin_theta + w[i] * w_dot_x * (1 - cos_theta);
+    }
+    else {
+        for (int i = 0; i < 3; i++)
+            camera_point[i] = point[i] + w_cross_x[i];
+    }
+    for (int i = 0; i < 3; i++)
+        camera_point[i] += camera[3 + i];
+}
+
+// pixel of a landmark, returns false behind the camera
+inline bool projectPoint(const double* camera, const double* point, const ba_intrinsics& intrinsics, double* pixel) {
+    double p[3];
+    transformPoint(camera, point, p);
+    if (p[2] <= 1e-9)
+        return false;
+    pixel[0] = intrinsics.focal * p[0] / p[2] + intrinsics.cx;
+    pixel[1] = intrinsics.focal * p[1] / p[2] + intrinsics.cy;
+    return true;
+}
+
+enum class RigType {
+    Trajectory, // cameras along a line looking sideways at a corridor of landmarks, banded camera-camera coupling
+    Ring        // cameras on a circle looking at a cloud of landmarks in the middle, every camera sees most landmarks
+};
+
+struct ba_generator_config {
+    RigType rig = RigType::Trajectory;
+    int cameras = 10;
+    int landmarks = 500;
+    int observations_per_landmark = 4; // graph density, cameras observing each landmark (fewer if not enough see it)
+    int fixed_cameras = 2;             // the first cameras are fixed at their true pose, two fix the gauge including scale
+    ba_intrinsics intrinsics;
+
+    double pixel_noise = 1.0;          // gaussian sigma of the observations in pixels, also the edge w_sigma
+    double outlier_ratio = 0.0;        // share of observations replaced by a uniform pixel in the image
+
+    double rotation_noise = 0.01;      // perturbation of the initial estimates, radians
+    double translation_noise = 0.05;
+    double landmark_noise = 0.1;
+
+    double camera_spacing = 0.5;       // trajectory: distance between consecutive cameras
+    double ring_radius = 10;           // ring: circle radius, landmarks within a third of it around the center
+    double min_depth = 4, max_depth = 12;
+    unsigned seed = 1;
+};
+
+// generated problem, row-major arrays ready for Optimization_General::buildProblem through arrays()
+struct ba_problem {
+    ba_intrinsics intrinsics;
+    int camera_count = 0;
+    int landmark_count = 0;
+
+    std::vector<double> cameras;        // initial estimates, 6 per camera
+    std::vector<double> landmarks;      // initial estimates, 3 per landmark
+    std::vector<double> true_cameras;
+    std::vector<double> true_landmarks;
+    std::vector<uint8_t> camera_fixed;  // per vertex: cameras then landmarks
+
+    std::vector<double> observations;   // 2 per observation
+    std::vector<double> sigmas;         // per observation
+    std::vector<int> edge_vertices;     // (camera, camera_count + landmark) per observation
+    std::vector<uint8_t> is_outlier;
+
+    size_t observationCount() const { return this->sigmas.size(); }
+
+    //views over this problem: vertex type 0 are the cameras, type 1 the landmarks, edges are the observations
+    problem_arrays arrays() const {
+        problem_arrays views;
+        views.parameters = { this->cameras.data(), this->landmarks.data() };
+        views.vertex_counts = { static_cast<size_t>(this->camera_count), static_cast<size_t>(this->landmark_count) };
+        views.vertex_fixed = this->camera_fixed.data();
+        views.edge_count = this->observationCount();
+        views.measurements = this->observations.data();
+        views.w_sigmas = this->sigmas.data();
+        views.edge_vertices = this->edge_vertices.data();
+        return views;
+    }
+
+    //root mean square reprojection error of the given estimates over the inlier observations
+    double rmsReprojectionError(const double* camera_parameters, const double* landmark_parameters) const {
+        double sum = 0;
+        size_t count = 0;
+        for (size_t e = 0; e < this->observationCount(); e++) {
+            if (this->is_outlier[e])
+                continue;
+            int camera = this->edge_vertices[2 * e];
+            int landmark = this->edge_vertices[2 * e + 1] - this->camera_count;
+            double pixel[2];
+            if (!projectPoint(camera_parameters + 6 * camera, landmark_parameters + 3 * landmark, this->intrinsics, pixel))
+                continue;
+            double du = pixel[0] - this->observations[2 * e], dv = pixel[1] - this->observations[2 * e + 1];
+            sum += du * du + dv * dv;
+            count++;
+        }
+        return count ? std::sqrt(sum / count) : 0.0;
+    }
+};
+
+inline ba_problem generateBundleAdjustment(const ba_generator_config& config) {
+    ba_problem problem;
+    problem.intrinsics = config.intrinsics;
+    problem.camera_count = config.cameras;
+    problem.landmark_count = config.landmarks;
+
+    std::mt19937_64 rng(config.seed);
+    std::normal_distribution<double> normal(0.0, 1.0);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    //true camera poses
+    problem.true_cameras.resize(6 * static_cast<size_t>(config.cameras));
+    std::vector<Eigen::Vector3d> centers(config.cameras);
+    for (int c = 0; c < config.cameras; c++) {
+        Eigen::Matrix3d R;
+        if (config.rig == RigType::Trajectory) {
+            //looking along +z with a little jitter, moving along +x
+            centers[c] = Eigen::Vector3d(c * config.camera_spacing, 0.1 * normal(rng), 0.1 * normal(rng));
+            R = Eigen::AngleAxisd(0.02 * normal(rng), Eigen::Vector3d::UnitY()).toRotationMatrix();
+        }
+        else {
+            double angle = 2 * std::numbers::pi * c / config.cameras;
+            centers[c] = Eigen::Vector3d(config.ring_radius * std::cos(angle), 0.5 * normal(rng), config.ring_radius * std::sin(angle));
+            //rows are the camera axes in world coordinates, z towards the center
+            Eigen::Vector3d z = -centers[c].normalized();
+            Eigen::Vector3d x = Eigen::Vector3d::UnitY().cross(z).normalized();
+            Eigen::Vector3d y = z.cross(x);
+            R.row(0) = x.transpose();
+            R.row(1) = y.transpose();
+            R.row(2) = z.transpose();
+        }
+        Eigen::AngleAxisd angle_axis(R);
+        Eigen::Vector3d w = angle_axis.angle() * angle_axis.axis();
+        Eigen::Vector3d t = -R * centers[c];
+        for (int i = 0; i < 3; i++) {
+            problem.true_cameras[6 * c + i] = w[i];
+            problem.true_cameras[6 * c + 3 + i] = t[i];
+        }
+    }
+
+    //landmarks and their observations, each landmark is placed in front of an anchor camera
+    size_t expected = static_cast<size_t>(config.landmarks) * config.observations_per_landmark;
+    problem.true_landmarks.resize(3 * static_cast<size_t>(config.landmarks));
+    problem.observations.reserve(2 * expected);
+    problem.sigmas.reserve(expected);
+    problem.edge_vertices.reserve(2 * expected);
+    problem.is_outlier.reserve(expected);
+
+    double half_width = 0.5 * config.intrinsics.width / config.intrinsics.focal;
+    double half_height = 0.5 * config.intrinsics.height / config.intrinsics.focal;
+    std::vector<int> candidates;
+    for (int l = 0; l < config.landmarks; l++) {
+        int anchor = static_cast<int>(uniform(rng) * config.cameras) % config.cameras;
+        double* point = &problem.true_landmarks[3 * static_cast<size_t>(l)];
+        if (config.rig == RigType::Trajectory) {
+            double depth = config.min_depth + uniform(rng) * (config.max_depth - config.min_depth);
+            Eigen::Vector3d local(depth * half_width * 0.8 * (2 * uniform(rng) - 1), depth * half_height * 0.8 * (2 * uniform(rng) - 1), depth);
+            //camera to world: X = R^T (X_c - t)
+            Eigen::Map<const Eigen::Vector3d> w(&problem.true_cameras[6 * anchor]);
+            Eigen::Matrix3d R = w.norm() > 0 ? Eigen::AngleAxisd(w.norm(), w.normalized()).toRotationMatrix() : Eigen::Matrix3d::Identity();
+            Eigen::Vector3d world = R.transpose() * (local - Eigen::Map<const Eigen::Vector3d>(&problem.true_cameras[6 * anchor + 3]));
+            for (int i = 0; i < 3; i++)
+                point[i] = world[i];
+        }
+        else {
+            double r = config.ring_radius / 3;
+            for (int i = 0; i < 3; i++)
+                point[i] = r * (2 * uniform(rng) - 1);
+        }
+
+        //observers: a window of cameras around the anchor on a trajectory, any camera on a ring
+        candidates.clear();
+        if (config.rig == RigType::Trajectory) {
+            int window = std::max(config.observations_per_landmark, 1);
+            for (int c = std::max(0, anchor - window); c <= std::min(config.cameras - 1, anchor + window); c++)
+                candidates.push_back(c);
+            std::shuffle(candidates.begin(), candidates.end(), rng);
+            //keep the anchor, it sees the landmark by construction
+            std::iter_swap(candidates.begin(), std::find(candidates.begin(), candidates.end(), anchor));
+        }
+        else {
+            //distinct random cameras, drawn instead of shuffling all of them so generation stays O(observations)
+            int wanted = std::min(2 * config.observations_per_landmark, config.cameras);
+            for (int attempt = 0; static_cast<int>(candidates.size()) < wanted && attempt < 8 * wanted; attempt++) {
+                int c = static_cast<int>(uniform(rng) * config.cameras) % config.cameras;
+                if (std::find(candidates.begin(), candidates.end(), c) == candidates.end())
+                    candidates.push_back(c);
+            }
+        }
+
+        int observed = 0;
+        for (size_t k = 0; k < candidates.size() && observed < config.observations_per_landmark; k++) {
+            int c = candidates[k];
+            double pixel[2];
+            if (!projectPoint(&problem.true_cameras[6 * c], point, config.intrinsics, pixel))
+                continue;
+            if (pixel[0] < 0 || pixel[0] >= config.intrinsics.width || pixel[1] < 0 || pixel[1] >= config.intrinsics.height)
+                continue;
+
+            bool outlier = uniform(rng) < config.outlier_ratio;
+            if (outlier) {
+                pixel[0] = uniform(rng) * config.intrinsics.width;
+                pixel[1] = uniform(rng) * config.intrinsics.height;
+            }
+            else {
+                pixel[0] += config.pixel_noise * normal(rng);
+                pixel[1] += config.pixel_noise * normal(rng);
+            }
+            problem.observations.push_back(pixel[0]);
+            problem.observations.push_back(pixel[1]);
+            problem.sigmas.push_back(config.pixel_noise > 0 ? config.pixel_noise : 1.0);
+            problem.edge_vertices.push_back(c);
+            problem.edge_vertices.push_back(config.cameras + l);
+            problem.is_outlier.push_back(outlier ? 1 : 0);
+            observed++;
+        }
+    }
+
+    //initial estimates: the truth with noise, the fixed cameras stay exact
+    problem.cameras = problem.true_cameras;
+    problem.landmarks = problem.true_landmarks;
+    problem.camera_fixed.assign(static_cast<size_t>(config.cameras) + config.landmarks, 0);
+    for (int c = 0; c < config.cameras; c++) {
+        if (c < config.fixed_cameras) {
+            problem.camera_fixed[c] = 1;
+            continue;
+        }
+        for (int i = 0; i < 3; i++) {
+            problem.cameras[6 * c + i] += config.rotation_noise * normal(rng);
+            problem.cameras[6 * c + 3 + i] += config.translation_noise * normal(rng);
+        }
+    }
+    for (double& value : problem.landmarks)
+        value += config.landmark_noise * normal(rng);
+
+    return problem;
+}
+
+#endif
@@ -0,0 +1,381 @@
+#ifndef BATCH_SOLVER_H
+#define BATCH_SOLVER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "lm_common.h"
+#include "parallel_for.h"
+
+enum class BatchStatus {
+    Running,       // not solved yet
+    Converged,     // largest gradient entry below the gradient tolerance
+    SmallStep,     // update norm below the step tolerance
+    MaxIterations,
+    Failed         // the damping blew up without finding a better point
+};
+
+// levenberg-marquardt over many independent problems of identical structure, run in lockstep
+// Model (see curve_models.h) gives parameter_count and a static evaluate(p, x)
+// every problem has point_count (x, y, w_sigma) samples. data and parameters are stored as structure of arrays,
+// element [k][problem], so every inner loop runs over consecutive problems (lanes) and vectorizes.
+// problems are split into chunks of lane_count lanes and the chunks are solved in parallel
+template <typename Model>
+class batch_solver
+{
+public:
+    static constexpr int parameter_count = Model::parameter_count;
+    using Parameters = Eigen::Matrix<double, parameter_count, 1>;
+
+private:
+    static constexpr int P = parameter_count;
+
+    size_t problem_count;
+    size_t point_count;
+    std::vector<double> xs;      // [point][problem]
+    std::vector<double> ys;      // [point][problem]
+    std::vector<double> weights; // [point][problem], 1 / w_sigma^2
+    std::vector<double> parameters; // [k][problem]
+
+    std::vector<BatchStatus> status;
+    std::vector<int> iterations;
+    std::vector<double> costs;
+
+    int max_iterations;
+    int num_threads;
+    size_t lane_count;
+    double gradient_tolerance;
+    double step_tolerance;
+    double step_size; // forward difference step of the numeric jacobian
+    bool bRobust;
+    double delta;
+
+    //normal equations of the lanes of one chunk, lower triangle of H only, element [k][lane]
+    struct linear_system {
+        std::vector<double> p;    // P x lanes
+        std::vector<double> H;    // P*P x lanes
+        std::vector<double> g;    // P x lanes, -J^T W r
+        std::vector<double> cost; // lanes, r^T W r
+
+        void resize(size_t lanes) {
+            p.assign(P * lanes, 0.0);
+            H.assign(P * P * lanes, 0.0);
+            g.assign(P * lanes, 0.0);
+            cost.assign(lanes, 0.0);
+        }
+    };
+
+    //state of one chunk. lanes that finish are compacted away, so lane l works on problem[l]
+    struct chunk_state {
+        size_t lanes;
+        std::vector<size_t> problem;
+        std::vector<double> xs, ys, weights; // [point][lane]
+        linear_system current, trial;
+        std::vector<double> mu, nu;
+        std::vector<char> running;
+    };
+
+    //accumulate H, g and the cost at system.p for every lane of the chunk
+    void linearize(const chunk_state& chunk, linear_system& system) const {
+        const size_t lanes = chunk.lanes;
+        std::fill(system.H.begin(), system.H.end(), 0.0);
+        std::fill(system.g.begin(), system.g.end(), 0.0);
+        std::fill(system.cost.begin(), system.cost.end(), 0.0);
+        const double h = this->step_size;
+        double* H = system.H.data();
+        double* g = system.g.data();
+        double* cost = system.cost.data();
+        const double* p_lanes = system.p.data();
+
+        for (size_t j = 0; j < this->point_count; j++) {
+            const double* x = chunk.xs.data() + j * lanes;
+            const double* y = chunk.ys.data() + j * lanes;
+            const double* w = chunk.weights.data() + j * lanes;
+
+            for (size_t l = 0; l < lanes; l++) {
+                double p[P], J[P];
+                for (int k = 0; k < P; k++)
+                    p[k] = p_lanes[k * lanes + l];
+                double r = linearizeSample<Model>(p, x[l], y[l], w[l], h, this->bRobust, this->delta, J);
+
+                for (int a = 0; a < P; a++) {
+                    g[a * lanes + l] -= w[l] * J[a] * r;
+                    for (int b = 0; b <= a; b++)
+                        H[(a * P + b) * lanes + l] += w[l] * J[a] * J[b];
+                }
+                cost[l] += w[l] * r * r;
+            }
+        }
+    }
+
+    //(H + mu I) dx = g by cholesky on every lane, ok[l] is cleared when the damped matrix is not positive definite
+    static void solveDamped(size_t lanes, const linear_system& system, const std::vector<double>& mu,
+        std::vector<double>& L, std::vector<double>& dx, std::vector<double>& s, std::vector<char>& ok) {
+        std::fill(ok.begin(), ok.begin() + lanes, 1);
+        for (int i = 0; i < P; i++) {
+            for (int j = 0; j <= i; j++) {
+                const double* H_ij = system.H.data() + (i * P + j) * lanes;
+                for (size_t l = 0; l < lanes; l++)
+                    s[l] = H_ij[l] + (i == j ? mu[l] : 0.0);
+                for (int k = 0; k < j; k++) {
+                    const double* L_ik = L.data() + (i * P + k) * lanes;
+                    const double* L_jk = L.data() + (j * P + k) * lanes;
+                    for (size_t l = 0; l < lanes; l++)
+                        s[l] -= L_ik[l] * L_jk[l];
+                }
+                double* L_ij = L.data() + (i * P + j) * lanes;
+                if (i == j) {
+                    for (size_t l = 0; l < lanes; l++) {
+                        ok[l] = ok[l] && s[l] > 0.0;
+                        L_ij[l] = std::sqrt(s[l] > 0.0 ? s[l] : 1.0);
+                    }
+                }
+                else {
+                    const double* L_jj = L.data() + (j * P + j) * lanes;
+                    for (size_t l = 0; l < lanes; l++)
+                        L_ij[l] = s[l] / L_jj[l];
+                }
+            }
+        }
+
+        //forward then backward substitution
+        for (int i = 0; i < P; i++) {
+            for (size_t l = 0; l < lanes; l++)
+                s[l] = system.g[i * lanes + l];
+            for (int k = 0; k < i; k++) {
+                for (size_t l = 0; l < lanes; l++)
+                    s[l] -= L[(i * P + k) * lanes + l] * dx[k * lanes + l];
+            }
+            for (size_t l = 0; l < lanes; l++)
+                dx[i * lanes + l] = s[l] / L[(i * P + i) * lanes + l];
+        }
+        for (int i = P - 1; i >= 0; i--) {
+            for (size_t l = 0; l < lanes; l++)
+                s[l] = dx[i * lanes + l];
+            for (int k = i + 1; k < P; k++) {
+                for (size_t l = 0; l < lanes; l++)
+                    s[l] -= L[(k * P + i) * lanes + l] * dx[k * lanes + l];
+            }
+            for (size_t l = 0; l < lanes; l++)
+                dx[i * lanes + l] = s[l] / L[(i * P + i) * lanes + l];
+        }
+    }
+
+    //write the results of a lane back to the problem arrays
+    void storeLane(const chunk_state& chunk, size_t l) {
+        size_t problem = chunk.problem[l];
+        for (int k = 0; k < P; k++)
+            this->parameters[k * this->problem_count + problem] = chunk.current.p[k * chunk.lanes + l];
+        this->costs[problem] = chunk.current.cost[l];
+    }
+
+    //drop the finished lanes, every [k][lane] array keeps its layout with the new lane count
+    static void compact(chunk_state& chunk, size_t point_count) {
+        const size_t lanes = chunk.lanes;
+        std::vector<size_t> keep;
+        for (size_t l = 0; l < lanes; l++) {
+            if (chunk.running[l])
+                keep.push_back(l);
+        }
+        const size_t kept = keep.size();
+        auto compactRows = [&](std::vector<double>& values, size_t rows) {
+            for (size_t row = 0; row < rows; row++) {
+                for (size_t i = 0; i < kept; i++)
+                    values[row * kept + i] = values[row * lanes + keep[i]];
+            }
+            values.resize(rows * kept);
+            };
+        compactRows(chunk.xs, point_count);
+        compactRows(chunk.ys, point_count);
+        compactRows(chunk.weights, point_count);
+        compactRows(chunk.current.p, P);
+        compactRows(chunk.current.H, P * P);
+        compactRows(chunk.current.g, P);
+        compactRows(chunk.current.cost, 1);
+        compactRows(chunk.mu, 1);
+        compactRows(chunk.nu, 1);
+        for (size_t i = 0; i < kept; i++)
+            chunk.problem[i] = chunk.problem[keep[i]];
+        chunk.problem.resize(kept);
+        chunk.running.assign(kept, 1);
+        chunk.trial.resize(kept);
+        chunk.lanes = kept;
+    }
+
+    void solveChunk(size_t begin, size_t lanes) {
+        chunk_state chunk;
+        chunk.lanes = lanes;
+        chunk.problem.resize(lanes);
+        for (size_t l = 0; l < lanes; l++)
+            chunk.problem[l] = begin + l;
+        chunk.xs.resize(this->point_count * lanes);
+        chunk.ys.resize(this->point_count * lanes);
+        chunk.weights.resize(this->point_count * lanes);
+        for (size_t j = 0; j < this->point_count; j++) {
+            std::copy_n(this->xs.data() + j * this->problem_count + begin, lanes, chunk.xs.data() + j * lanes);
+            std::copy_n(this->ys.data() + j * this->problem_count + begin, lanes, chunk.ys.data() + j * lanes);
+            std::copy_n(this->weights.data() + j * this->problem_count + begin, lanes, chunk.weights.data() + j * lanes);
+        }
+        chunk.current.resize(lanes);
+        chunk.trial.resize(lanes);
+        for (int k = 0; k < P; k++)
+            std::copy_n(this->parameters.data() + k * this->problem_count + begin, lanes, chunk.current.p.data() + k * lanes);
+        chunk.mu.assign(lanes, 0.0);
+        chunk.nu.assign(lanes, 2.0);
+        chunk.running.assign(lanes, 1);
+        std::vector<double> L(P * P * lanes), dx(P * lanes), s(lanes);
+        std::vector<char> ok(lanes);
+
+        linearize(chunk, chunk.current);
+        size_t running_count = 0;
+        for (size_t l = 0; l < lanes; l++) {
+            chunk.mu[l] = initialDamping<P>(chunk.current.H.data() + l, lanes);
+            this->iterations[begin + l] = 0;
+            if (maxGradient<P>(chunk.current.g.data() + l, lanes) < this->gradient_tolerance) {
+                chunk.running[l] = 0;
+                this->status[begin + l] = BatchStatus::Converged;
+            }
+            else {
+                running_count++;
+            }
+        }
+
+        for (int iteration = 0; iteration < this->max_iterations && running_count > 0; iteration++) {
+            //keep the lockstep loops dense once half of the lanes are done
+            if (running_count * 2 <= chunk.lanes) {
+                for (size_t l = 0; l < chunk.lanes; l++) {
+                    if (!chunk.running[l])
+                        storeLane(chunk, l);
+                }
+                compact(chunk, this->point_count);
+            }
+            const size_t n = chunk.lanes;
+            linear_system& current = chunk.current;
+            linear_system& trial = chunk.trial;
+            solveDamped(n, current, chunk.mu, L, dx, s, ok);
+
+            //trial point on every running lane, finished lanes stay where they are
+            for (size_t l = 0; l < n; l++) {
+                double step_norm = 0, p_norm = 0;
+                for (int k = 0; k < P; k++) {
+                    step_norm += dx[k * n + l] * dx[k * n + l];
+                    p_norm += current.p[k * n + l] * current.p[k * n + l];
+                }
+                if (chunk.running[l] && ok[l] && smallStep(step_norm, p_norm, this->step_tolerance)) {
+                    chunk.running[l] = 0;
+                    running_count--;
+                    this->status[chunk.problem[l]] = BatchStatus::SmallStep;
+                }
+                bool step = chunk.running[l] && ok[l];
+                for (int k = 0; k < P; k++)
+                    trial.p[k * n + l] = current.p[k * n + l] + (step ? dx[k * n + l] : 0.0);
+            }
+            linearize(chunk, trial);
+
+            for (size_t l = 0; l < n; l++) {
+                if (!chunk.running[l])
+                    continue;
+                size_t problem = chunk.problem[l];
+                this->iterations[problem]++;
+
+                double predicted = 0;
+                for (int k = 0; k < P; k++)
+                    predicted += dx[k * n + l] * (chunk.mu[l] * dx[k * n + l] + current.g[k * n + l]);
+                if (acceptStep(ok[l], current.cost[l], trial.cost[l], predicted, chunk.mu[l], chunk.nu[l])) {
+                    for (int k = 0; k < P; k++) {
+                        current.p[k * n + l] = trial.p[k * n + l];
+                        current.g[k * n + l] = trial.g[k * n + l];
+                    }
+                    for (int k = 0; k < P * P; k++)
+                        current.H[k * n + l] = trial.H[k * n + l];
+                    current.cost[l] = trial.cost[l];
+
+                    if (maxGradient<P>(current.g.data() + l, n) < this->gradient_tolerance) {
+                        chunk.running[l] = 0;
+                        running_count--;
+                        this->status[problem] = BatchStatus::Converged;
+                    }
+                }
+                else if (dampingFailed(chunk.mu[l])) {
+                    chunk.running[l] = 0;
+                    running_count--;
+                    this->status[problem] = BatchStatus::Failed;
+                }
+            }
+        }
+
+        for (size_t l = 0; l < chunk.lanes; l++) {
+            if (chunk.running[l])
+                this->status[chunk.problem[l]] = BatchStatus::MaxIterations;
+            storeLane(chunk, l);
+        }
+    }
+
+public:
+    batch_solver(size_t problem_count, size_t point_count)
+        : problem_count(problem_count), point_count(point_count),
+        xs(problem_count * point_count, 0.0), ys(problem_count * point_count, 0.0), weights(problem_count * point_count, 1.0),
+        parameters(P * problem_count, 0.0), status(problem_count, BatchStatus::Running), iterations(problem_count, 0),
+        costs(problem_count, 0.0), max_iterations(100), num_threads(hardwareThreads()), lane_count(256),
+        gradient_tolerance(1e-10), step_tolerance(1e-12), step_size(1e-6), bRobust(false), delta(1) {}
+
+    size_t getProblemCount() const { return this->problem_count; }
+    size_t getPointCount() const { return this->point_count; }
+
+    void setPoint(size_t problem, size_t point, double x, double y, double w_sigma = 1.0) {
+        size_t index = point * this->problem_count + problem;
+        this->xs[index] = x;
+        this->ys[index] = y;
+        this->weights[index] = 1.0 / (w_sigma * w_sigma);
+    }
+
+    void setInitialEstimate(size_t problem, const Parameters& estimate) {
+        for (int k = 0; k < P; k++)
+            this->parameters[k * this->problem_count + problem] = estimate[k];
+        this->status[problem] = BatchStatus::Running;
+    }
+
+    void setRobust(bool robust = true, double delta = 10) {
+        this->bRobust = robust;
+        this->delta = delta;
+    }
+    void setMaxIterations(int max_iterations) { this->max_iterations = max_iterations; }
+    void setNumThreads(int num_threads) { this->num_threads = num_threads; }
+    //problems solved together by one thread, a multiple of the simd width
+    void setLaneCount(size_t lane_count) { this->lane_count = std::max<size_t>(lane_count, 1); }
+    void setTolerances(double gradient_tolerance, double step_tolerance) {
+        this->gradient_tolerance = gradient_tolerance;
+        this->step_tolerance = step_tolerance;
+    }
+
+    void solve() {
+        size_t chunks = (this->problem_count + this->lane_count - 1) / this->lane_count;
+        parallelFor(chunks, this->num_threads, [this](size_t chunk) {
+            size_t begin = chunk * this->lane_count;
+            this->solveChunk(begin, std::min(this->lane_count, this->problem_count - begin));
+            });
+    }
+
+    Parameters getParameters(size_t problem) const {
+        Parameters estimate;
+        for (int k = 0; k < P; k++)
+            estimate[k] = this->parameters[k * this->problem_count + problem];
+        return estimate;
+    }
+
+    BatchStatus getStatus(size_t problem) const { return this->status[problem]; }
+    int getIterations(size_t problem) const { return this->iterations[problem]; }
+    //weighted sum of squared residuals at the returned parameters
+    double getCost(size_t problem) const { return this->costs[problem]; }
+
+    size_t getConvergedCount() const {
+        return std::count_if(this->status.begin(), this->status.end(),
+            [](BatchStatus s) { return s == BatchStatus::Converged || s == BatchStatus::SmallStep; });
+    }
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef CURVE_MODELS_H
+#define CURVE_MODELS_H
+
+#include <cmath>
+
+// closed form measurement models y = f(p, x) for the dense small-problem solvers
+// a model exposes the parameter count as a compile time constant and a static evaluate
+// that is cheap enough to be inlined into the solvers' inner loops
+
+// exp(a x^2 + b x + c), the curve of Main.cpp and my_curvefitting.cpp
+struct exponential_quadratic_model {
+    static constexpr int parameter_count = 3;
+
+    static double evaluate(const double* p, double x) {
+        return std::exp(p[0] * x * x + p[1] * x + p[2]);
+    }
+};
+
+// a x^2 + b x + c
+struct quadratic_model {
+    static constexpr int parameter_count = 3;
+
+    static double evaluate(const double* p, double x) {
+        return p[0] * x * x + p[1] * x + p[2];
+    }
+};
+
+#endif
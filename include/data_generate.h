@@ -8,6 +8,9 @@
 #include <vector>
 #include <utility> // For std::pair
 #include <iostream>
+#include <charconv>
+#include <cstring>
+#include <string_view>
 
 using StringPairVectors = std::pair<std::vector<std::string>, std::vector<std::string>>;
 
@@ -43,19 +46,191 @@ StringPairVectors readCsvColumns(const std::string& filePath) {
 }
 
 
+// streaming reader for large numeric csv files
+// rows are parsed straight into a preallocated row-major buffer of chunk_rows x column_count doubles,
+// so memory stays bounded by the chunk size no matter how long the file is
+class csv_chunk_reader {
+public:
+    csv_chunk_reader(const std::string& filePath, size_t column_count, size_t chunk_rows = 1 << 16, int weight_column = -1)
+        : file(filePath, std::ios::binary), column_count(column_count), chunk_rows(chunk_rows), weight_column(weight_column),
+        values(chunk_rows * column_count), buffer(1 << 20), buffer_begin(0), buffer_end(0), rows_in_chunk(0),
+        rows_read(0), rows_skipped(0), eof(false) {
+        if (!file.is_open()) {
+            std::cerr << "Error opening file: " << filePath << std::endl;
+            eof = true;
+        }
+        if (weight_column >= static_cast<int>(column_count)) {
+            std::cerr << "Weight column " << weight_column << " is outside the " << column_count << " parsed columns" << std::endl;
+            this->weight_column = -1;
+        }
+    }
+
+    bool isOpen() const { return file.is_open(); }
+
+    // parses up to chunk_rows rows into the buffer, returns the number of rows parsed (0 at the end of the file)
+    // rows that do not parse (headers, short rows) are skipped and counted
+    size_t readChunk() {
+        rows_in_chunk = 0;
+        std::string_view line;
+        while (rows_in_chunk < chunk_rows && nextLine(line)) {
+            if (parseLine(line, &values[rows_in_chunk * column_count]))
+                rows_in_chunk++;
+            else if (!line.empty())
+                rows_skipped++;
+        }
+        rows_read += rows_in_chunk;
+        return rows_in_chunk;
+    }
+
+    const double* data() const { return values.data(); }
+    double value(size_t row, size_t column) const { return values[row * column_count + column]; }
+    // weight of a row in the current chunk, 1 when there is no weight column
+    double weight(size_t row) const { return weight_column < 0 ? 1.0 : value(row, weight_column); }
+
+    size_t getColumnCount() const { return column_count; }
+    size_t getRowsInChunk() const { return rows_in_chunk; }
+    size_t getRowsRead() const { return rows_read; }
+    size_t getRowsSkipped() const { return rows_skipped; }
+
+private:
+    std::ifstream file;
+    size_t column_count;
+    size_t chunk_rows;
+    int weight_column;
+    std::vector<double> values;
+    std::vector<char> buffer;
+    size_t buffer_begin, buffer_end;
+    size_t rows_in_chunk;
+    size_t rows_read, rows_skipped;
+    bool eof;
+
+    // returns the next line as a view into the byte buffer, refilling it when a line crosses the end
+    bool nextLine(std::string_view& line) {
+        while (true) {
+            const char* begin = buffer.data() + buffer_begin;
+            const char* newline = static_cast<const char*>(std::memchr(begin, '\n', buffer_end - buffer_begin));
+            if (newline != nullptr) {
+                line = std::string_view(begin, newline - begin);
+                buffer_begin += line.size() + 1;
+                return true;
+            }
+            if (eof) {
+                if (buffer_begin == buffer_end) return false;
+                line = std::string_view(begin, buffer_end - buffer_begin);// last line without a newline
+                buffer_begin = buffer_end;
+                return true;
+            }
+            //move the partial line to the front and read more behind it
+            size_t remaining = buffer_end - buffer_begin;
+            std::memmove(buffer.data(), begin, remaining);
+            if (remaining == buffer.size())
+                buffer.resize(2 * buffer.size());// a single line longer than the buffer
+            file.read(buffer.data() + remaining, static_cast<std::streamsize>(buffer.size() - remaining));
+            buffer_begin = 0;
+            buffer_end = remaining + static_cast<size_t>(file.gcount());
+            eof = !file;
+        }
+    }
+
+    bool parseLine(std::string_view line, double* row) const {
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        const char* p = line.data();
+        const char* end = line.data() + line.size();
+        for (size_t c = 0; c < column_count; c++) {
+            while (p < end && (*p == ' ' || *p == '\t')) p++;
+            auto [next, ec] = std::from_chars(p, end, row[c]);
+            if (ec != std::errc()) return false;
+            p = next;
+            while (p < end && (*p == ' ' || *p == '\t')) p++;
+            if (c + 1 < column_count) {
+                if (p == end || *p != ',') return false;
+                p++;
+            }
+        }
+        return true;// extra columns are ignored
+    }
+};
+
+// reads filePath chunk by chunk and hands every chunk to process(reader, rows) so edges can be fed to the optimizer incrementally
+// returns the total number of rows parsed
+template <typename ChunkCallback>
+size_t streamCsvColumns(const std::string& filePath, size_t column_count, ChunkCallback process, size_t chunk_rows = 1 << 16, int weight_column = -1) {
+    csv_chunk_reader reader(filePath, column_count, chunk_rows, weight_column);
+    size_t rows;
+    while ((rows = reader.readChunk()) > 0) {
+        process(reader, rows);
+    }
+    if (reader.getRowsSkipped() > 0)
+        std::cerr << "Skipped " << reader.getRowsSkipped() << " unparsable rows in " << filePath << std::endl;
+    return reader.getRowsRead();
+}
+
+
 void writeResultsCsv(const std::string& filePath, const std::string& name = "Results", const std::vector<double>& results = {}) {
     std::ofstream file(filePath, std::ios::app);//make this only update the file
     if (!file.is_open()) {
         std::cerr << "Error opening file: " << filePath << std::endl;
         return;
     }
-    file << name << ",";
-    for (size_t i = 0; i < results.size() - 1; i++) {
-        file << results[i] << ",";
+    file << name;
+    for (size_t i = 0; i < results.size(); i++) {
+        file << "," << results[i];
     }
-    file << results[results.size() - 1] << std::endl;
+    file << std::endl;
     file.close();
 }
+
+// same as above, the header line is written first when the file is new or empty
+void writeResultsCsv(const std::string& filePath, const std::vector<std::string>& header, const std::string& name, const std::vector<double>& results) {
+    bool empty;
+    {
+        std::ifstream existing(filePath);
+        empty = !existing.is_open() || existing.peek() == std::ifstream::traits_type::eof();
+    }
+    if (empty && !header.empty()) {
+        std::ofstream file(filePath, std::ios::app);
+        if (!file.is_open()) {
+            std::cerr << "Error opening file: " << filePath << std::endl;
+            return;
+        }
+        for (size_t i = 0; i < header.size(); i++)
+            file << (i ? "," : "") << header[i];
+        file << std::endl;
+    }
+    writeResultsCsv(filePath, name, results);
+}
+
+// rows written by writeResultsCsv as (name, values), lines with a non numeric value such as the header are skipped
+std::vector<std::pair<std::string, std::vector<double>>> readResultsCsv(const std::string& filePath) {
+    std::vector<std::pair<std::string, std::vector<double>>> rows;
+    std::ifstream file(filePath);
+    if (!file.is_open()) {
+        std::cerr << "Error opening file: " << filePath << std::endl;
+        return rows;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        std::stringstream ss(line);
+        std::string name, value;
+        if (!std::getline(ss, name, ',') || name.empty())
+            continue;
+
+        std::vector<double> values;
+        bool numeric = true;
+        while (numeric && std::getline(ss, value, ',')) {
+            double number;
+            auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), number);
+            numeric = ec == std::errc() && end == value.data() + value.size();
+            values.push_back(number);
+        }
+        if (numeric)
+            rows.emplace_back(name, values);
+    }
+    return rows;
+}
 #endif // !Data_Generate_H
 
 
@@ -0,0 +1,200 @@
+#ifndef FIXED_LM_SOLVER_H
+#define FIXED_LM_SOLVER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+
+#include <Eigen/Core>
+
+#include "lm_common.h"
+
+// calls f(std::integral_constant<int, i>) for i = 0 .. N-1, fully unrolled at compile time
+template <typename Function, int... I>
+inline void staticFor(Function& f, std::integer_sequence<int, I...>) {
+    (f(std::integral_constant<int, I>()), ...);
+}
+
+template <int N, typename Function>
+inline void staticFor(Function&& f) {
+    staticFor(f, std::make_integer_sequence<int, N>());
+}
+
+// cholesky of a P x P symmetric matrix (lower triangle is read) and the solve A x = b, every loop unrolled
+// returns false when A is not positive definite
+template <int P>
+inline bool unrolledCholeskySolve(const double (&A)[P][P], const double (&b)[P], double (&x)[P]) {
+    double L[P][P] = {};
+    bool positive = true;
+    staticFor<P>([&](auto i_) {
+        constexpr int i = decltype(i_)::value;
+        staticFor<i + 1>([&](auto j_) {
+            constexpr int j = decltype(j_)::value;
+            double s = A[i][j];
+            staticFor<j>([&](auto k_) {
+                constexpr int k = decltype(k_)::value;
+                s -= L[i][k] * L[j][k];
+                });
+            if constexpr (i == j) {
+                positive = positive && s > 0.0;
+                L[i][i] = std::sqrt(s > 0.0 ? s : 1.0);
+            }
+            else {
+                L[i][j] = s / L[j][j];
+            }
+            });
+        });
+
+    double y[P];
+    staticFor<P>([&](auto i_) {
+        constexpr int i = decltype(i_)::value;
+        double s = b[i];
+        staticFor<i>([&](auto k_) {
+            constexpr int k = decltype(k_)::value;
+            s -= L[i][k] * y[k];
+            });
+        y[i] = s / L[i][i];
+        });
+    staticFor<P>([&](auto r_) {
+        constexpr int i = P - 1 - decltype(r_)::value;
+        double s = y[i];
+        staticFor<P - 1 - i>([&](auto k_) {
+            constexpr int k = i + 1 + decltype(k_)::value;
+            s -= L[k][i] * x[k];
+            });
+        x[i] = s / L[i][i];
+        });
+    return positive;
+}
+
+struct fixed_lm_result {
+    bool converged = false; // gradient or step below tolerance
+    int iterations = 0;
+    double initial_cost = 0;
+    double final_cost = 0;
+};
+
+// levenberg-marquardt for tiny dense problems whose parameter count is known at compile time
+// Model (see curve_models.h) gives parameter_count and a static evaluate(p, x). the normal equations live on the
+// stack, are accumulated in one tight loop over the samples and solved by an unrolled cholesky, nothing is allocated
+template <typename Model>
+class fixed_lm_solver
+{
+public:
+    static constexpr int parameter_count = Model::parameter_count;
+    using Parameters = Eigen::Matrix<double, parameter_count, 1>;
+
+private:
+    static constexpr int P = parameter_count;
+
+    int max_iterations;
+    double gradient_tolerance;
+    double step_tolerance;
+    double step_size; // forward difference step of the numeric jacobian
+    bool bRobust;
+    double delta;
+
+    struct normal_equations {
+        double H[P][P]; // lower triangle
+        double g[P];    // -J^T W r
+        double cost;    // r^T W r
+    };
+
+    void accumulate(const double (&p)[P], const double* x, const double* y, const double* w_sigma, size_t n, normal_equations& system) const {
+        for (int a = 0; a < P; a++) {
+            system.g[a] = 0;
+            for (int b = 0; b < P; b++)
+                system.H[a][b] = 0;
+        }
+        system.cost = 0;
+
+        double q[P];
+        std::copy(p, p + P, q);
+        for (size_t i = 0; i < n; i++) {
+            double w = w_sigma ? 1.0 / (w_sigma[i] * w_sigma[i]) : 1.0;
+            double J[P];
+            double r = linearizeSample<Model>(q, x[i], y[i], w, this->step_size, this->bRobust, this->delta, J);
+
+            staticFor<P>([&](auto a_) {
+                constexpr int a = decltype(a_)::value;
+                double wJ_a = w * J[a];
+                system.g[a] -= wJ_a * r;
+                staticFor<a + 1>([&](auto b_) {
+                    constexpr int b = decltype(b_)::value;
+                    system.H[a][b] += wJ_a * J[b];
+                    });
+                });
+            system.cost += w * r * r;
+        }
+    }
+
+public:
+    fixed_lm_solver() : max_iterations(100), gradient_tolerance(1e-10), step_tolerance(1e-12), step_size(1e-6), bRobust(false), delta(1) {}
+
+    void setMaxIterations(int max_iterations) { this->max_iterations = max_iterations; }
+    void setTolerances(double gradient_tolerance, double step_tolerance) {
+        this->gradient_tolerance = gradient_tolerance;
+        this->step_tolerance = step_tolerance;
+    }
+    void setRobust(bool robust = true, double delta = 10) {
+        this->bRobust = robust;
+        this->delta = delta;
+    }
+
+    //fit n samples (x[i], y[i]) with optional per sample sigmas, estimate holds the initial guess and receives the result
+    fixed_lm_result solve(const double* x, const double* y, size_t n, Parameters& estimate, const double* w_sigma = nullptr) const {
+        fixed_lm_result result;
+        double p[P], trial_p[P], dx[P];
+        for (int k = 0; k < P; k++)
+            p[k] = estimate[k];
+
+        normal_equations current, trial = {};
+        accumulate(p, x, y, w_sigma, n, current);
+        result.initial_cost = current.cost;
+
+        double mu = initialDamping<P>(&current.H[0][0], 1);
+        double nu = 2;
+        result.converged = maxGradient<P>(current.g, 1) < this->gradient_tolerance;
+
+        while (!result.converged && result.iterations < this->max_iterations) {
+            result.iterations++;
+            double damped[P][P];
+            for (int a = 0; a < P; a++) {
+                for (int b = 0; b <= a; b++)
+                    damped[a][b] = current.H[a][b] + (a == b ? mu : 0.0);
+            }
+            bool positive = unrolledCholeskySolve<P>(damped, current.g, dx);
+
+            double step_norm = 0, p_norm = 0, predicted = 0;
+            for (int k = 0; k < P; k++) {
+                step_norm += dx[k] * dx[k];
+                p_norm += p[k] * p[k];
+                predicted += dx[k] * (mu * dx[k] + current.g[k]);
+                trial_p[k] = p[k] + dx[k];
+            }
+            if (positive && smallStep(step_norm, p_norm, this->step_tolerance)) {
+                result.converged = true;
+                break;
+            }
+
+            if (positive)
+                accumulate(trial_p, x, y, w_sigma, n, trial);
+            if (acceptStep(positive, current.cost, trial.cost, predicted, mu, nu)) {
+                std::copy(trial_p, trial_p + P, p);
+                current = trial;
+                result.converged = maxGradient<P>(current.g, 1) < this->gradient_tolerance;
+            }
+            else if (dampingFailed(mu)) {
+                break;
+            }
+        }
+
+        result.final_cost = current.cost;
+        for (int k = 0; k < P; k++)
+            estimate[k] = p[k];
+        return result;
+    }
+};
+
+#endif
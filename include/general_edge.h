@@ -24,6 +24,11 @@ private:
     general_vertex* first_vertex_ptr;
     general_vertex* second_vertex_ptr;
 
+    //numeric jacobian per vertex slot (0 first, 1 second) and the travel of both vertices when it was computed
+    Eigen::MatrixXd jacobians[2];
+    double linearization_travel[2][2];
+    bool jacobian_cached[2] = { false, false };
+
 public:
 
 
@@ -52,11 +57,22 @@ public:
     //return w_sigma^2
     double getCovariance();
 
+    double getSigma();
+
+    //Jacobian cache
+    void cacheJacobian(int slot, const Eigen::MatrixXd& J);
+    //copies the cached jacobian into J when neither vertex travelled more than threshold since it was cached
+    bool getCachedJacobian(int slot, double threshold, Eigen::MatrixXd& J);
+    void clearJacobianCache();
+
     //Initialize
     void initialize(int id);
 
     bool getIsInitialized();
 
+    //size of the object plus its measurement and cached jacobians
+    size_t getMemoryBytes();
+
 };
 
 #endif
\ No newline at end of file
@@ -17,10 +17,11 @@ private:
     int vertex_type; // 0,1,2,3 ......
     Eigen::VectorXd parameters;
     Eigen::VectorXd previous_parameters;
+    double travel; // accumulated norm of every change to the parameters, an upper bound on the distance moved
+    double previous_travel;
     int id;
     int global_id;
-    std::map<int, general_edge*> attached_edges;
-    std::map<int, general_vertex*> attached_vertices;
+    int dense_index; // row in the optimizer's adjacency, free vertices first
     bool isInitialized = false;
     bool isFixed = false;
     int temp_id;
@@ -45,14 +46,16 @@ public:
 
     void revertParameters();
 
+    double getTravel();
+
     Eigen::VectorXd getParameters();
 
-    //Edges
+    //Edges - topology lives in the optimizer's graph_adjacency, attaching only initializes the vertex
     void addEdge(general_edge* edge, general_vertex* general_vertex_ptr);
 
-    const std::map<int, general_edge*> getAttachedEdges();
+    void setDenseIndex(int dense_index);
 
-    const std::map<int, general_vertex*> getAttachedVertices();
+    int getDenseIndex();
 
     //Fixedness
     void setFixed(bool isFixed);
@@ -64,6 +67,9 @@ public:
 
     void setId(int id);
 
+    //size of the object plus its parameter vectors
+    size_t getMemoryBytes();
+
 };
 
 
@@ -0,0 +1,66 @@
+#ifndef GRAPH_ADJACENCY_H
+#define GRAPH_ADJACENCY_H
+
+#include <cstddef>
+#include <vector>
+
+// compressed sparse row adjacency of the problem graph over dense vertex indices
+// built in one pass from the (first, second) vertex pairs of the edges; every topology query is a contiguous scan.
+// edges and vertices added later go into per-vertex slack, a full segment moves to the end of its array with twice the room
+class graph_adjacency
+{
+private:
+    size_t vertex_count;
+    size_t edge_count;
+
+    //incidence: for vertex v, edges incident_edges[offset .. offset + degree)
+    std::vector<int> incidence_offsets;
+    std::vector<int> degrees;
+    std::vector<int> incidence_capacity;
+    std::vector<int> incident_edges;
+
+    //unique neighbours without self loops, ascending, i.e. the block pattern of the hessian
+    std::vector<int> neighbor_offsets;
+    std::vector<int> neighbor_counts;
+    std::vector<int> neighbor_capacity;
+    std::vector<int> neighbors;
+
+    void reserveIncidence(int vertex, int degree);
+    void reserveNeighbors(int vertex, int count);
+    void insertNeighbor(int vertex, int neighbor);
+    void eraseNeighbor(int vertex, int neighbor);
+
+public:
+    graph_adjacency();
+
+    //edge_vertices holds edge_count (first, second) pairs
+    void build(size_t vertex_count, const std::vector<int>& edge_vertices);
+    void clear();
+
+    //appends an isolated vertex and returns its index
+    int addVertex();
+    //appends edge getEdgeCount() between two existing vertices
+    void addEdge(int first, int second);
+    //hands everything of vertex from to the isolated vertex to and renames from in the lists of its neighbours
+    //costs the lists of its neighbours, from is left isolated
+    void moveVertex(int from, int to);
+
+    size_t getVertexCount() const;
+    size_t getEdgeCount() const;
+
+    //Incidence
+    int getDegree(int vertex) const;
+    const int* getIncidentEdges(int vertex) const;
+
+    //Neighbours
+    int getNeighborCount(int vertex) const;
+    const int* getNeighbors(int vertex) const;
+
+    //number of non-zero blocks in the upper triangle of the hessian over vertices [0, free_count)
+    size_t getHessianBlockCount(int free_count) const;
+
+    //bytes held by the adjacency arrays
+    size_t getMemoryBytes() const;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef ITERATIVE_SOLVER_H
+#define ITERATIVE_SOLVER_H
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include <Eigen/Dense>
+
+// preconditioned conjugate gradients for the normal equations and the block preconditioners it runs with
+enum class PreconditionerType {
+    Jacobi,        // inverse diagonal of the normal equations
+    BlockJacobi,   // inverse vertex blocks of the normal equations
+    SchurJacobi,   // cg on the reduced camera system after eliminating the landmark blocks, inverse camera blocks of it
+    ClusterJacobi  // like SchurJacobi, inverse blocks of the reduced system over clusters of cameras seeing the same landmarks
+};
+
+//y = A x for the operator cg runs on, or z = M^-1 r for its preconditioner
+using linear_operator = std::function<void(const Eigen::VectorXd& x, Eigen::VectorXd& y)>;
+
+struct cg_summary {
+    int iterations = 0;
+    double relative_residual = 0; // |r| / |b| of the recurrence at the returned x
+    bool converged = false;
+};
+
+//solves A x = b for a symmetric positive definite A, starting from x if it has the size of b and from zero otherwise.
+//stops once |r| <= tolerance |b|, after max_iterations, or when A turns out not to be positive definite along a direction
+cg_summary conjugateGradient(const linear_operator& multiply, const linear_operator& precondition, const Eigen::VectorXd& b, Eigen::VectorXd& x,
+    int max_iterations, double tolerance);
+
+// block diagonal preconditioner: every block is a set of indices whose sub matrix is inverted densely
+class block_preconditioner
+{
+private:
+    std::vector<std::vector<int>> blocks;
+    std::vector<Eigen::MatrixXd> inverses;
+
+public:
+    void setBlocks(std::vector<std::vector<int>> blocks);
+    const std::vector<std::vector<int>>& getBlocks() const;
+    void clear();
+
+    //invert the blocks of A on num_threads threads. a block that is not positive definite falls back to its inverse
+    //diagonal and the result is false
+    bool compute(const Eigen::MatrixXd& A, int num_threads = 1);
+    //same with block k assembled by block(k), for operators that are never formed as a matrix. block is called
+    //concurrently for different k when num_threads > 1
+    bool compute(const std::function<Eigen::MatrixXd(size_t)>& block, int num_threads = 1);
+    void apply(const Eigen::VectorXd& r, Eigen::VectorXd& z) const;
+
+    size_t getMemoryBytes() const;
+};
+
+//groups the reduced vertices [0, count) into clusters of at most cluster_size by covisibility. observers[l] lists the
+//reduced vertices coupled through eliminated vertex l, each cluster grows from its lowest unassigned vertex by the
+//candidate sharing the most eliminated vertices with the cluster so far
+std::vector<std::vector<int>> visibilityClusters(int count, const std::vector<std::vector<int>>& observers, int cluster_size);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef LM_COMMON_H
+#define LM_COMMON_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+// the levenberg-marquardt pieces of the dense small-problem solvers (batch_solver, fixed_lm_solver)
+// the solvers differ only in where H, g and the parameters live, so everything here reads and writes through a
+// stride: element k of problem l is at [k * stride] from the problem's first element (stride 1 for a single problem,
+// the lane count for structure of arrays)
+
+// residual and forward difference jacobian row of one sample at p, both scaled by the huber weight of the residual.
+// the sample adds w J^T J to H, -w J^T r to g and w r^2 to the cost. p is perturbed in place and restored
+template <typename Model>
+inline double linearizeSample(double* p, double x, double y, double w, double step_size, bool robust, double delta, double* J) {
+    constexpr int P = Model::parameter_count;
+    //residual = estimate - measurement, like Optimization_General::computeError
+    double r = Model::evaluate(p, x) - y;
+    for (int k = 0; k < P; k++) {
+        double saved = p[k];
+        p[k] += step_size;
+        J[k] = (Model::evaluate(p, x) - y - r) / step_size;
+        p[k] = saved;
+    }
+
+    //same rule as robustifyError
+    double e2 = r * r * w;
+    double robust_weight = (!robust || e2 <= delta) ? 1.0 : delta / std::sqrt(e2);
+    for (int k = 0; k < P; k++)
+        J[k] *= robust_weight;
+    return r * robust_weight;
+}
+
+// mu of the first step, relative to the largest diagonal entry of H (P x P, row-major with the stride)
+template <int P>
+inline double initialDamping(const double* H, size_t stride) {
+    double h_max = 0;
+    for (int k = 0; k < P; k++)
+        h_max = std::max(h_max, H[(k * P + k) * stride]);
+    return 1e-6 * h_max;
+}
+
+template <int P>
+inline double maxGradient(const double* g, size_t stride) {
+    double g_max = 0;
+    for (int k = 0; k < P; k++)
+        g_max = std::max(g_max, std::abs(g[k * stride]));
+    return g_max;
+}
+
+// the step is small relative to the parameters, from the squared norms of both
+inline bool smallStep(double step_norm2, double parameter_norm2, double step_tolerance) {
+    return std::sqrt(step_norm2) <= step_tolerance * (std::sqrt(parameter_norm2) + step_tolerance);
+}
+
+// gain ratio test of a trial step and the damping update, predicted = dx^T (mu dx + g). solved is false when the damped
+// system had no cholesky factor. an accepted step gets the nielsen update of mu, a rejected one multiplies it by nu.
+// rho == 0 is accepted like in Optimization_General, clipped huber residuals leave the cost flat
+inline bool acceptStep(bool solved, double current_cost, double trial_cost, double predicted, double& mu, double& nu) {
+    double rho = (current_cost - trial_cost) / predicted;
+    if (solved && predicted > 0 && std::isfinite(trial_cost) && rho >= 0) {
+        mu *= std::max(1.0 / 3, 1 - std::pow(2 * rho - 1, 3));
+        nu = 2;
+        return true;
+    }
+    mu *= nu;
+    nu *= 2;
+    return false;
+}
+
+// rejections drove the damping out of range, no better point will be found
+inline bool dampingFailed(double mu) {
+    return !std::isfinite(mu) || mu > 1e32;
+}
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+enum class LogLevel {
+    Trace,   // matrices, per edge values, every vertex's parameters
+    Debug,   // one line per attempted step
+    Info,    // one line per solve / initialize / marginalization
+    Warning, // bad ids and calls in the wrong order
+    Error,
+    Off
+};
+
+// statements below this level are compiled out, e.g. -DBA_COMPILED_LOG_LEVEL=3 keeps only warnings and errors
+#ifndef BA_COMPILED_LOG_LEVEL
+#define BA_COMPILED_LOG_LEVEL 0
+#endif
+
+const char* logLevelName(LogLevel level);
+
+// destination of formatted log lines
+class log_sink
+{
+public:
+    virtual ~log_sink() {}
+    virtual void write(LogLevel level, const std::string& message) = 0;
+    virtual void flush() {}
+};
+
+// writes every line straight to a stream, warnings and errors are prefixed with their level
+class stream_sink : public log_sink
+{
+private:
+    std::ostream& stream;
+    std::mutex mutex;
+
+public:
+    explicit stream_sink(std::ostream& stream);
+    void write(LogLevel level, const std::string& message) override;
+    void flush() override;
+};
+
+// queues lines and hands them to another sink on a background thread, so the caller never blocks on i/o
+class async_sink : public log_sink
+{
+private:
+    std::shared_ptr<log_sink> target;
+    std::deque<std::pair<LogLevel, std::string>> queue;
+    std::mutex mutex;
+    std::condition_variable queue_changed;
+    bool stopping;
+    bool writing;
+    std::thread worker;
+
+    void run();
+
+public:
+    explicit async_sink(std::shared_ptr<log_sink> target);
+    ~async_sink() override; // drains the queue before returning
+    void write(LogLevel level, const std::string& message) override;
+    void flush() override;  // waits until every queued line reached the target
+};
+
+// process wide logger, lines below the runtime level are dropped before anything is formatted.
+// the default level is Warning and the default sink a stream_sink on std::cout
+class logger
+{
+private:
+    std::atomic<int> level;
+    std::shared_ptr<log_sink> sink;
+    std::mutex sink_mutex;
+
+    logger();
+
+public:
+    static logger& instance();
+
+    void setLevel(LogLevel level);
+    LogLevel getLevel() const;
+    bool enabled(LogLevel level) const {
+        return static_cast<int>(level) >= this->level.load(std::memory_order_relaxed);
+    }
+
+    void setSink(std::shared_ptr<log_sink> sink);
+    void write(LogLevel level, const std::string& message);
+    void flush();
+};
+
+// true if a statement at level would be written, constant false below the compiled level
+#define BA_LOG_ENABLED(level) (static_cast<int>(level) >= BA_COMPILED_LOG_LEVEL && logger::instance().enabled(level))
+
+// message is a stream expression, e.g. LOG_INFO("cost: " << cost), only evaluated when the level is enabled
+#define BA_LOG(level, message) \
+    do { \
+        if constexpr (static_cast<int>(level) >= BA_COMPILED_LOG_LEVEL) { \
+            if (logger::instance().enabled(level)) { \
+                std::ostringstream ba_log_stream; \
+                ba_log_stream << message; \
+                logger::instance().write(level, ba_log_stream.str()); \
+            } \
+        } \
+    } while (0)
+
+// written whatever the runtime level, for output one object was asked for (Optimization_General::setVerbose), still
+// compiled out below the compiled level
+#define BA_LOG_UNFILTERED(level, message) \
+    do { \
+        if constexpr (static_cast<int>(level) >= BA_COMPILED_LOG_LEVEL) { \
+            std::ostringstream ba_log_stream; \
+            ba_log_stream << message; \
+            logger::instance().write(level, ba_log_stream.str()); \
+        } \
+    } while (0)
+
+#define LOG_TRACE(message) BA_LOG(LogLevel::Trace, message)
+#define LOG_DEBUG(message) BA_LOG(LogLevel::Debug, message)
+#define LOG_INFO(message) BA_LOG(LogLevel::Info, message)
+#define LOG_WARNING(message) BA_LOG(LogLevel::Warning, message)
+#define LOG_ERROR(message) BA_LOG(LogLevel::Error, message)
+
+#endif
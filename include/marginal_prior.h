@@ -0,0 +1,47 @@
+#ifndef MARGINAL_PRIOR_H
+#define MARGINAL_PRIOR_H
+
+#include <Eigen/Core>
+#include <Eigen/Dense>
+#include <vector>
+
+class general_vertex;
+
+// dense gaussian prior left on the kept vertices when other vertices are marginalized out
+// stored in square root form so it joins the least squares system as extra rows:
+// r(x) = r0 + J (x - x0) over the concatenated parameters of the prior's vertices
+class marginal_prior
+{
+private:
+    std::vector<general_vertex*> vertices;
+    std::vector<int> offsets; // column of every vertex inside J
+    Eigen::VectorXd linearization_point;
+    Eigen::MatrixXd jacobian;
+    Eigen::VectorXd residual0;
+
+public:
+    marginal_prior();
+
+    //information form H dx = b at the current estimates of the vertices, b = -J^T r like the optimizer's normal equations
+    void build(const std::vector<general_vertex*>& vertices, const Eigen::MatrixXd& H, const Eigen::VectorXd& b);
+    //a prior saved earlier, e.g. by a snapshot. the offsets follow the parameter sizes of the vertices
+    void assign(const std::vector<general_vertex*>& vertices, const Eigen::VectorXd& linearization_point, const Eigen::MatrixXd& jacobian,
+        const Eigen::VectorXd& residual0);
+    void clear();
+    bool isEmpty() const;
+
+    int getRows() const;
+    const std::vector<general_vertex*>& getVertices() const;
+    int getVertexOffset(int i) const;
+    const Eigen::MatrixXd& getJacobian() const;
+    const Eigen::VectorXd& getLinearizationPoint() const;
+    const Eigen::VectorXd& getResidual0() const;
+
+    //residual at the current estimates of the vertices
+    void computeResidual(Eigen::VectorXd& residual) const;
+
+    //bytes held by the prior's vectors and matrices
+    size_t getMemoryBytes() const;
+};
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef MEMORY_USAGE_H
+#define MEMORY_USAGE_H
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+#include <Eigen/Core>
+
+// bytes held by the optimizer, one field per group of structures
+struct memory_usage {
+    size_t parameters = 0;    // vertex objects and their parameter vectors
+    size_t edges = 0;         // edge objects, measurements and cached jacobians
+    size_t graph = 0;         // adjacency, id lookups, staging and layout vectors
+    size_t jacobian = 0;
+    size_t covariance = 0;    // the weight vector, diagonal of CovI
+    size_t hessian = 0;       // A, its damped copy and the sparse pattern
+    size_t factorization = 0; // dense ldlt or the sparse factor
+    size_t workspace = 0;     // error vectors, edge estimates, b, steps, product temporaries and the marginal prior
+
+    size_t total() const;
+    //one line per field in MB, the largest first
+    void print(std::ostream& stream) const;
+};
+
+template <typename Derived>
+size_t matrixBytes(const Eigen::PlainObjectBase<Derived>& matrix) {
+    return static_cast<size_t>(matrix.size()) * sizeof(typename Derived::Scalar);
+}
+
+template <typename T>
+size_t vectorBytes(const std::vector<T>& vector) {
+    return vector.capacity() * sizeof(T);
+}
+
+#endif
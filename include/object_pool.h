@@ -0,0 +1,100 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// slab allocator for graph objects
+// objects are constructed in place inside large slabs, so their addresses stay stable and
+// neighbouring objects sit next to each other in memory. everything is destroyed in one shot by clear(),
+// single objects handed back with release() are destroyed and their slot is reused by the next create()
+template <typename T>
+class object_pool
+{
+private:
+    struct slab {
+        T* data;
+        size_t capacity;
+        size_t used;
+    };
+
+    std::vector<slab> slabs;
+    std::vector<T*> free_slots;
+    size_t slab_size;
+    size_t object_count;
+    std::allocator<T> allocator;
+
+    void addSlab(size_t capacity) {
+        this->slabs.push_back({ this->allocator.allocate(capacity), capacity, 0 });
+    }
+
+public:
+    explicit object_pool(size_t slab_size = 1024) : slab_size(slab_size), object_count(0) {}
+    ~object_pool() { this->clear(); }
+
+    object_pool(const object_pool&) = delete;
+    object_pool& operator=(const object_pool&) = delete;
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        if (!this->free_slots.empty()) {
+            T* object = ::new (static_cast<void*>(this->free_slots.back())) T(std::forward<Args>(args)...);
+            this->free_slots.pop_back();
+            this->object_count++;
+            return object;
+        }
+
+        if (this->slabs.empty() || this->slabs.back().used == this->slabs.back().capacity)
+            this->addSlab(this->slab_size);
+
+        slab& current = this->slabs.back();
+        T* object = ::new (static_cast<void*>(current.data + current.used)) T(std::forward<Args>(args)...);
+        current.used++;
+        this->object_count++;
+        return object;
+    }
+
+    //make sure the next count objects are placed contiguously in a single slab
+    void reserve(size_t count) {
+        if (this->slabs.empty() || this->slabs.back().capacity - this->slabs.back().used < count)
+            this->addSlab(count > this->slab_size ? count : this->slab_size);
+    }
+
+    //destroy a single object, its slot is reused by a later create()
+    void release(T* object) {
+        object->~T();
+        this->free_slots.push_back(object);
+        this->object_count--;
+    }
+
+    //destroy every live object and release all slabs
+    void clear() {
+        std::less<T*> before;
+        std::sort(this->free_slots.begin(), this->free_slots.end(), before);
+        for (slab& s : this->slabs) {
+            for (size_t i = 0; i < s.used; i++) {
+                if (!std::binary_search(this->free_slots.begin(), this->free_slots.end(), s.data + i, before))
+                    s.data[i].~T();
+            }
+            this->allocator.deallocate(s.data, s.capacity);
+        }
+        this->slabs.clear();
+        this->free_slots.clear();
+        this->object_count = 0;
+    }
+
+    size_t size() const { return this->object_count; }
+
+    size_t capacity() const {
+        size_t total = 0;
+        for (const slab& s : this->slabs)
+            total += s.capacity;
+        return total;
+    }
+};
+
+#endif
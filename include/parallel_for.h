@@ -0,0 +1,133 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+inline int hardwareThreads() {
+    unsigned int threads = std::thread::hardware_concurrency();
+    return threads == 0 ? 1 : static_cast<int>(threads);
+}
+
+// persistent worker threads behind parallelFor, started on first use and grown to the largest request
+// one task runs at a time, calls from other threads wait for it. a forked child must not use a pool its parent started
+class thread_pool
+{
+private:
+    std::mutex mutex;
+    std::mutex run_mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::vector<std::thread> workers;
+    const std::function<void()>* task = nullptr;
+    size_t waiting = 0; // helpers still to pick up the current task
+    size_t running = 0; // helpers inside the current task
+    bool stopping = false;
+
+    void workerLoop() {
+        insideTask() = true;
+        std::unique_lock<std::mutex> lock(this->mutex);
+        while (true) {
+            this->wake.wait(lock, [this]() { return this->stopping || this->waiting > 0; });
+            if (this->stopping)
+                return;
+            this->waiting--;
+            this->running++;
+            const std::function<void()>* current = this->task;
+            lock.unlock();
+            (*current)();
+            lock.lock();
+            if (--this->running == 0 && this->waiting == 0)
+                this->done.notify_all();
+        }
+    }
+
+public:
+    thread_pool() = default;
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->stopping = true;
+        }
+        this->wake.notify_all();
+        for (std::thread& worker : this->workers)
+            worker.join();
+    }
+
+    static thread_pool& shared() {
+        static thread_pool pool;
+        return pool;
+    }
+
+    //true on pool threads and on a thread running a task, nested parallel loops run serially there
+    static bool& insideTask() {
+        thread_local bool inside = false;
+        return inside;
+    }
+
+    //runs task on the calling thread and on helpers pool threads, returns once all of them are done.
+    //task must not throw
+    void run(size_t helpers, const std::function<void()>& task) {
+        std::lock_guard<std::mutex> run_lock(this->run_mutex);
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            while (this->workers.size() < helpers)
+                this->workers.emplace_back(&thread_pool::workerLoop, this);
+            this->task = &task;
+            this->waiting = helpers;
+        }
+        this->wake.notify_all();
+
+        insideTask() = true;
+        task();
+        insideTask() = false;
+
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->done.wait(lock, [this]() { return this->waiting == 0 && this->running == 0; });
+        this->task = nullptr;
+    }
+};
+
+// runs function(i) for every i in [0, count) on up to num_threads threads of the shared pool, the calling thread works too
+// indices are handed out one at a time from a shared counter, so uneven work balances itself. the first exception thrown
+// by function stops handing out indices and is rethrown on the calling thread once every thread is done
+template <typename Function>
+void parallelFor(size_t count, int num_threads, Function function) {
+    size_t threads = std::min(static_cast<size_t>(std::max(num_threads, 1)), count);
+    if (threads <= 1 || thread_pool::insideTask()) {
+        for (size_t i = 0; i < count; i++)
+            function(i);
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    std::function<void()> worker = [&]() {
+        try {
+            for (size_t i = next++; i < count; i = next++)
+                function(i);
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error)
+                error = std::current_exception();
+            next = count;
+        }
+        };
+    thread_pool::shared().run(threads - 1, worker);
+    if (error)
+        std::rethrow_exception(error);
+}
+
+#endif
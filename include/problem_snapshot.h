@@ -0,0 +1,110 @@
+#ifndef PROBLEM_SNAPSHOT_H
+#define PROBLEM_SNAPSHOT_H
+
+#include <Eigen/Core>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// binary snapshot of an initialized problem
+//
+// layout (all sections 8 byte aligned, little endian, native doubles):
+//   snapshot_header
+//   int32  vertex_sizes[vertex_type_count]
+//   uint64 vertex_counts[vertex_type_count]
+//   int32  vertex_ids[vertex_count]           -> type-major, ascending id inside a type
+//   uint8  vertex_fixed[vertex_count]
+//   double parameters[sum(count_t * size_t)]  -> one row-major (count_t x size_t) block per type
+//   int32  edge_ids[edge_count]
+//   int32  edge_vertices[edge_count * 2]      -> indices into vertex_ids, not global ids
+//   double measurements[edge_count * edge_size]
+//   double w_sigmas[edge_count]
+//   int32  prior_vertices[prior_vertex_count] -> indices into vertex_ids of the marginal prior's vertices
+//   double prior_linearization_point[prior_columns]
+//   double prior_jacobian[prior_rows * prior_columns] -> row-major
+//   double prior_residual[prior_rows]
+
+class problem_snapshot
+{
+public:
+    using RowMatrixXd = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+    using EdgeVertexMatrix = Eigen::Matrix<int32_t, Eigen::Dynamic, 2, Eigen::RowMajor>;
+
+    static constexpr uint32_t version = 2;
+
+    // everything needed to write a snapshot, gathered by Optimization_General::saveSnapshot
+    struct contents {
+        int edge_size = 0;
+        std::vector<int32_t> vertex_sizes;
+        std::vector<uint64_t> vertex_counts;
+        std::vector<int32_t> vertex_ids;
+        std::vector<uint8_t> vertex_fixed;
+        std::vector<double> parameters;
+        std::vector<int32_t> edge_ids;
+        std::vector<int32_t> edge_vertices;
+        std::vector<double> measurements;
+        std::vector<double> w_sigmas;
+        //marginal prior, empty when nothing was marginalized
+        std::vector<int32_t> prior_vertices;
+        std::vector<double> prior_linearization_point;
+        std::vector<double> prior_jacobian;
+        std::vector<double> prior_residual;
+    };
+
+    problem_snapshot();
+    explicit problem_snapshot(const std::string& path);
+    ~problem_snapshot();
+
+    problem_snapshot(const problem_snapshot&) = delete;
+    problem_snapshot& operator=(const problem_snapshot&) = delete;
+
+    static void write(const std::string& path, const contents& data);
+
+    //map the file read only, throws on malformed files
+    void open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    //Sizes
+    int getEdgeSize() const;
+    int getVertexTypeCount() const;
+    int getVertexSize(int vertex_type) const;
+    size_t getVertexCount() const;
+    size_t getVertexCount(int vertex_type) const;
+    size_t getVertexOffset(int vertex_type) const; // index of the first vertex of this type
+    size_t getEdgeCount() const;
+
+    //zero-copy views into the mapped file
+    Eigen::Map<const Eigen::Matrix<int32_t, Eigen::Dynamic, 1>> getVertexIds() const;
+    const uint8_t* getVertexFixed() const;
+    Eigen::Map<const RowMatrixXd> getParameters(int vertex_type) const;
+    Eigen::Map<const Eigen::Matrix<int32_t, Eigen::Dynamic, 1>> getEdgeIds() const;
+    Eigen::Map<const EdgeVertexMatrix> getEdgeVertices() const;
+    Eigen::Map<const RowMatrixXd> getMeasurements() const;
+    Eigen::Map<const Eigen::VectorXd> getSigmas() const;
+    Eigen::Map<const Eigen::Matrix<int32_t, Eigen::Dynamic, 1>> getPriorVertices() const;
+    Eigen::Map<const Eigen::VectorXd> getPriorLinearizationPoint() const;
+    Eigen::Map<const RowMatrixXd> getPriorJacobian() const;
+    Eigen::Map<const Eigen::VectorXd> getPriorResidual() const;
+
+private:
+    struct snapshot_header;
+
+    const unsigned char* data;
+    size_t size;
+    const snapshot_header* header;
+#ifdef _WIN32
+    void* file_handle;
+    void* mapping_handle;
+#else
+    int file_descriptor;
+#endif
+
+    std::vector<size_t> parameter_offsets; // offset of each type block in the parameters section (in doubles)
+    std::vector<size_t> vertex_offsets;
+
+    template <typename T>
+    const T* section(uint64_t offset) const;
+};
+
+#endif
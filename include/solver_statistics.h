@@ -0,0 +1,72 @@
+#ifndef SOLVER_STATISTICS_H
+#define SOLVER_STATISTICS_H
+
+#include <chrono>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// one attempted step of optimize() / optimizeWithLM(), times are in seconds
+struct iteration_statistics {
+    int iteration = 0;             // outer iteration, rejected lm steps share it with the step that follows
+    double residual_time = 0;      // residuals of the relinearization after the step
+    double jacobian_time = 0;      // edge jacobians of that relinearization
+    double assembly_time = 0;      // J^T W J, J^T W e and the damping
+    double factorization_time = 0;
+    double solve_time = 0;
+    double step_time = 0;          // applying the step, the trial cost and reverting rejected steps
+    double cost = 0;               // e^T e after the step, at the trial point for rejected steps
+    double gradient_max = 0;       // max |b| at the linearization point of the step
+    double step_norm = 0;
+    int linear_iterations = 0;     // conjugate gradient iterations of the step, 0 for direct solves
+    double mu = 0;                 // damping the step was solved with, 0 for gauss-newton
+    double rho = 0;                // gain ratio, nan for gauss-newton and for a step below the update threshold
+    bool accepted = false;
+
+    double totalTime() const;
+};
+
+// statistics of one whole solve
+struct solver_summary {
+    std::vector<iteration_statistics> iterations;
+    double setup_time = 0;         // covariance, first linearization and assembly
+    double total_time = 0;
+    double initial_cost = 0;
+    double final_cost = 0;
+    size_t jacobian_evaluations = 0;
+    size_t jacobian_relinearizations = 0;
+    size_t model_evaluations = 0;
+    std::string termination;       // why the solve stopped
+
+    void clear();
+    int acceptedSteps() const;
+    //timings summed over all iterations
+    iteration_statistics totals() const;
+    //one block of totals, per_iteration adds a row for every attempted step
+    void print(std::ostream& stream, bool per_iteration = false) const;
+};
+
+using iteration_callback = std::function<void(const iteration_statistics&)>;
+
+// adds the time from construction to stop() or destruction to total, in seconds
+class scoped_timer
+{
+private:
+    double& total;
+    std::chrono::steady_clock::time_point start;
+    bool running;
+
+public:
+    explicit scoped_timer(double& total) : total(total), start(std::chrono::steady_clock::now()), running(true) {}
+    ~scoped_timer() { stop(); }
+
+    void stop() {
+        if (!running)
+            return;
+        total += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        running = false;
+    }
+};
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef VERTEX_ORDERING_H
+#define VERTEX_ORDERING_H
+
+#include <vector>
+
+#include "graph_adjacency.h"
+
+// fill-reducing elimination orderings on the block (vertex) graph of the hessian
+enum class OrderingType {
+    Natural,          // vertex type, then insertion order
+    AMD,              // approximate minimum degree on the vertex graph
+    COLAMD,           // column approximate minimum degree on the edge x vertex block jacobian
+    NestedDissection  // recursive level-set bisection, separators eliminated last
+};
+
+//elimination order of the free vertices [0, free_count): order[k] is the dense index eliminated k-th
+std::vector<int> computeVertexOrdering(const graph_adjacency& adjacency, int free_count, OrderingType type);
+
+//stable reorder so that lower groups are eliminated first, keeping the fill-reducing order inside each group
+//groups is indexed by dense vertex index
+void applyEliminationGroups(std::vector<int>& order, const std::vector<int>& groups);
+
+#endif
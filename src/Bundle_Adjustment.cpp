@@ -1,5 +1,38 @@
 ﻿#include "Bundle_Adjustment.h"
 
+bundle_adjustment::bundle_adjustment(const ba_intrinsics& intrinsics) : Optimization_General({ 2 }, { 6,3 }), intrinsics(intrinsics) {}
+
+void bundle_adjustment::setIntrinsics(const ba_intrinsics& intrinsics) {
+    this->intrinsics = intrinsics;
+}
+
+const ba_intrinsics& bundle_adjustment::getIntrinsics() {
+    return this->intrinsics;
+}
+
+void bundle_adjustment::estimateY(std::vector<std::reference_wrapper<Eigen::VectorXd>>& input, Eigen::VectorXd& output) {
+    const Eigen::VectorXd& camera = input[0].get();
+    const Eigen::VectorXd& landmark = input[1].get();
+
+    output.resize(2);
+    //a landmark behind the camera keeps its principal point projection instead of flipping sign, the step gets rejected
+    if (!projectPoint(camera.data(), landmark.data(), this->intrinsics, output.data())) {
+        output[0] = this->intrinsics.cx;
+        output[1] = this->intrinsics.cy;
+    }
+}
+
+void bundle_adjustment::estimateYBatch(const Eigen::MatrixXd& first_parameters, const Eigen::MatrixXd& second_parameters, Eigen::MatrixXd& output) {
+    //the projection has no cheap whole-row form, so this evaluates column by column on the contiguous storage
+    output.resize(2, first_parameters.cols());
+    for (Eigen::Index k = 0; k < first_parameters.cols(); k++) {
+        if (!projectPoint(first_parameters.col(k).data(), second_parameters.col(k).data(), this->intrinsics, output.col(k).data())) {
+            output(0, k) = this->intrinsics.cx;
+            output(1, k) = this->intrinsics.cy;
+        }
+    }
+}
+
 
 
 //compare with g2o - potentially step by step - ☑️
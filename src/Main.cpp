@@ -1,7 +1,7 @@
 ﻿#include <iostream>
 #include <vector>
 #include <chrono>
-#include "Optimization_General.h"
+#include "Optimization_general.h"
 #include "data_generate.h"
 //#include "Bundle_Adjustment.h"
 
@@ -13,19 +13,7 @@ int main(int argc, char** argv) {
 
     // Parameteres and data for the problem
     std::string filePath = "..\\..\\..\\..\\Other\\data\\data.csv"; // Update this to your actual file path
-    auto [col1, col2] = readCsvColumns(filePath);
-
-    int N = col1.size(); // Number of data points
     double w_sigma = 1; // Noise of the data
-    std::vector<Eigen::VectorXd> x_data(N), y_data(N); // Data
-
-    for (int i = 0; i < N; i++) {
-        x_data[i].resize(1);
-        y_data[i].resize(1);
-        x_data[i][0] = (std::stod(col1[i]));
-        y_data[i][0] = (std::stod(col2[i]));
-    }
-
 
     std::vector<int> edge_sizes = { 1 };
     std::vector<int> vertex_sizes = { 3,1 };
@@ -34,21 +22,40 @@ int main(int argc, char** argv) {
     Eigen::VectorXd initial_est(3);
     initial_est << 1, 5, 3;
 
+    const int parameter_id = 0; // data points take the vertex indices after the parameter vertex
 
-    optimizer->addVertex(N, initial_est, 0, false);
-
-    for (int i = 0; i < N; i++) {
-        //add fixed vertex
-        optimizer->addVertex(i, x_data[i], 1, true);
-        //add edge
-        optimizer->addEdge(i, y_data[i], w_sigma, N, i);
-    }
-
-    //optimizer->removeEdge(54);
-    //optimizer->removeVertex(54);
-
+    //parse the data straight into contiguous arrays, one chunk of rows at a time, and build the problem in one pass.
+    //buildProblem copies what it needs, the arrays are released before the solve
     optimizer->setRobust(true, 10);
-    optimizer->initialize();
+    {
+        std::vector<double> x_data, y_data;
+        std::vector<int> edge_vertices;
+        streamCsvColumns(filePath, 2, [&](const csv_chunk_reader& reader, size_t rows) {
+            for (size_t r = 0; r < rows; r++) {
+                int N = static_cast<int>(x_data.size()) + 1; // index of the fixed data vertex
+                x_data.push_back(reader.value(r, 0));
+                y_data.push_back(reader.value(r, 1));
+                edge_vertices.push_back(parameter_id);
+                edge_vertices.push_back(N);
+            }
+            });
+        std::vector<uint8_t> vertex_fixed(1 + x_data.size(), 1);
+        vertex_fixed[parameter_id] = 0;
+
+        problem_arrays arrays;
+        arrays.parameters = { initial_est.data(), x_data.data() };
+        arrays.vertex_counts = { 1, x_data.size() };
+        arrays.vertex_fixed = vertex_fixed.data();
+        arrays.edge_count = y_data.size();
+        arrays.measurements = y_data.data();
+        arrays.w_sigma = w_sigma; // the file has no weight column, every point gets the same w_sigma
+        arrays.edge_vertices = edge_vertices.data();
+
+        //optimizer->removeEdge(54);
+        //optimizer->removeVertex(54);
+
+        optimizer->buildProblem(arrays);
+    }
 
     Eigen::VectorXd parameters;
 
@@ -67,10 +74,11 @@ int main(int argc, char** argv) {
 
     //print the elapsed time in seconds
     std::cout << "\nElapsed time: " << elapsed.count() << " s\n";
+    optimizer->getSummary().print(std::cout);
 
     //std::cout << "\nAfter optimization:" << std::endl;
 
-    Eigen::VectorXd final_est = optimizer->getVertexParameters(N);
+    Eigen::VectorXd final_est = optimizer->getVertexParameters(parameter_id);
     std::vector<double> final_est_vec = std::vector<double>(final_est.data(), final_est.data() + final_est.size());
     std::cout << "\nOptimized parameters: " << final_est.transpose() << "\n\n";
 
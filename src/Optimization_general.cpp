@@ -1,13 +1,12 @@
-﻿#include "Optimization_General.h"
+﻿#include "Optimization_general.h"
 
 
 // private:
 
-void Optimization_General::computeError(const Eigen::VectorXd& estimatedParameters1, const Eigen::VectorXd& estimatedParameters2, const Eigen::VectorXd& Measurements, Eigen::VectorXd& errorVec) {
+void Optimization_General::computeError(general_edge* edge_ptr, Eigen::VectorXd& y_est, Eigen::VectorXd& errorVec) {
 
-    Eigen::VectorXd y_est;
-    Eigen::VectorXd estimatedParameters_ = estimatedParameters1;
-    Eigen::VectorXd estimatedParameters2_ = estimatedParameters2;
+    Eigen::VectorXd estimatedParameters_ = edge_ptr->getFirstVertex()->getParameters();
+    Eigen::VectorXd estimatedParameters2_ = edge_ptr->getSecondVertex()->getParameters();
 
 
     std::vector<std::reference_wrapper<Eigen::VectorXd>> arg_vec;
@@ -15,72 +14,142 @@ void Optimization_General::computeError(const Eigen::VectorXd& estimatedParamete
     arg_vec.push_back(estimatedParameters2_);
 
     estimateY(arg_vec, y_est);
-    errorVec.resize(Measurements.size());
+    this->model_evaluations++;
 
-    errorVec = y_est - Measurements;
+    errorVec = y_est - edge_ptr->getMeasurement();
 
 }
 
-void Optimization_General::computeJacobianVertex(const Eigen::VectorXd& parameters, const Eigen::VectorXd& constants, double step_size, Eigen::MatrixXd& J) {
+void Optimization_General::evaluatePerturbed(const Eigen::MatrixXd& perturbed, const Eigen::VectorXd& constants, bool second_vertex, Eigen::MatrixXd& Y) {
+    Y.resize(this->edge_size, perturbed.cols());
+    this->model_evaluations += perturbed.cols();
+
+    if (this->batched_differences) {
+        Eigen::MatrixXd constant_columns = constants.replicate(1, perturbed.cols());
+        if (second_vertex)
+            estimateYBatch(constant_columns, perturbed, Y);
+        else
+            estimateYBatch(perturbed, constant_columns, Y);
+        return;
+    }
 
-    Eigen::VectorXd y0; // y(estimate)
-    Eigen::VectorXd y1;// y(estimate + h)
-    Eigen::VectorXd temp_parameters = parameters; //copy assignment
+    Eigen::VectorXd temp_parameters;
     Eigen::VectorXd temp_constants = constants; //copy assignment
+    Eigen::VectorXd y;
 
     //make a vector of arguments to pass to the estimateY function
+    //estimateY expects the first vertex of the edge first, whichever one is perturbed
     std::vector<std::reference_wrapper<Eigen::VectorXd>> arguments_vec;
-    arguments_vec.push_back(temp_parameters);
-    arguments_vec.push_back(temp_constants);
-
-    estimateY(arguments_vec, y0);// calculate y(estimate)
+    if (second_vertex) {
+        arguments_vec.push_back(temp_constants);
+        arguments_vec.push_back(temp_parameters);
+    }
+    else {
+        arguments_vec.push_back(temp_parameters);
+        arguments_vec.push_back(temp_constants);
+    }
 
-    //∂e/∂x = (de(estimate + step_size) - de(estimate)) / dstep_size => ( (y(estimate + h) - y(actual)) - (y(estimate) - y(actual)) )  ) /h => (y(estimate + h) - y(estimate)) / h
-    for (int i = 0; i < parameters.size(); i++) {
+    for (int k = 0; k < perturbed.cols(); k++) {
+        temp_parameters = perturbed.col(k);
+        estimateY(arguments_vec, y);
+        Y.col(k) = y;
+    }
+}
 
-        //update the parameter
-        temp_parameters[i] += step_size;
+void Optimization_General::computeJacobianVertex(const Eigen::VectorXd& parameters, const Eigen::VectorXd& constants, Eigen::MatrixXd& J, bool second_vertex, const Eigen::VectorXd* y0) {
+    int n = static_cast<int>(parameters.size());
 
-        // calculate y(estimate + h)
-        estimateY(arguments_vec, y1); // calculate y(estimate + h)
+    //relative step per parameter, rounded so that x + h - x is exactly h
+    Eigen::VectorXd h(n);
+    for (int i = 0; i < n; i++) {
+        volatile double shifted = parameters[i] + this->relative_step * std::max(std::abs(parameters[i]), 1.0);
+        h[i] = shifted - parameters[i];
+    }
 
-        //calculate the partial derivative
-        J.col(i) = (y1 - y0) / step_size;
+    Eigen::MatrixXd perturbed, Y;
 
-        temp_parameters[i] = parameters[i]; //reset the parameter
+    if (this->difference_method == DifferenceMethod::Forward) {
+        //∂e/∂x = (e(estimate + h) - e(estimate)) / h = (y(estimate + h) - y(estimate)) / h, column n is y(estimate) unless y0 is given
+        perturbed = parameters.replicate(1, y0 ? n : n + 1);
+        for (int i = 0; i < n; i++)
+            perturbed(i, i) += h[i];
+        evaluatePerturbed(perturbed, constants, second_vertex, Y);
+        for (int i = 0; i < n; i++)
+            J.col(i) = (Y.col(i) - (y0 ? *y0 : Y.col(n))) / h[i];
+        return;
     }
-}
 
+    //central differences at steps h, h/2, h/4, ... one per ridders level, column 2 * (level * n + i) is x + step, the next one x - step
+    int levels = this->difference_method == DifferenceMethod::Ridders ? this->ridders_levels : 1;
+    perturbed = parameters.replicate(1, 2 * n * levels);
+    for (int level = 0; level < levels; level++) {
+        for (int i = 0; i < n; i++) {
+            double step = std::ldexp(h[i], -level);
+            perturbed(i, 2 * (level * n + i)) += step;
+            perturbed(i, 2 * (level * n + i) + 1) -= step;
+        }
+    }
+    evaluatePerturbed(perturbed, constants, second_vertex, Y);
 
-void Optimization_General::buildCovarianceMatrix() {
-    Eigen::MatrixXd* Cov = new Eigen::MatrixXd();
-
-    //structure of the covariance matrix -> rows & cols - number of measurements(observations in a measurement) * measurement count
-    Cov->resize(this->edge_size * this->general_edge_count, this->edge_size * this->general_edge_count);
-    Cov->setZero();
+    auto central = [&](int level, int i) -> Eigen::VectorXd {
+        return (Y.col(2 * (level * n + i)) - Y.col(2 * (level * n + i) + 1)) / (2 * std::ldexp(h[i], -level));
+        };
 
-    Eigen::MatrixXd Cov_edge;
-    Cov_edge.resize(this->edge_size, this->edge_size);
+    for (int i = 0; i < n; i++) {
+        //neville tableau, with the step halved every extrapolation cancels the next even power of h (factors of 4)
+        std::vector<Eigen::VectorXd> previous, current;
+        Eigen::VectorXd best = central(0, i);
+        double best_error = std::numeric_limits<double>::max();
+        previous.push_back(best);
+        for (int level = 1; level < levels; level++) {
+            current.assign(1, central(level, i));
+            double factor = 4;
+            for (int j = 1; j <= level; j++) {
+                current.push_back((factor * current[j - 1] - previous[j - 1]) / (factor - 1));
+                factor *= 4;
+                double error = std::max((current[j] - current[j - 1]).lpNorm<Eigen::Infinity>(), (current[j] - previous[j - 1]).lpNorm<Eigen::Infinity>());
+                if (error <= best_error) {
+                    best_error = error;
+                    best = current[j];
+                }
+            }
+            //stop once the higher orders drift away from the best estimate
+            if ((current[level] - previous[level - 1]).lpNorm<Eigen::Infinity>() >= 2 * best_error)
+                break;
+            previous.swap(current);
+        }
+        J.col(i) = best;
+    }
+}
 
-    double sigma_squared;
-    int location;
+void Optimization_General::computeEdgeJacobian(general_edge* edge_ptr, bool second_vertex, Eigen::MatrixXd& J, const Eigen::VectorXd* y0) {
+    int slot = second_vertex ? 1 : 0;
+    bool cache = this->warm_start || this->relinearize_threshold > 0;
 
-    for (auto edge_ptr : this->general_edges) {
+    //reuse the jacobian while the updates applied to both vertices since it was taken stay under the threshold
+    this->jacobian_evaluations++;
+    if (cache && edge_ptr->getCachedJacobian(slot, this->relinearize_threshold, J))
+        return;
+    this->jacobian_relinearizations++;
 
-        sigma_squared = edge_ptr->getCovariance();
-        location = edge_ptr->getId() * this->edge_size;
+    Eigen::VectorXd first_parameters = edge_ptr->getFirstVertex()->getParameters();
+    Eigen::VectorXd second_parameters = edge_ptr->getSecondVertex()->getParameters();
+    if (second_vertex)
+        this->computeJacobianVertex(second_parameters, first_parameters, J, true, y0);
+    else
+        this->computeJacobianVertex(first_parameters, second_parameters, J, false, y0);
 
-        Cov_edge.setIdentity();
-        Cov_edge *= sigma_squared;
-        //std::cout << "Location: " << location << "\n";
-        //std::cout << "Cov_edge: " << Cov_edge << "\n";
+    if (cache)
+        edge_ptr->cacheJacobian(slot, J);
+}
 
-        Cov->block(location, location, edge_size, edge_size) = Cov_edge;
+void Optimization_General::buildWeightVector(Eigen::VectorXd& weights) {
+    //inverse variance of every edge row, zero variance gets weight 0 like inverseDiagonal. prior rows are already whitened
+    weights.setOnes(this->getResidualRows());
+    for (size_t k = 0; k < this->active_edges.size(); k++) {
+        double sigma_squared = this->active_edges[k]->getCovariance();
+        weights.segment(static_cast<int>(k) * this->edge_size, this->edge_size).setConstant(sigma_squared != 0 ? 1 / sigma_squared : 0.0);
     }
-    delete this->Cov;
-    this->Cov = Cov;
-    //std::cout << "Covariance matrix built" << std::endl;
-    //std::cout << *Cov << std::endl;
 }
 
 void Optimization_General::updateEstimates(Eigen::VectorXd& deltaX) {
@@ -89,80 +158,58 @@ void Optimization_General::updateEstimates(Eigen::VectorXd& deltaX) {
 //         vertex_ptr->updateParameters(deltaX.segment(vertex_ptr->getId() * this->vertex_size, this->vertex_size));
 //     }
 
-    int location = 0;
-    int l = 0;
-    int size = 0;
-
-    for (int i = 0; i < this->general_vertices.size(); i++) {
-        for (int k = 0; k < i; k++)
-            location += this->vertex_sizes[k] * this->vertex_sizes[k];
-        size = this->vertex_sizes[i];
-
-        for (int j = 0; j < this->general_vertices[i].size(); j++) {
-            l = location + j * size;
-            this->general_vertices[i][j]->updateParameters(deltaX.segment(l, size));
-        }
+    general_vertex* vertex_ptr;
+    for (int v : this->active_vertices) {
+        vertex_ptr = this->dense_vertices[v];
+        vertex_ptr->updateParameters(deltaX.segment(this->vertex_columns[v], this->vertex_sizes[vertex_ptr->getType()]));
     }
+    this->estimates_valid = false;
 }
 
 void Optimization_General::revertEstimates() {
-    for (int i = 0; i < this->general_vertices.size(); i++) {
-        for (int j = 0; j < this->general_vertices[i].size(); j++) {
-            this->general_vertices[i][j]->revertParameters();
-        }
+    //only the active vertices were updated, the others hold an older previous_parameters
+    for (int v : this->active_vertices) {
+        this->dense_vertices[v]->revertParameters();
     }
+    this->estimates_valid = false;
 }
 
-void Optimization_General::buildErrorVector() {
-    Eigen::VectorXd* eVec = new Eigen::VectorXd();
+void Optimization_General::buildErrorVector(Eigen::VectorXd& eVec) {
     //structure of the error vector -> rows - number of measurements(observations in a measurement) * measurement count, cols - 1
-    eVec->resize(this->edge_size * this->general_edge_count);
+    eVec.resize(this->getResidualRows());
 
-    Eigen::VectorXd errorVec_edge;
-    errorVec_edge.resize(this->edge_size);
+    this->edge_estimates.resize(this->edge_size * this->active_edges.size());
 
     //double w_sigma;
 
-    auto processEdge = [&](general_edge* edge_ptr) {
-        general_vertex* first_vertex_ptr = edge_ptr->getFirstVertex();
-        general_vertex* second_vertex_ptr = edge_ptr->getSecondVertex();
-
-        Eigen::VectorXd estimatedParameters1 = first_vertex_ptr->getParameters();
-        Eigen::VectorXd estimatedParameters2 = second_vertex_ptr->getParameters();
-
-        Eigen::VectorXd Measurements = edge_ptr->getMeasurement();
-
-        this->computeError(estimatedParameters1, estimatedParameters2, Measurements, errorVec_edge);
-
-        if (bRobust)
-            robustifyError(errorVec_edge, this->delta, edge_ptr->getCovariance());
-
-        eVec->segment(edge_ptr->getId() * this->edge_size, this->edge_size) = errorVec_edge;
-        };
     //calculate the error vector for each edge and add the error to the error vector
-
-    for (auto edge_ptr : this->general_edges) {
-        processEdge(edge_ptr);
-    }
-
-    //delete this->errorVec;
-    this->errorVec = eVec;
+    this->forEachEdgeChunk([&](size_t begin, size_t end) {
+        Eigen::VectorXd errorVec_edge, y_est;
+        for (size_t k = begin; k < end; k++) {
+            general_edge* edge_ptr = this->active_edges[k];
+            int row_location = static_cast<int>(k) * this->edge_size;
+            this->computeError(edge_ptr, y_est, errorVec_edge);
+            this->edge_estimates.segment(row_location, this->edge_size) = y_est;
+
+            if (bRobust)
+                robustifyError(errorVec_edge, this->delta, edge_ptr->getCovariance());
+
+            eVec.segment(row_location, this->edge_size) = errorVec_edge;
+        }
+        });
+    this->estimates_valid = true;
+    appendPriorRows(&eVec, nullptr);
 }
 
 void Optimization_General::buildJacobian() {
 
-    Eigen::MatrixXd* J = new Eigen::MatrixXd();
+    Eigen::MatrixXd& J = this->Jacobian;
 
     //structure of the jacobian matrix -> rows - number of measurements(observations in a measurement) * measurement count, cols - n of parameters in a vertex x number of vertices
     //Order - rows -> order of the edges in the edges vector, cols -> order of the vertices in the vertices vector
 
-    size_t jacobian_column_size = 0;
-
-    for (int i = 0; i < this->vertex_sizes.size(); i++)
-        jacobian_column_size += this->general_vertices[i].size() * this->vertex_sizes[i];
-
-
-    J->resize(this->edge_size * this->general_edge_count, jacobian_column_size);//change
+    J.resize(this->getResidualRows(), this->parameter_count);
+    J.setZero();
 
     Eigen::MatrixXd J_vertex;
 
@@ -172,178 +219,206 @@ void Optimization_General::buildJacobian() {
     int column_location,row_location;
     int vertex_size;
 
+    //estimates of a preceding buildErrorVector are the base point of forward differences for both vertices
+    Eigen::VectorXd y_est;
+    const Eigen::VectorXd* y0 = this->estimates_valid ? &y_est : nullptr;
 
-    for (auto edge_ptr : this->general_edges) { //iterate for all edges in the edges vector
+    for (size_t k = 0; k < this->active_edges.size(); k++) { //iterate for all active edges
+        general_edge* edge_ptr = this->active_edges[k];
 
         first_vertex_ptr = edge_ptr->getFirstVertex();
         second_vertex_ptr = edge_ptr->getSecondVertex();
+        row_location = static_cast<int>(k) * this->edge_size;
+        if (y0)
+            y_est = this->edge_estimates.segment(row_location, this->edge_size);
 
-        int first_vertex_id = first_vertex_ptr->getId();
-        int second_vertex_id = second_vertex_ptr->getId();
-
-        //check if the vertex is fixed and skip it if it is withouth calculating the jacobian
-
-        if (!first_vertex_ptr->getFixed()) {
+        //check if the vertex is fixed or inactive (no column) and skip it if it is withouth calculating the jacobian
+        column_location = this->vertex_columns[first_vertex_ptr->getDenseIndex()];
+        if (column_location >= 0) {
             //resize the jvertex here
             vertex_size = this->vertex_sizes[first_vertex_ptr->getType()];
             J_vertex.resize(this->edge_size, vertex_size);
 
             //calculate the first vertex jacobian
-            this->computeJacobianVertex(first_vertex_ptr->getParameters(), second_vertex_ptr->getParameters(), 1e-6, J_vertex);
-
-            //calculate the position of the first vertex in the jacobian matrix
-            column_location = 0;
-            row_location = edge_ptr->getId() * this->edge_size;
-
-            for (int i = 0; i < first_vertex_ptr->getType(); i++) {
-                column_location += this->vertex_types[i] * this->vertex_sizes[i];
-            }
-            column_location += vertex_size * first_vertex_ptr->getId();
+            this->computeEdgeJacobian(edge_ptr, false, J_vertex, y0);
 
             //add the first vertex jacobian to the jacobian matrix
             //std::cout << "Row location: " << row_location << " | Column location: " << column_location << " | J_vertex: " << J_vertex<< std::endl;
-            J->block(row_location, column_location, J_vertex.rows(), J_vertex.cols()) = J_vertex;
+            J.block(row_location, column_location, J_vertex.rows(), J_vertex.cols()) = J_vertex;
 
         }
-        if (!second_vertex_ptr->getFixed()) {
+        column_location = this->vertex_columns[second_vertex_ptr->getDenseIndex()];
+        if (column_location >= 0) {
 
             vertex_size = this->vertex_sizes[second_vertex_ptr->getType()];
             J_vertex.resize(this->edge_size, vertex_size);
 
             //calculate the first vertex jacobian
-            this->computeJacobianVertex(second_vertex_ptr->getParameters(), first_vertex_ptr->getParameters(), 1e-6, J_vertex);
+            this->computeEdgeJacobian(edge_ptr, true, J_vertex, y0);
 
-            //calculate the position of the first vertex in the jacobian matrix
-            column_location = 0;
-            row_location = edge_ptr->getId() * this->edge_size;
-
-            for (int i = 0; i < second_vertex_ptr->getType(); i++) {
-                column_location += this->vertex_types[i] * this->vertex_sizes[i];
-            }
-            column_location += vertex_size * second_vertex_ptr->getId();
-
-            //add the first vertex jacobian to the jacobian matrix
-            J->block(row_location, column_location, J_vertex.rows(), J_vertex.cols()) = J_vertex;
+            //add the second vertex jacobian to the jacobian matrix
+            J.block(row_location, column_location, J_vertex.rows(), J_vertex.cols()) = J_vertex;
 
         }
     }
-    //delete this->Jacobian;
-    
-    this->Jacobian = J;
+    appendPriorRows(nullptr, &J);
     //std::cout << "Jacobian matrix: " << *Jacobian << std::endl;
 }
 
 void Optimization_General::buildErrorVecndJacobian() {
 
     //error vector
-    Eigen::VectorXd* eVec = new Eigen::VectorXd();
+    Eigen::VectorXd& eVec = this->errorVec;
     //structure of the error vector -> rows - number of measurements(observations in a measurement) * measurement count, cols - 1
-    eVec->resize(this->edge_size * this->general_edge_count);
-    eVec->setZero();
-
-    Eigen::VectorXd errorVec_edge;
-    errorVec_edge.resize(this->edge_size);
-
-    general_vertex *first_vertex_ptr, *second_vertex_ptr;
-    Eigen::VectorXd estimatedParameters1, estimatedParameters2, Measurements;
-
-    //jacobian
-    int column_location,row_location;
-    int vertex_size;
-    int first_vertex_id, second_vertex_id;
+    eVec.resize(this->getResidualRows());
+    eVec.setZero();
 
-    Eigen::MatrixXd* J = new Eigen::MatrixXd();
+    Eigen::MatrixXd& J = this->Jacobian;
     //structure of the jacobian matrix -> rows - number of measurements(observations in a measurement) * measurement count, cols - n of parameters in a vertex x number of vertices
     //Order - rows -> order of the edges in the edges vector, cols -> order of the vertices in the vertices vector
-    size_t jacobian_column_size = 0;
-    for (int i = 0; i < this->vertex_sizes.size(); i++)
-        jacobian_column_size += this->general_vertices[i].size() * this->vertex_sizes[i];
-    J->resize(this->edge_size * this->general_edge_count, jacobian_column_size);//change
-    J->setZero();
-
-    Eigen::MatrixXd J_vertex;
-
-    for (auto edge_ptr : this->general_edges) {
-        first_vertex_ptr = edge_ptr->getFirstVertex();
-        second_vertex_ptr = edge_ptr->getSecondVertex();
-
-        first_vertex_id = first_vertex_ptr->getId();
-        second_vertex_id = second_vertex_ptr->getId();
-        estimatedParameters1 = first_vertex_ptr->getParameters();
-        estimatedParameters2 = second_vertex_ptr->getParameters();
-        Measurements = edge_ptr->getMeasurement();
-
-        row_location = edge_ptr->getId() * this->edge_size;
-
-        //update the error vector
-        this->computeError(estimatedParameters1, estimatedParameters2, Measurements, errorVec_edge);
-        Eigen::VectorXd weights;
-        //std::cout << "Edge: " << edge_ptr->getId() << "| before Error vector: " << errorVec_edge;
-        if (bRobust) 
-            weights = robustifyError(errorVec_edge, this->delta,edge_ptr->getCovariance());
-
-        //std::cout << " | after Error vector: " << errorVec_edge << std::endl;
-		
-        eVec->segment(row_location, this->edge_size) += errorVec_edge;
-
-
-        //update the jacobian matrix - check if the vertex is fixed and skip it if it is withouth calculating the jacobian
-        if (!first_vertex_ptr->getFixed()) {
-            //resize the jvertex here
-            vertex_size = this->vertex_sizes[first_vertex_ptr->getType()];
-            J_vertex.resize(this->edge_size, vertex_size);
-
-            //calculate the first vertex jacobian
-            this->computeJacobianVertex(first_vertex_ptr->getParameters(), second_vertex_ptr->getParameters(), 1e-6, J_vertex);
+    //single and mixed precision only keep the float jacobian, the implicit schur and the sparse solve only the blocks of the edges
+    bool low_precision = lowPrecision();
+    bool implicit = this->implicit_solve || this->sparse_solve;
+    if (low_precision) {
+        this->Jacobian_float.setZero(this->getResidualRows(), this->parameter_count);
+        J.resize(0, 0);
+        this->edge_jacobians.clear();
+    }
+    else if (implicit) {
+        this->edge_jacobians.resize(2 * this->active_edges.size());
+        J.resize(0, 0);
+        this->Jacobian_float.resize(0, 0);
+    }
+    else {
+        J.setZero(this->getResidualRows(), this->parameter_count);
+        this->Jacobian_float.resize(0, 0);
+        this->edge_jacobians.clear();
+    }
 
-            //calculate the position of the first vertex in the jacobian matrix
-            column_location = 0;
-            for (int i = 0; i < first_vertex_ptr->getType(); i++) {
-                column_location += this->vertex_types[i] * this->vertex_sizes[i];
+    //residual pass, the error pass of the accepted step may already have evaluated every edge at this point
+    scoped_timer residual_timer(this->iteration_stats.residual_time);
+    bool reuse_estimates = this->estimates_valid;
+    if (!reuse_estimates)
+        this->edge_estimates.resize(this->edge_size * this->active_edges.size());
+    Eigen::VectorXd robust_weights = Eigen::VectorXd::Ones(this->edge_size * this->active_edges.size());
+
+    this->forEachEdgeChunk([&](size_t begin, size_t end) {
+        Eigen::VectorXd errorVec_edge, y_est;
+        for (size_t k = begin; k < end; k++) {
+            general_edge* edge_ptr = this->active_edges[k];
+            int row_location = static_cast<int>(k) * this->edge_size;
+
+            //update the error vector
+            if (reuse_estimates) {
+                errorVec_edge = this->edge_estimates.segment(row_location, this->edge_size) - edge_ptr->getMeasurement();
+            }
+            else {
+                this->computeError(edge_ptr, y_est, errorVec_edge);
+                this->edge_estimates.segment(row_location, this->edge_size) = y_est;
             }
-            column_location += vertex_size * first_vertex_ptr->getId();
+            //std::cout << "Edge: " << edge_ptr->getId() << "| before Error vector: " << errorVec_edge;
+            if (bRobust)
+                robust_weights.segment(row_location, this->edge_size) = robustifyError(errorVec_edge, this->delta, edge_ptr->getCovariance());
 
-            //std::cout << "Edge: " << edge_ptr->getId() << " | before J_vertex: " << J_vertex;
-            if (bRobust) 
-				robustifyJacobianVertex(J_vertex, weights);
-            //std::cout << " | after J_vertex: " << J_vertex << std::endl;
-			
+            //std::cout << " | after Error vector: " << errorVec_edge << std::endl;
 
-            //add the first vertex jacobian to the jacobian matrix
-            //std::cout << "Row location: " << row_location << " | Column location: " << column_location << " | J_vertex: " << J_vertex<< std::endl;
-            J->block(row_location, column_location, J_vertex.rows(), J_vertex.cols()) += J_vertex;
-            
-            if(Verbose)
-            std::cout << "edge: "<< edge_ptr->getId() << " | J_vertex: " << J_vertex << " | error_vector: "<< errorVec_edge << std::endl;
+            eVec.segment(row_location, this->edge_size) += errorVec_edge;
         }
-        if (!second_vertex_ptr->getFixed()) {
+        });
+    this->estimates_valid = true;
+    residual_timer.stop();
+
+    //jacobian pass, forward differences of both vertices start from the edge estimate
+    scoped_timer jacobian_timer(this->iteration_stats.jacobian_time);
+    //the verbose trace of every edge is written after the pass, in edge order whatever thread computed it
+    std::vector<std::string> edge_traces(Verbose ? this->active_edges.size() : 0);
+    this->forEachEdgeChunk([&](size_t begin, size_t end) {
+        Eigen::MatrixXd J_vertex;
+        Eigen::VectorXd y_est, edge_weights;
+        for (size_t k = begin; k < end; k++) {
+            general_edge* edge_ptr = this->active_edges[k];
+            general_vertex* first_vertex_ptr = edge_ptr->getFirstVertex();
+            general_vertex* second_vertex_ptr = edge_ptr->getSecondVertex();
+
+            int row_location = static_cast<int>(k) * this->edge_size;
+            y_est = this->edge_estimates.segment(row_location, this->edge_size);
+            edge_weights = robust_weights.segment(row_location, this->edge_size);
+            if (implicit) {
+                this->edge_jacobians[2 * k].resize(0, 0);
+                this->edge_jacobians[2 * k + 1].resize(0, 0);
+            }
 
-            vertex_size = this->vertex_sizes[second_vertex_ptr->getType()];
-            J_vertex.resize(this->edge_size, vertex_size);
+            //update the jacobian matrix - check if the vertex is fixed or inactive and skip it if it is withouth calculating the jacobian
+            int column_location = this->vertex_columns[first_vertex_ptr->getDenseIndex()];
+            if (column_location >= 0) {
+                //resize the jvertex here
+                J_vertex.resize(this->edge_size, this->vertex_sizes[first_vertex_ptr->getType()]);
+
+                //calculate the first vertex jacobian
+                this->computeEdgeJacobian(edge_ptr, false, J_vertex, &y_est);
+
+                //std::cout << "Edge: " << edge_ptr->getId() << " | before J_vertex: " << J_vertex;
+                if (bRobust)
+                    robustifyJacobianVertex(J_vertex, edge_weights);
+                //std::cout << " | after J_vertex: " << J_vertex << std::endl;
+
+                //add the first vertex jacobian to the jacobian matrix
+                //std::cout << "Row location: " << row_location << " | Column location: " << column_location << " | J_vertex: " << J_vertex<< std::endl;
+                if (low_precision)
+                    this->Jacobian_float.block(row_location, column_location, J_vertex.rows(), J_vertex.cols()) += J_vertex.cast<float>();
+                else if (implicit)
+                    this->edge_jacobians[2 * k] = J_vertex;
+                else
+                    J.block(row_location, column_location, J_vertex.rows(), J_vertex.cols()) += J_vertex;
+
+                if (Verbose) {
+                    std::ostringstream trace;
+                    trace << "edge: " << edge_ptr->getId() << " | J_vertex: " << J_vertex << " | error_vector: " << eVec.segment(row_location, this->edge_size);
+                    edge_traces[k] = trace.str();
+                }
+            }
+            column_location = this->vertex_columns[second_vertex_ptr->getDenseIndex()];
+            if (column_location >= 0) {
 
-            //calculate the first vertex jacobian
-            this->computeJacobianVertex(second_vertex_ptr->getParameters(), first_vertex_ptr->getParameters(), 1e-6, J_vertex);
+                J_vertex.resize(this->edge_size, this->vertex_sizes[second_vertex_ptr->getType()]);
 
-            //calculate the position of the first vertex in the jacobian matrix
-            column_location = 0;
-            for (int i = 0; i < second_vertex_ptr->getType(); i++) {
-                column_location += this->vertex_types[i] * this->vertex_sizes[i];
-            }
-            column_location += vertex_size * second_vertex_ptr->getId();
+                //calculate the second vertex jacobian
+                this->computeEdgeJacobian(edge_ptr, true, J_vertex, &y_est);
 
-            if (bRobust) 
-                robustifyJacobianVertex(J_vertex, weights);
-            
+                if (bRobust)
+                    robustifyJacobianVertex(J_vertex, edge_weights);
 
-            //add the first vertex jacobian to the jacobian matrix
-            J->block(row_location, column_location, J_vertex.rows(), J_vertex.cols()) += J_vertex;
+                //add the first vertex jacobian to the jacobian matrix
+                if (low_precision)
+                    this->Jacobian_float.block(row_location, column_location, J_vertex.rows(), J_vertex.cols()) += J_vertex.cast<float>();
+                else if (implicit)
+                    this->edge_jacobians[2 * k + 1] = J_vertex;
+                else
+                    J.block(row_location, column_location, J_vertex.rows(), J_vertex.cols()) += J_vertex;
 
+            }
         }
+        });
+    for (const std::string& trace : edge_traces) {
+        if (!trace.empty())
+            BA_LOG_UNFILTERED(LogLevel::Trace, trace);
     }
-    //delete this->Jacobian;
-    this->Jacobian = J;
-    //delete this->errorVec;
-    this->errorVec = eVec;
+    //the block solves read the prior rows from the prior itself
+    if (low_precision)
+        appendPriorRows(&eVec, nullptr, &this->Jacobian_float);
+    else
+        appendPriorRows(&eVec, implicit ? nullptr : &J);
+}
+
+void Optimization_General::forEachEdgeChunk(const std::function<void(size_t, size_t)>& process) {
+    //chunks of consecutive edges keep the per edge scratch vectors and the shared counter off the hot path
+    const size_t chunk_size = 64;
+    size_t edge_count = this->active_edges.size();
+    size_t chunks = (edge_count + chunk_size - 1) / chunk_size;
+    parallelFor(chunks, this->num_threads, [&](size_t chunk) {
+        size_t begin = chunk * chunk_size;
+        process(begin, std::min(begin + chunk_size, edge_count));
+        });
 }
 
 void Optimization_General::estimateY(std::vector<std::reference_wrapper<Eigen::VectorXd>>& input, Eigen::VectorXd& output) {
@@ -360,6 +435,14 @@ void Optimization_General::estimateY(std::vector<std::reference_wrapper<Eigen::V
 
     output[0] = std::exp(a * x * x +b * x + c);
 }
+
+void Optimization_General::estimateYBatch(const Eigen::MatrixXd& first_parameters, const Eigen::MatrixXd& second_parameters, Eigen::MatrixXd& output) {
+    //same model as estimateY on whole rows, so the exponentials of all points vectorize
+    Eigen::ArrayXd x = second_parameters.row(0).transpose().array();
+
+    output.resize(1, first_parameters.cols());
+    output.row(0) = (first_parameters.row(0).transpose().array() * x * x + first_parameters.row(1).transpose().array() * x + first_parameters.row(2).transpose().array()).exp().matrix().transpose();
+}
 // public:
 Optimization_General::Optimization_General(std::vector<int> edge_sizes, std::vector<int> vertex_sizes) {
     this->edge_sizes = edge_sizes;
@@ -369,36 +452,90 @@ Optimization_General::Optimization_General(std::vector<int> edge_sizes, std::vec
     this->edge_size = edge_sizes[0];
     this->vertex_size = vertex_sizes[0];
     this->fixed_vertex_count = 0;
-    this->errorVec = new Eigen::VectorXd();
-    this->Cov = new Eigen::MatrixXd();
-    this->Jacobian = new Eigen::MatrixXd();
-    this->deltaX = new Eigen::VectorXd();
-    this->A = new Eigen::MatrixXd();
-    this->b = new Eigen::VectorXd();
     this->bRobust = false;
     this->delta = 1;
     this->Verbose = false;
+    this->ordering_type = OrderingType::Natural;
+    this->linear_solver = LinearSolverType::DenseLDLT;
+    this->incremental_depth = 1;
+    this->warm_start = false;
+    this->relinearize_threshold = 0;
+    this->last_mu = 0;
+    this->covariance_valid = false;
+    this->symbolic_valid = false;
+    this->jacobian_evaluations = 0;
+    this->jacobian_relinearizations = 0;
+    this->model_evaluations = 0;
+    this->estimates_valid = false;
+    this->difference_method = DifferenceMethod::Forward;
+    this->relative_step = 1e-6;
+    this->ridders_levels = 4;
+    this->batched_differences = false;
+    this->num_threads = 1;
+    this->memory_budget = 0;
+    this->precision = SolverPrecision::Double;
+    this->refinement_steps = 2;
+    this->preconditioner_type = PreconditionerType::BlockJacobi;
+    this->cg_max_iterations = 500;
+    this->cg_tolerance = 1e-8;
+    this->cluster_size = 4;
+    this->schur_valid = false;
+    this->schur_size = 0;
+    this->implicit_schur = false;
+    this->implicit_solve = false;
+    this->sparse_solve = false;
+    this->window_size = 0;
+    this->window_type = 0;
+    this->parameter_count = 0;
+    this->layout_valid = false;
     //this->vertex_types.resize(vertex_sizes.size());
     //this->general_vertices.resize(vertex_sizes.size());
     //this->general_edges.resize(edge_sizes.size());
 }
 
 Optimization_General::Optimization_General() {
-    std::cout << "Please specify the size of the vertices and edges vectors" << std::endl;
+    LOG_WARNING("Please specify the size of the vertices and edges vectors");
     this->edge_size = 0;
     this->vertex_size = 0;
     this->general_edge_count = 0;
     this->vertex_count = 0;
     this->fixed_vertex_count = 0;
-    this->errorVec = new Eigen::VectorXd();
-    this->Cov = new Eigen::MatrixXd();
-    this->Jacobian = new Eigen::MatrixXd();
-    this->deltaX = new Eigen::VectorXd();
-    this->A = new Eigen::MatrixXd();
-    this->b = new Eigen::VectorXd();
     this->bRobust = false;
     this->delta = 1;
     this->Verbose = false;
+    this->ordering_type = OrderingType::Natural;
+    this->linear_solver = LinearSolverType::DenseLDLT;
+    this->incremental_depth = 1;
+    this->warm_start = false;
+    this->relinearize_threshold = 0;
+    this->last_mu = 0;
+    this->covariance_valid = false;
+    this->symbolic_valid = false;
+    this->jacobian_evaluations = 0;
+    this->jacobian_relinearizations = 0;
+    this->model_evaluations = 0;
+    this->estimates_valid = false;
+    this->difference_method = DifferenceMethod::Forward;
+    this->relative_step = 1e-6;
+    this->ridders_levels = 4;
+    this->batched_differences = false;
+    this->num_threads = 1;
+    this->memory_budget = 0;
+    this->precision = SolverPrecision::Double;
+    this->refinement_steps = 2;
+    this->preconditioner_type = PreconditionerType::BlockJacobi;
+    this->cg_max_iterations = 500;
+    this->cg_tolerance = 1e-8;
+    this->cluster_size = 4;
+    this->schur_valid = false;
+    this->schur_size = 0;
+    this->implicit_schur = false;
+    this->implicit_solve = false;
+    this->sparse_solve = false;
+    this->window_size = 0;
+    this->window_type = 0;
+    this->parameter_count = 0;
+    this->layout_valid = false;
 }
 
 void Optimization_General::setVertexSize(int vertex_size) {
@@ -428,6 +565,79 @@ double Optimization_General::getDelta() {
 }
 
 
+void Optimization_General::setOrdering(OrderingType ordering_type) {
+    this->ordering_type = ordering_type;
+    this->layout_valid = false;
+}
+
+OrderingType Optimization_General::getOrdering() {
+    return this->ordering_type;
+}
+
+void Optimization_General::setEliminationGroups(std::vector<int> type_groups) {
+    this->type_elimination_groups = type_groups;
+    this->layout_valid = false;
+}
+
+void Optimization_General::setLinearSolver(LinearSolverType linear_solver) {
+    this->linear_solver = linear_solver;
+    //the symbolic analysis belongs to the previous solver, the precision of the weights may change with it
+    this->symbolic_valid = false;
+    this->covariance_valid = false;
+    if (linear_solver == LinearSolverType::ConjugateGradient && this->precision != SolverPrecision::Double)
+        LOG_WARNING("Conjugate gradients run in double, the single and mixed precision setting is ignored");
+}
+
+LinearSolverType Optimization_General::getLinearSolver() {
+    return this->linear_solver;
+}
+
+void Optimization_General::setPrecision(SolverPrecision precision, int refinement_steps) {
+    this->precision = precision;
+    this->refinement_steps = std::max(refinement_steps, 0);
+    //the float weights and the symbolic analysis belong to the previous precision
+    this->covariance_valid = false;
+    this->symbolic_valid = false;
+    if (precision != SolverPrecision::Double && this->linear_solver == LinearSolverType::ConjugateGradient)
+        LOG_WARNING("Conjugate gradients run in double, the single and mixed precision setting is ignored");
+}
+
+bool Optimization_General::lowPrecision() {
+    return this->precision != SolverPrecision::Double && this->linear_solver != LinearSolverType::ConjugateGradient;
+}
+
+bool Optimization_General::sparseSolveApplies() {
+    return this->linear_solver == LinearSolverType::SparseLDLT && !lowPrecision();
+}
+
+SolverPrecision Optimization_General::getPrecision() {
+    return this->precision;
+}
+
+void Optimization_General::setIterativeSolver(PreconditionerType preconditioner, int max_iterations, double tolerance, int cluster_size) {
+    this->preconditioner_type = preconditioner;
+    this->cg_max_iterations = std::max(max_iterations, 1);
+    this->cg_tolerance = tolerance;
+    this->cluster_size = std::max(cluster_size, 1);
+    this->symbolic_valid = false;
+}
+
+PreconditionerType Optimization_General::getPreconditioner() {
+    return this->preconditioner_type;
+}
+
+void Optimization_General::setImplicitSchur(bool implicit_schur) {
+    this->implicit_schur = implicit_schur;
+}
+
+bool Optimization_General::getImplicitSchur() {
+    return this->implicit_schur;
+}
+
+const std::vector<int>& Optimization_General::getEliminationOrder() {
+    return this->elimination_order;
+}
+
 void Optimization_General::setEdgeSize(int edge_size) {
     this->edge_size = edge_size;
 }
@@ -438,60 +648,181 @@ void Optimization_General::setEdgeSizes(std::vector<int> edge_sizes) {
 
 Optimization_General::~Optimization_General() {}
 
+void Optimization_General::reset() {
+    this->temp_vertices.clear();
+    this->temp_edges.clear();
+    this->vertex_lookup.clear();
+    this->edge_lookup.clear();
+    this->general_vertices.clear();
+    this->fixed_vertices.clear();
+    this->general_edges.clear();
+    this->vertex_types.clear();
+    this->dense_vertices.clear();
+    this->adjacency.clear();
+    this->pending_vertices.clear();
+    this->pending_edges.clear();
+    this->incremental_edges.clear();
+    this->active_vertices.clear();
+    this->active_edges.clear();
+    this->elimination_order.clear();
+    this->vertex_columns.clear();
+    this->parameter_count = 0;
+    this->layout_valid = false;
+    this->prior.clear();
+    invalidateWarmStart();
+    this->sparse_A = Eigen::SparseMatrix<double>();
+    this->preconditioner.clear();
+    this->schur_eliminated.clear();
+    this->schur_reduced.clear();
+    this->schur_offsets.clear();
+
+    this->general_edge_count = 0;
+    this->vertex_count = 0;
+    this->fixed_vertex_count = 0;
+
+    //release the memory of the work buffers, not just their contents
+    this->errorVec = Eigen::VectorXd();
+    this->weights = Eigen::VectorXd();
+    this->Jacobian = Eigen::MatrixXd();
+    this->Jacobian_float = Eigen::MatrixXf();
+    this->weights_float = Eigen::VectorXf();
+    this->edge_jacobians = std::vector<Eigen::MatrixXd>();
+    this->A_diagonal = Eigen::VectorXd();
+    this->A_float = Eigen::MatrixXf();
+    this->deltaX = Eigen::VectorXd();
+    this->A = Eigen::MatrixXd();
+    this->b = Eigen::VectorXd();
+
+    this->edge_pool.clear();
+    this->vertex_pool.clear();
+}
+
 void Optimization_General::addVertex(int id, Eigen::VectorXd vertex_data, int vertex_type, bool isFixed)
 {
-    general_vertex* vertex_ptr = new general_vertex(id);
+    //staged and bulk built vertices share one id space
+    if (findVertex(id) != nullptr) {
+        LOG_WARNING("Vertex with ID " << id << " already exists.");
+        return;
+    }
+    general_vertex* vertex_ptr = this->vertex_pool.create(id);
     vertex_ptr->setType(vertex_type);
     vertex_ptr->setParameters(vertex_data);
     vertex_ptr->setFixed(isFixed);
     this->temp_vertices.insert(std::make_pair(id, vertex_ptr));
+    this->pending_vertices.push_back(vertex_ptr);
 }
 
 void Optimization_General::removeVertex(int id)
 {
-    this->temp_vertices.erase(id);
+    auto it = this->temp_vertices.find(id);
+    if (it == this->temp_vertices.end())
+        return;
+    //only vertices that are not initialized yet can be dropped from the next initialize()
+    this->pending_vertices.erase(std::remove(this->pending_vertices.begin(), this->pending_vertices.end(), it->second), this->pending_vertices.end());
+    this->temp_vertices.erase(it);
 }
 
 Eigen::VectorXd Optimization_General::getVertexParameters(int id) {
-    if (temp_vertices.count(id) == 0) {
-        std::cout << "Vertex with ID " << id << " does not exist." << std::endl;
+    general_vertex* vertex_ptr = findVertex(id);
+    if (vertex_ptr == nullptr) {
+        LOG_WARNING("Vertex with ID " << id << " does not exist.");
         return Eigen::VectorXd(); // Return an empty vector or handle the error accordingly.
     }
-    return temp_vertices[id]->getParameters();
+    return vertex_ptr->getParameters();
 }
 
 void Optimization_General::addEdge(int id, Eigen::VectorXd measurement, double w_sigma, int first_vertex_id, int second_vertex_id) {
 
-    general_edge* edge_ptr = new general_edge(id);
-    edge_ptr->setMeasurement(measurement, w_sigma);
-
     //check if the vertices exist
-    if (temp_vertices.count(first_vertex_id) == 0) {
-        std::cout << "Vertex with ID " << first_vertex_id << " does not exist." << std::endl;
+    general_vertex* first_vertex_ptr = findVertex(first_vertex_id);
+    general_vertex* second_vertex_ptr = findVertex(second_vertex_id);
+    if (first_vertex_ptr == nullptr) {
+        LOG_WARNING("Vertex with ID " << first_vertex_id << " does not exist.");
+        return;
+    }
+    else if (second_vertex_ptr == nullptr) {
+        LOG_WARNING("Vertex with ID " << second_vertex_id << " does not exist.");
         return;
     }
-    else if (temp_vertices.count(second_vertex_id) == 0) {
-        std::cout << "Vertex with ID " << second_vertex_id << " does not exist." << std::endl;
+
+    if (findEdge(id) != nullptr) {
+        LOG_WARNING("Edge with ID " << id << " already exists.");
         return;
     }
 
-    edge_ptr->setFirstVertex(this->temp_vertices[first_vertex_id]);
-    edge_ptr->setSecondVertex(this->temp_vertices[second_vertex_id]);
+    general_edge* edge_ptr = this->edge_pool.create(id);
+    edge_ptr->setMeasurement(measurement, w_sigma);
+
+    edge_ptr->setFirstVertex(first_vertex_ptr);
+    edge_ptr->setSecondVertex(second_vertex_ptr);
 
     temp_edges.insert(std::make_pair(id, edge_ptr));
+    this->pending_edges.push_back(edge_ptr);
 }
 
 void Optimization_General::removeEdge(int id) {
-    this->temp_edges.erase(id);
+    auto it = this->temp_edges.find(id);
+    if (it == this->temp_edges.end())
+        return;
+    this->pending_edges.erase(std::remove(this->pending_edges.begin(), this->pending_edges.end(), it->second), this->pending_edges.end());
+    this->temp_edges.erase(it);
+}
+
+void Optimization_General::setEdgeMeasurement(int id, Eigen::VectorXd measurement) {
+    general_edge* edge_ptr = findEdge(id);
+    if (edge_ptr == nullptr) {
+        LOG_WARNING("Edge with ID " << id << " does not exist.");
+        return;
+    }
+    this->setEdgeMeasurement(id, measurement, edge_ptr->getSigma());
+}
+
+void Optimization_General::setEdgeMeasurement(int id, Eigen::VectorXd measurement, double w_sigma) {
+    general_edge* edge_ptr = findEdge(id);
+    if (edge_ptr == nullptr) {
+        LOG_WARNING("Edge with ID " << id << " does not exist.");
+        return;
+    }
+    if (edge_ptr->getIsInitialized() && measurement.size() != this->edge_size) {
+        LOG_WARNING("Edge with ID " << id << ": measurement size " << measurement.size() << " does not match the edge size " << this->edge_size);
+        return;
+    }
+    //jacobians do not depend on the measurement, only a new sigma touches the covariance
+    if (w_sigma != edge_ptr->getSigma())
+        this->covariance_valid = false;
+    edge_ptr->setMeasurement(measurement, w_sigma);
 }
 
 Eigen::VectorXd Optimization_General::getEdgeMeasurement(int id) {
-    if (temp_edges.count(id) == 0) {
-        std::cout << "Edge with ID " << id << " does not exist." << std::endl;
+    general_edge* edge_ptr = findEdge(id);
+    if (edge_ptr == nullptr) {
+        LOG_WARNING("Edge with ID " << id << " does not exist.");
         return Eigen::VectorXd();
     }
 
-    return temp_edges[id]->getMeasurement();
+    return edge_ptr->getMeasurement();
+}
+
+general_vertex* Optimization_General::findVertex(int id) {
+    auto it = temp_vertices.find(id);
+    if (it != temp_vertices.end())
+        return it->second;
+
+    auto lookup = std::lower_bound(vertex_lookup.begin(), vertex_lookup.end(), std::make_pair(id, static_cast<general_vertex*>(nullptr)));
+    if (lookup != vertex_lookup.end() && lookup->first == id)
+        return lookup->second;
+    return nullptr;
+}
+
+general_edge* Optimization_General::findEdge(int id) {
+    auto it = temp_edges.find(id);
+    if (it != temp_edges.end())
+        return it->second;
+
+    auto lookup = std::lower_bound(edge_lookup.begin(), edge_lookup.end(), std::make_pair(id, static_cast<general_edge*>(nullptr)));
+    if (lookup != edge_lookup.end() && lookup->first == id)
+        return lookup->second;
+    return nullptr;
 }
 
 //normal optimazation process 
@@ -505,39 +836,46 @@ void Optimization_General::optimize(int iterations) {
     double last_cost = std::numeric_limits<double>::infinity();
     Eigen::VectorXd poseUpdate;
 
-    std::cout << "Optimization started! \n" << std::endl;
+    LOG_INFO("Optimization started!");
+    std::chrono::steady_clock::time_point solve_start = std::chrono::steady_clock::now();
+    this->summary.clear();
+    this->jacobian_evaluations = 0;
+    this->jacobian_relinearizations = 0;
+    this->model_evaluations = 0;
+    //the layout or the vertices may have changed since the last solve
+    this->estimates_valid = false;
+
+    scoped_timer setup_timer(this->summary.setup_time);
+    if (!this->layout_valid)
+        buildLayout();
+    if (!withinMemoryBudget()) {
+        finishSummary(solve_start);
+        return;
+    }
 
     //build the covariance matrix
-    buildCovarianceMatrix();
-    Eigen::MatrixXd* Cov = this->Cov;
-    //std::cout << "Covariance matrix built" << std::endl;
-    //std::cout << *Cov << std::endl;
-    //Eigen::MatrixXd Cov_inv = Cov->inverse(); // this takes a lot of time
-    Eigen::MatrixXd Cov_inv = inverseDiagonal(*Cov);
+    //Eigen::MatrixXd Cov_inv = Cov.inverse(); // this takes a lot of time
+    this->implicit_solve = implicitSchurApplies();
+    this->sparse_solve = sparseSolveApplies();
+    prepareCovariance();
 
 
     //buildErrorVector();
     //buildJacobian();
     buildErrorVecndJacobian();
 
-    Eigen::VectorXd* errorVec = this->errorVec;
-    Eigen::MatrixXd* J = this->Jacobian;
+    Eigen::VectorXd* errorVec = &this->errorVec;
 
-    //build the A matrix
-    Eigen::MatrixXd A = J->transpose() * Cov_inv * *J;
+    //build the A matrix and the b vector
+    Eigen::MatrixXd A;
+    Eigen::VectorXd b;
+    buildNormalEquations(A, b);
 
-
-    
     cost = (errorVec->transpose() * *errorVec).norm() / errorVec->size() ;
-
-    //build the b vector
-    Eigen::VectorXd b =-1 * J->transpose() * Cov_inv * *errorVec;
-    if (Verbose) {
-        std::cout << "\nJacobian matrix: \n" << *J << std::endl;
-        std::cout << "\nError vector: \n" << *errorVec << std::endl;
-        std::cout << "\nHessian matrix: \n" << A << std::endl;
-        std::cout << "\nb vector: \n" << b << std::endl;
-	}
+    setup_timer.stop();
+    this->summary.initial_cost = errorVec->squaredNorm();
+    if (Verbose)
+        traceLinearSystem(A, b, true);
 
     
     b_max = abs(b.maxCoeff());
@@ -545,59 +883,61 @@ void Optimization_General::optimize(int iterations) {
     //std::cout << "Iterative Step \n";
     while (b_max > th1 && current_iteration < iterations) {
         current_iteration++;
+        this->iteration_stats = iteration_statistics();
+        this->iteration_stats.iteration = current_iteration;
+        this->iteration_stats.gradient_max = b_max;
+        this->iteration_stats.rho = std::numeric_limits<double>::quiet_NaN();
+
         //solve the linear system
-        poseUpdate = A.ldlt().solve(b);
+        if (lowPrecision())
+            solveLinearSystemFloat(this->A_float, b, poseUpdate);
+        else if (this->implicit_solve)
+            solveImplicitSchur(this->weights, Eigen::VectorXd::Zero(b.size()), b, poseUpdate);
+        else if (this->sparse_solve)
+            solveSparseSystem(0, b, poseUpdate);
+        else
+            solveLinearSystem(A, b, poseUpdate);
 		//std::cout << "i: "<< current_iteration << "| Pose update: \n" << poseUpdate.transpose() << std::endl;
         update_norm = poseUpdate.norm();
-
-
-        ///////////////////////////////////////////////////////printing the results in each iteration////////////////////////////////////////////////////////
-        std::cout << "cur_iter: " << current_iteration << " | cost: " << cost << " | update_norm: " << update_norm << " | b_max: " << b_max << " Estimated param: ";
-
-        for (int i = 0; i < general_vertices.size(); i++) {
-            for (int j = 0; j < general_vertices[i].size(); j++) {
-				std::cout << general_vertices[i][j]->getParameters().transpose() << ", ";
-			}
-		}
-        std::cout << std::endl;
-        /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        this->iteration_stats.step_norm = update_norm;
         
         //////////check if the update norm is less than the threshold
         if (update_norm < th2){
-            std::cout << "Update norm is less than threshold: " << update_norm << " < " << th2 << std::endl;
+            LOG_DEBUG("Update norm is less than threshold: " << update_norm << " < " << th2);
+            this->summary.termination = "update norm below threshold";
+            //the step is not taken, it is recorded at the current point
+            this->iteration_stats.cost = errorVec->squaredNorm();
+            recordIteration();
             break;
         }
         /////////////////////////////////////////////////////////////
         
 
         //update the pose and landmark vertices
+        scoped_timer step_timer(this->iteration_stats.step_time);
         this->updateEstimates(poseUpdate);
+        step_timer.stop();
         
         //buildErrorVector();
         //buildJacobian();
         buildErrorVecndJacobian();
 
-        errorVec = this->errorVec;
-        J = this->Jacobian;
-
-        //build the A matrix
-        A = J->transpose() * Cov_inv * *J;
-
-
-        //build the b vector
-        b = -1 * J->transpose() * Cov_inv * *errorVec;
+        //build the A matrix and the b vector
+        scoped_timer assembly_timer(this->iteration_stats.assembly_time);
+        buildNormalEquations(A, b);
+        assembly_timer.stop();
 
         cost = (errorVec->transpose() * *errorVec).norm() / errorVec->size();
+        this->iteration_stats.cost = errorVec->squaredNorm();
+        this->iteration_stats.accepted = cost < last_cost;
+        recordIteration();
 
-        if (Verbose) {
-            std::cout << "\nJacobian matrix: \n" << *J << std::endl;
-            std::cout << "\nError vector: \n" << *errorVec << std::endl;
-            std::cout << "\nHessian matrix: \n" << A << std::endl;
-            std::cout << "\nb vector: \n" << b << std::endl;
-        }
+        if (Verbose)
+            traceLinearSystem(A, b, true);
 
         if (cost >= last_cost) {
-            std::cout << "\n\ncost: cur_cost " << cost << " >= last_cost " << last_cost <<"| last - curr: "<<  last_cost - cost  << std::endl;
+            LOG_DEBUG("cost: cur_cost " << cost << " >= last_cost " << last_cost <<"| last - curr: "<<  last_cost - cost);
+            this->summary.termination = "cost increased";
             break;
         }
         last_cost = cost;
@@ -605,150 +945,700 @@ void Optimization_General::optimize(int iterations) {
 
 
     }
-    std::cout << "\nOptimization finished\n"<<"b max :" << b_max << "| Iterations: " << current_iteration;
-    std::cout << " Final cost: " << cost << " | update_norm: " << update_norm << std::endl;
+    if (this->summary.termination.empty() && b_max <= th1)
+        this->summary.termination = "gradient below threshold";
+    this->implicit_solve = false;
+    this->sparse_solve = false;
+    finishSummary(solve_start);
+    LOG_INFO("Optimization finished: " << this->summary.termination << " | b max: " << b_max << " | Iterations: " << current_iteration
+        << " | Final cost: " << cost << " | update_norm: " << update_norm);
+    LOG_INFO("Vertex jacobians differentiated: " << this->jacobian_relinearizations << " of " << this->jacobian_evaluations << " | model evaluations: " << this->model_evaluations);
+    this->incremental_edges.clear();
 }
 
 void Optimization_General::optimizeWithLM(int iterations) {
-    bool stop = false;
-    int v = 2;
-    double mu = 0;
-    double th1 = 1e-12;
-    double th2 = 1e-12;
-    double th3 = 1e-6;
-    double update_norm = 0;
-    double b_max = 0;
-    double rho = 0;
-    double _temp = 0;
-    int current_iteration = 0;
-    //double cost = 0;
-    double last_cost = std::numeric_limits<double>::infinity();
-    Eigen::VectorXd poseUpdate;
-
-    std::cout << "Optimization started! \n" << std::endl;
+    if (!this->layout_valid)
+        buildLayout();
 
-    buildCovarianceMatrix();
-    Eigen::MatrixXd* Cov = this->Cov;
-    Eigen::MatrixXd Cov_inv = inverseDiagonal(*Cov);
-    this->CovI = &Cov_inv;
-
-    buildErrorVecndJacobian();
+    levenbergMarquardt(iterations);
+    this->incremental_edges.clear();
+}
 
-    Eigen::VectorXd* errorVec_ = this->errorVec;
-    Eigen::MatrixXd* J = this->Jacobian;
+void Optimization_General::optimizeIncremental(int iterations) {
+    //vertices and edges added since the last initialize() join the graph first
+    if (!this->pending_edges.empty() || !this->pending_vertices.empty())
+        initialize();
+    if (this->incremental_edges.empty()) {
+        LOG_WARNING("No new edges since the last solve");
+        return;
+    }
+    //relinearize and refactorize only the region around the new edges
+    buildIncrementalLayout();
+    LOG_INFO("Incremental solve | active vertices: " << this->active_vertices.size() << " of " << this->vertex_count
+        << " | active edges: " << this->active_edges.size() << " of " << this->general_edge_count);
 
-    Eigen::MatrixXd A = J->transpose() * Cov_inv * *J;
-    Eigen::VectorXd b = -1 * J->transpose() * Cov_inv * *errorVec_;
+    levenbergMarquardt(iterations);
+    this->incremental_edges.clear();
+}
 
-    Eigen::MatrixXd A_temp;
-    A_temp.resizeLike(A);
+void Optimization_General::setIncrementalDepth(int depth) {
+    this->incremental_depth = depth;
+}
 
-    mu = th3 * A.diagonal().maxCoeff();
+void Optimization_General::setWarmStart(bool warm_start, double relinearize_threshold) {
+    this->warm_start = warm_start;
+    this->setRelinearizeThreshold(relinearize_threshold);
+}
 
-    std::cout << "initial mu: " << mu << "\n" << "initial b: " << b.transpose() << " | Initial max error: "<< errorVec_->maxCoeff() << "\ninitial A: \n" << A << "\n";
+void Optimization_General::setRelinearizeThreshold(double relinearize_threshold) {
+    this->relinearize_threshold = relinearize_threshold;
+    if (!this->warm_start && relinearize_threshold <= 0) {
+        for (general_edge* edge_ptr : this->general_edges)
+            edge_ptr->clearJacobianCache();
+    }
+}
 
-    b_max = abs(b.maxCoeff());
+double Optimization_General::getRelinearizeThreshold() {
+    return this->relinearize_threshold;
+}
 
-    stop = b_max < th1;
-    double numerator = 0, denominator = 0;
+void Optimization_General::setVerbose(bool verbose) {
+    //verbose dumps of this optimizer go out at trace level whatever the process wide level, other instances are not affected
+    this->Verbose = verbose;
+}
 
-    Eigen::VectorXd* tempErrorVec = new Eigen::VectorXd();
+void Optimization_General::setIterationCallback(iteration_callback callback) {
+    this->callback = callback;
+}
 
-    while (!stop && current_iteration < iterations) {
-		current_iteration++;
-        std::cout << "                 Iteration: " << current_iteration << "\n";
-        while (true) {
-            //solve the linear system
-            A_temp = A + mu * Eigen::MatrixXd::Identity(A.rows(), A.cols());
-            poseUpdate = A_temp.ldlt().solve(b);
-            update_norm = poseUpdate.norm();
-            //print some info
-            if (update_norm < th2) {//th2 should be multiplied with the norm of the parameters
-                std::cout << "Update norm is less than threshold: " << update_norm << " < " << th2 << std::endl;
-                stop = true;
-                break;
-            }
+const solver_summary& Optimization_General::getSummary() {
+    return this->summary;
+}
 
-            //update vertex parameters
-            this->updateEstimates(poseUpdate);
+void Optimization_General::setNumericDifferentiation(DifferenceMethod method, double relative_step, bool batched) {
+    if (relative_step <= 0) {
+        double eps = std::numeric_limits<double>::epsilon();
+        if (method == DifferenceMethod::Forward)
+            relative_step = std::sqrt(eps);
+        else if (method == DifferenceMethod::Central)
+            relative_step = std::cbrt(eps);
+        else
+            relative_step = 1e-3;
+    }
+    this->difference_method = method;
+    this->relative_step = relative_step;
+    this->batched_differences = batched;
 
-            //calclate rho
-            buildErrorVector();
-            tempErrorVec = this->errorVec;
-            //std::cout<<"tempErrorVec: "<< (errorVec_->transpose() * *errorVec_ - tempErrorVec->transpose() * *tempErrorVec) <<std::endl;
-            //std::cout << "poseUpdate: " << (poseUpdate.transpose() * mu * poseUpdate + poseUpdate.transpose() * b) << std::endl;
-            numerator = (errorVec_->transpose() * *errorVec_ - tempErrorVec->transpose() * *tempErrorVec)[0];
-            denominator = (poseUpdate.transpose() * (mu*poseUpdate + b))[0];
-            rho = numerator / denominator;
+    //cached jacobians came from the previous scheme
+    for (general_edge* edge_ptr : this->general_edges)
+        edge_ptr->clearJacobianCache();
+}
 
-            std::cout << "rho: " << rho << " | update_norm: " << update_norm;
+DifferenceMethod Optimization_General::getDifferenceMethod() {
+    return this->difference_method;
+}
 
-            if (rho >= 0) {
-                buildErrorVecndJacobian();
-                errorVec_ = this->errorVec;
-                J = this->Jacobian;
-                A = J->transpose() * Cov_inv * *J;
-                b = -1 * J->transpose() * Cov_inv * *errorVec_;
-                b_max = abs(b.maxCoeff());
+void Optimization_General::setNumThreads(int num_threads) {
+    this->num_threads = std::max(num_threads, 1);
+}
 
-                _temp = 1 - std::pow(2 * rho - 1, 3);
-                std::cout << " | Success | b_max: " << b_max << " mu: " << mu ;
+int Optimization_General::getNumThreads() {
+    return this->num_threads;
+}
 
-                mu = mu * std::min(1.0 / 3, 1 - std::pow(2 * rho - 1, 3));
-                v = 2;
+void Optimization_General::setMemoryBudget(size_t budget) {
+    this->memory_budget = budget;
+}
 
-                std::cout << " | new mu: " << mu << " | Estimated param: ";
-                for (int i = 0; i < general_vertices.size(); i++) {
-                    for (int j = 0; j < general_vertices[i].size(); j++) {
-                        std::cout << general_vertices[i][j]->getParameters().transpose() << ", ";
-                    }
-                }
-                std::cout << std::endl;
+size_t Optimization_General::getMemoryBudget() {
+    return this->memory_budget;
+}
 
-                if (b_max < th1) {
-					std::cout << "b_max is less than threshold: " << b_max << " < " << th1 << std::endl;
-                    stop = b_max < th1;
-                    break;
-				}
-            }
-            else {
-                std::cout << " | Repeat | numerator: " << numerator << " | Denominator: "<< denominator << " mu: "<< mu << std::endl;
-                this->revertEstimates();
-                mu = mu * v;
-                v = 2 * v;
-            }
-            if(rho > 0 || stop) break;
-        }
-    }
-    std::cout << "\nOptimization finished\n" << "b max :" << b_max <<" | update_norm: "<< update_norm << " | Iterations: " << current_iteration<< "\n";
+bool Optimization_General::getWarmStart() {
+    return this->warm_start;
 }
 
+void Optimization_General::setSlidingWindow(int window_size, int vertex_type) {
+    this->window_size = window_size;
+    this->window_type = vertex_type;
+}
 
-void Optimization_General::initialize() {
+void Optimization_General::slideWindow() {
+    if (this->window_size <= 0 || this->window_type >= static_cast<int>(this->general_vertices.size()))
+        return;
 
-    std::cout << "edge_sizes: ";
-    for (const auto& edge_size : this->edge_sizes) {
-        std::cout << edge_size << ", ";
-    }
-    std::cout << " | ";
-    std::cout << "vertex_sizes: ";
-    for (const auto& vertex_size : this->vertex_sizes) {
-        std::cout << vertex_size << ", ";
-    }
-    std::cout << "\n";
+    //vertices of a type are kept in insertion order, so the oldest ones lead the list
+    const std::vector<general_vertex*>& vertices = this->general_vertices[this->window_type];
+    if (static_cast<int>(vertices.size()) <= this->window_size)
+        return;
 
-    std::cout << "Total Vertices: " << temp_vertices.size()<< "\n";
+    std::vector<int> ids;
+    for (size_t i = 0; i < vertices.size() - this->window_size; i++)
+        ids.push_back(vertices[i]->getGlobalId());
+    marginalizeVertices(ids);
+}
 
-    vertex_types.resize(vertex_sizes.size());
-    general_vertices.resize(vertex_sizes.size());
+const marginal_prior& Optimization_General::getPrior() {
+    return this->prior;
+}
+
+bool Optimization_General::computeMarginalCovariances(const std::vector<int>& ids, std::vector<Eigen::MatrixXd>& covariances) {
+    covariances.clear();
+    if (!this->pending_edges.empty() || !this->pending_vertices.empty()) {
+        LOG_WARNING("New vertices or edges are not initialized yet, call initialize() first");
+        return false;
+    }
+    std::vector<general_vertex*> vertices;
+    for (int id : ids) {
+        general_vertex* vertex_ptr = findVertex(id);
+        if (vertex_ptr == nullptr) {
+            LOG_WARNING("Vertex with ID " << id << " does not exist.");
+            return false;
+        }
+        if (vertex_ptr->getFixed()) {
+            LOG_WARNING("Vertex with ID " << id << " is fixed, it has no covariance.");
+            return false;
+        }
+        vertices.push_back(vertex_ptr);
+    }
+    if (vertices.empty())
+        return true;
+
+    //information matrix of the whole problem at the current estimates, the damped system of the last step is not it
+    if (!this->layout_valid)
+        buildLayout();
+    prepareCovariance();
+    this->estimates_valid = false;
+    //double precision SparseLDLT assembles the information matrix straight into sparse_A
+    this->sparse_solve = sparseSolveApplies();
+    buildErrorVecndJacobian();
+    Eigen::MatrixXd H;
+    Eigen::VectorXd g;
+    buildNormalEquations(H, g);
+    this->sparse_solve = false;
+    //the covariance is recovered in double whatever precision the solves run in
+    bool low_precision = lowPrecision();
+    if (low_precision) {
+        H = this->A_float.cast<double>();
+        this->A_float.resize(0, 0);
+    }
+    int n = static_cast<int>(this->parameter_count);
+
+    if (this->linear_solver == LinearSolverType::SparseLDLT) {
+        //the symbolic analysis of the double solver is only kept for double precision solves
+        if (low_precision) {
+            buildSparsePattern();
+            this->sparse_solver.analyzePattern(this->sparse_A);
+            for (int k = 0; k < this->sparse_A.outerSize(); k++) {
+                for (Eigen::SparseMatrix<double>::InnerIterator it(this->sparse_A, k); it; ++it)
+                    it.valueRef() = H(it.row(), it.col());
+            }
+        }
+        this->sparse_solver.factorize(this->sparse_A);
+
+        int first_column = n;
+        for (general_vertex* vertex_ptr : vertices)
+            first_column = std::min(first_column, this->vertex_columns[vertex_ptr->getDenseIndex()]);
+        if (this->sparse_solver.info() != Eigen::Success || (this->sparse_solver.vectorD().tail(n - first_column).array() <= 0).any()) {
+            LOG_WARNING("The information matrix is not positive definite (unobserved vertices or a free gauge), no covariance");
+            return false;
+        }
+
+        std::vector<double> inverse_values;
+        Eigen::VectorXd inverse_diagonal;
+        selectedInverse(first_column, inverse_values, inverse_diagonal);
+
+        //diagonal blocks are dense in the pattern, so every entry is in the selected inverse
+        const auto& L = this->sparse_solver.matrixL().nestedExpression();
+        for (general_vertex* vertex_ptr : vertices) {
+            int column = this->vertex_columns[vertex_ptr->getDenseIndex()];
+            int size = this->vertex_sizes[vertex_ptr->getType()];
+            Eigen::MatrixXd block(size, size);
+            for (int j = 0; j < size; j++) {
+                block(j, j) = inverse_diagonal[column + j];
+                for (int i = j + 1; i < size; i++) {
+                    const int* rows = L.innerIndexPtr();
+                    const int* position = std::lower_bound(rows + L.outerIndexPtr()[column + j], rows + L.outerIndexPtr()[column + j + 1], column + i);
+                    block(i, j) = block(j, i) = inverse_values[position - rows];
+                }
+            }
+            covariances.push_back(block);
+        }
+    }
+    else {
+        //dense factorization, the columns of the requested blocks by back substitution
+        Eigen::LDLT<Eigen::MatrixXd> ldlt(H);
+        if (ldlt.info() != Eigen::Success || (ldlt.vectorD().array() <= 0).any()) {
+            LOG_WARNING("The information matrix is not positive definite (unobserved vertices or a free gauge), no covariance");
+            return false;
+        }
+        for (general_vertex* vertex_ptr : vertices) {
+            int column = this->vertex_columns[vertex_ptr->getDenseIndex()];
+            int size = this->vertex_sizes[vertex_ptr->getType()];
+            Eigen::MatrixXd unit = Eigen::MatrixXd::Zero(n, size);
+            unit.middleRows(column, size).setIdentity();
+            Eigen::MatrixXd block = ldlt.solve(unit).middleRows(column, size);
+            covariances.push_back(0.5 * (block + block.transpose()));
+        }
+    }
+    return true;
+}
+
+Eigen::MatrixXd Optimization_General::getMarginalCovariance(int id) {
+    std::vector<Eigen::MatrixXd> covariances;
+    if (!computeMarginalCovariances({ id }, covariances))
+        return Eigen::MatrixXd();
+    return covariances[0];
+}
+
+void Optimization_General::selectedInverse(int first_column, std::vector<double>& inverse_values, Eigen::VectorXd& inverse_diagonal) {
+    //with A = L D L^T (unit L) the inverse Z satisfies Z = D^-1 L^-1 + (I - L^T) Z, so for i > j in the pattern of column j
+    //  Z_ij = -sum_k L_kj Z_ik,  Z_jj = 1/D_j - sum_k L_kj Z_kj   (k over the pattern of column j)
+    //every Z_ik needed lies in the pattern of L again (it is closed under fill) and in a later column
+    const auto& L = this->sparse_solver.matrixL().nestedExpression();
+    const Eigen::VectorXd& D = this->sparse_solver.vectorD();
+    const int* outer = L.outerIndexPtr();
+    const int* inner = L.innerIndexPtr();
+    const double* values = L.valuePtr();
+    int n = static_cast<int>(L.cols());
+    inverse_values.assign(L.nonZeros(), 0.0);
+    inverse_diagonal.setZero(n);
+
+    auto inverseAt = [&](int row, int col) {
+        if (row == col)
+            return inverse_diagonal[row];
+        if (row < col)
+            std::swap(row, col);
+        const int* position = std::lower_bound(inner + outer[col], inner + outer[col + 1], row);
+        return inverse_values[position - inner];
+        };
+
+    for (int j = n - 1; j >= first_column; j--) {
+        for (int p = outer[j]; p < outer[j + 1]; p++) {
+            double sum = 0;
+            for (int q = outer[j]; q < outer[j + 1]; q++)
+                sum += values[q] * inverseAt(inner[p], inner[q]);
+            inverse_values[p] = -sum;
+        }
+        double diagonal = 1.0 / D[j];
+        for (int p = outer[j]; p < outer[j + 1]; p++)
+            diagonal -= values[p] * inverse_values[p];
+        inverse_diagonal[j] = diagonal;
+    }
+}
+
+void Optimization_General::marginalizeVertices(const std::vector<int>& ids) {
+    if (!this->pending_edges.empty() || !this->pending_vertices.empty()) {
+        LOG_WARNING("New vertices or edges are not initialized yet, call initialize() first");
+        return;
+    }
+
+    int free_count = static_cast<int>(this->vertex_count);
+    std::vector<char> marginalized(this->dense_vertices.size(), 0);
+    std::vector<int> marginal_vertices;
+    for (int id : ids) {
+        general_vertex* vertex_ptr = findVertex(id);
+        if (vertex_ptr == nullptr) {
+            LOG_WARNING("Vertex with ID " << id << " does not exist.");
+            continue;
+        }
+        if (vertex_ptr->getFixed()) {
+            LOG_WARNING("Vertex with ID " << id << " is fixed, nothing to marginalize.");
+            continue;
+        }
+        int v = vertex_ptr->getDenseIndex();
+        if (!marginalized[v]) {
+            marginalized[v] = 1;
+            marginal_vertices.push_back(v);
+        }
+    }
+    if (marginal_vertices.empty())
+        return;
+
+    //markov blanket: free neighbours through the removed edges and everything the old prior already couples
+    std::vector<char> kept(this->dense_vertices.size(), 0);
+    std::vector<int> kept_vertices;
+    auto keep = [&](int v) {
+        if (v < free_count && !marginalized[v] && !kept[v]) {
+            kept[v] = 1;
+            kept_vertices.push_back(v);
+        }
+        };
+    std::vector<int> edge_indices;
+    for (int v : marginal_vertices) {
+        const int* edges = this->adjacency.getIncidentEdges(v);
+        edge_indices.insert(edge_indices.end(), edges, edges + this->adjacency.getDegree(v));
+        const int* neighbors = this->adjacency.getNeighbors(v);
+        for (int n = 0; n < this->adjacency.getNeighborCount(v); n++)
+            keep(neighbors[n]);
+    }
+    std::sort(edge_indices.begin(), edge_indices.end());
+    edge_indices.erase(std::unique(edge_indices.begin(), edge_indices.end()), edge_indices.end());
+
+    //neighbours observed only through the removed edges (e.g. landmarks of a dropped keyframe) go with them
+    size_t kept_end = 0;
+    for (int v : kept_vertices) {
+        const int* edges = this->adjacency.getIncidentEdges(v);
+        bool only_removed = true;
+        for (int i = 0; i < this->adjacency.getDegree(v) && only_removed; i++)
+            only_removed = std::binary_search(edge_indices.begin(), edge_indices.end(), edges[i]);
+        if (only_removed) {
+            kept[v] = 0;
+            marginalized[v] = 1;
+            marginal_vertices.push_back(v);
+        }
+        else {
+            kept_vertices[kept_end++] = v;
+        }
+    }
+    kept_vertices.resize(kept_end);
+    for (general_vertex* vertex_ptr : this->prior.getVertices())
+        keep(vertex_ptr->getDenseIndex());
+    std::sort(kept_vertices.begin(), kept_vertices.end());
+
+    //linearize the removed edges and the old prior, marginalized columns first
+    this->vertex_columns.assign(this->dense_vertices.size(), -1);
+    this->active_vertices = marginal_vertices;
+    this->active_vertices.insert(this->active_vertices.end(), kept_vertices.begin(), kept_vertices.end());
+    int column = 0;
+    int marginal_columns = 0;
+    for (size_t i = 0; i < this->active_vertices.size(); i++) {
+        if (i == marginal_vertices.size())
+            marginal_columns = column;
+        int v = this->active_vertices[i];
+        this->vertex_columns[v] = column;
+        column += this->vertex_sizes[this->dense_vertices[v]->getType()];
+    }
+    if (kept_vertices.empty())
+        marginal_columns = column;
+    this->parameter_count = column;
+    this->active_edges.clear();
+    for (int e : edge_indices)
+        this->active_edges.push_back(this->general_edges[e]);
+    this->layout_valid = false;
+    this->estimates_valid = false;
+    invalidateWarmStart();
+
+    //weights of the removed edges only, the next solve rebuilds its own
+    this->covariance_valid = false;
+    prepareCovariance();
+    this->covariance_valid = false;
+    buildErrorVecndJacobian();
+    Eigen::MatrixXd H;
+    Eigen::VectorXd g;
+    buildNormalEquations(H, g);
+    if (lowPrecision()) {
+        H = this->A_float.cast<double>();
+        this->A_float.resize(0, 0);
+    }
+
+    //schur complement onto the kept vertices, pseudo inverse in case the removed block is not fully observed
+    int m = marginal_columns;
+    int r = column - marginal_columns;
+    std::vector<general_vertex*> prior_vertices;
+    for (int v : kept_vertices)
+        prior_vertices.push_back(this->dense_vertices[v]);
+
+    if (r > 0) {
+        Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigen_solver(H.topLeftCorner(m, m));
+        const Eigen::VectorXd& s = eigen_solver.eigenvalues();
+        double eps = 1e-12 * std::max(s.maxCoeff(), 0.0);
+        Eigen::VectorXd s_inv = s.unaryExpr([eps](double value) { return value > eps ? 1.0 / value : 0.0; });
+        Eigen::MatrixXd Hmm_inv = eigen_solver.eigenvectors() * s_inv.asDiagonal() * eigen_solver.eigenvectors().transpose();
+
+        Eigen::MatrixXd Hrm_Hmm_inv = H.bottomLeftCorner(r, m) * Hmm_inv;
+        Eigen::MatrixXd H_prior = H.bottomRightCorner(r, r) - Hrm_Hmm_inv * H.topRightCorner(m, r);
+        Eigen::VectorXd b_prior = g.tail(r) - Hrm_Hmm_inv * g.head(m);
+        this->prior.build(prior_vertices, H_prior, b_prior);
+    }
+    else {
+        this->prior.clear();
+    }
+
+    LOG_INFO("Marginalized " << marginal_vertices.size() << " vertices and " << edge_indices.size() << " edges | prior on "
+        << prior_vertices.size() << " vertices, " << this->prior.getRows() << " rows");
+
+    eraseVertices(marginalized, edge_indices);
+}
+
+void Optimization_General::eraseVertices(std::vector<char>& erased, const std::vector<int>& edge_indices) {
+    std::unordered_set<general_edge*> erased_edges;
+    for (int e : edge_indices)
+        erased_edges.insert(this->general_edges[e]);
+
+    //fixed vertices that only had erased edges carry no information anymore
+    int free_count = static_cast<int>(this->vertex_count);
+    for (size_t v = free_count; v < this->dense_vertices.size(); v++) {
+        const int* edges = this->adjacency.getIncidentEdges(static_cast<int>(v));
+        int degree = this->adjacency.getDegree(static_cast<int>(v));
+        bool orphaned = degree > 0;
+        for (int i = 0; i < degree && orphaned; i++)
+            orphaned = erased_edges.count(this->general_edges[edges[i]]) > 0;
+        if (orphaned)
+            erased[v] = 1;
+    }
+    auto isErased = [&erased](general_vertex* vertex_ptr) { return erased[vertex_ptr->getDenseIndex()] != 0; };
+    auto isErasedEdge = [&erased_edges](general_edge* edge_ptr) { return erased_edges.count(edge_ptr) > 0; };
+
+    //edges
+    for (auto it = this->temp_edges.begin(); it != this->temp_edges.end();) {
+        if (isErasedEdge(it->second)) it = this->temp_edges.erase(it);
+        else ++it;
+    }
+    this->edge_lookup.erase(std::remove_if(this->edge_lookup.begin(), this->edge_lookup.end(),
+        [&](const std::pair<int, general_edge*>& pair) { return isErasedEdge(pair.second); }), this->edge_lookup.end());
+    this->incremental_edges.erase(std::remove_if(this->incremental_edges.begin(), this->incremental_edges.end(), isErasedEdge), this->incremental_edges.end());
+    std::vector<general_edge*> edges;
+    edges.reserve(this->general_edges.size() - erased_edges.size());
+    for (general_edge* edge_ptr : this->general_edges) {
+        if (isErasedEdge(edge_ptr)) this->edge_pool.release(edge_ptr);
+        else edges.push_back(edge_ptr);
+    }
+    this->general_edges.swap(edges);
+    this->general_edge_count = this->general_edges.size();
+
+    //vertices, the local ids are renumbered inside every type
+    for (auto it = this->temp_vertices.begin(); it != this->temp_vertices.end();) {
+        if (isErased(it->second)) it = this->temp_vertices.erase(it);
+        else ++it;
+    }
+    this->vertex_lookup.erase(std::remove_if(this->vertex_lookup.begin(), this->vertex_lookup.end(),
+        [&](const std::pair<int, general_vertex*>& pair) { return isErased(pair.second); }), this->vertex_lookup.end());
+
+    std::vector<general_vertex*> released;
+    for (auto& vertices : this->general_vertices) {
+        size_t kept = 0;
+        for (general_vertex* vertex_ptr : vertices) {
+            if (isErased(vertex_ptr)) {
+                released.push_back(vertex_ptr);
+                continue;
+            }
+            vertex_ptr->setId(static_cast<int>(kept));
+            vertices[kept++] = vertex_ptr;
+        }
+        vertices.resize(kept);
+    }
+    size_t kept_fixed = 0;
+    for (general_vertex* vertex_ptr : this->fixed_vertices) {
+        if (isErased(vertex_ptr)) {
+            released.push_back(vertex_ptr);
+            continue;
+        }
+        vertex_ptr->setId(-1 * static_cast<int>(kept_fixed) - 1);
+        this->fixed_vertices[kept_fixed++] = vertex_ptr;
+    }
+    this->fixed_vertices.resize(kept_fixed);
+    for (general_vertex* vertex_ptr : released) {
+        this->vertex_types[vertex_ptr->getType()]--;
+        if (!vertex_ptr->getFixed())
+            this->vertex_count--;
+        this->vertex_pool.release(vertex_ptr);
+    }
+    this->fixed_vertex_count = this->fixed_vertices.size();
+
+    this->active_vertices.clear();
+    this->active_edges.clear();
+    buildAdjacency();
+    this->layout_valid = false;
+}
+
+void Optimization_General::levenbergMarquardt(int iterations) {
+    bool stop = false;
+    int v = 2;
+    double mu = 0;
+    double accepted_mu = 0;
+    double th1 = 1e-12;
+    double th2 = 1e-12;
+    double th3 = 1e-6;
+    double update_norm = 0;
+    double b_max = 0;
+    double rho = 0;
+    int current_iteration = 0;
+    //double cost = 0;
+    Eigen::VectorXd poseUpdate;
+
+    LOG_INFO("Optimization started!");
+    std::chrono::steady_clock::time_point solve_start = std::chrono::steady_clock::now();
+    this->summary.clear();
+    this->jacobian_evaluations = 0;
+    this->jacobian_relinearizations = 0;
+    this->model_evaluations = 0;
+    //the layout or the vertices may have changed since the last solve
+    this->estimates_valid = false;
+    if (!withinMemoryBudget()) {
+        finishSummary(solve_start);
+        return;
+    }
+
+    scoped_timer setup_timer(this->summary.setup_time);
+    this->implicit_solve = implicitSchurApplies();
+    this->sparse_solve = sparseSolveApplies();
+    prepareCovariance();
+
+    buildErrorVecndJacobian();
+
+    Eigen::VectorXd* errorVec_ = &this->errorVec;
+
+    Eigen::MatrixXd A;
+    Eigen::VectorXd b;
+    buildNormalEquations(A, b);
+    setup_timer.stop();
+    this->summary.initial_cost = errorVec_->squaredNorm();
+
+    //single and mixed precision keep A and its damped copy in float
+    bool low_precision = lowPrecision();
+    Eigen::MatrixXd A_temp;
+    Eigen::MatrixXf A_temp_float;
+    A_temp.resizeLike(A);
+
+    //a warm start continues with the damping the last solve ended with
+    if (this->warm_start && this->last_mu > 0)
+        mu = this->last_mu;
+    else
+        mu = th3 * (low_precision ? static_cast<double>(this->A_float.diagonal().maxCoeff()) : this->implicit_solve || this->sparse_solve ? this->A_diagonal.maxCoeff() : A.diagonal().maxCoeff());
+
+    LOG_DEBUG("initial mu: " << mu << " | Initial max error: " << errorVec_->maxCoeff());
+    if (Verbose)
+        traceLinearSystem(A, b, false);
+
+    b_max = abs(b.maxCoeff());
+
+    stop = b_max < th1;
+    double numerator = 0, denominator = 0;
+
+    Eigen::VectorXd tempErrorVec;
+
+    while (!stop && current_iteration < iterations) {
+		current_iteration++;
+        while (true) {
+            this->iteration_stats = iteration_statistics();
+            this->iteration_stats.iteration = current_iteration;
+            this->iteration_stats.mu = mu;
+            this->iteration_stats.gradient_max = b_max;
+
+            //solve the linear system
+            scoped_timer damping_timer(this->iteration_stats.assembly_time);
+            if (low_precision) {
+                A_temp_float = this->A_float;
+                A_temp_float.diagonal().array() += static_cast<float>(mu);
+            }
+            else if (!this->implicit_solve && !this->sparse_solve) {
+                A_temp = A + mu * Eigen::MatrixXd::Identity(A.rows(), A.cols());
+            }
+            damping_timer.stop();
+            if (low_precision)
+                solveLinearSystemFloat(A_temp_float, b, poseUpdate);
+            else if (this->implicit_solve)
+                solveImplicitSchur(this->weights, Eigen::VectorXd::Constant(b.size(), mu), b, poseUpdate);
+            else if (this->sparse_solve)
+                solveSparseSystem(mu, b, poseUpdate);
+            else
+                solveLinearSystem(A_temp, b, poseUpdate);
+            update_norm = poseUpdate.norm();
+            this->iteration_stats.step_norm = update_norm;
+            //print some info
+            if (update_norm < th2) {//th2 should be multiplied with the norm of the parameters
+                LOG_DEBUG("Update norm is less than threshold: " << update_norm << " < " << th2);
+                this->summary.termination = "update norm below threshold";
+                //the step is not taken, it is recorded at the current point
+                this->iteration_stats.cost = errorVec_->squaredNorm();
+                this->iteration_stats.rho = std::numeric_limits<double>::quiet_NaN();
+                recordIteration();
+                stop = true;
+                break;
+            }
+
+            //update vertex parameters
+            scoped_timer step_timer(this->iteration_stats.step_time);
+            this->updateEstimates(poseUpdate);
+
+            //calclate rho
+            buildErrorVector(tempErrorVec);
+            //std::cout<<"tempErrorVec: "<< (errorVec_->transpose() * *errorVec_ - tempErrorVec.transpose() * tempErrorVec) <<std::endl;
+            //std::cout << "poseUpdate: " << (poseUpdate.transpose() * mu * poseUpdate + poseUpdate.transpose() * b) << std::endl;
+            numerator = (errorVec_->transpose() * *errorVec_ - tempErrorVec.transpose() * tempErrorVec)[0];
+            denominator = (poseUpdate.transpose() * (mu*poseUpdate + b))[0];
+            rho = numerator / denominator;
+            step_timer.stop();
+            this->iteration_stats.rho = rho;
+            this->iteration_stats.cost = tempErrorVec.squaredNorm();
+
+            if (rho >= 0) {
+                this->iteration_stats.accepted = true;
+                buildErrorVecndJacobian();
+                scoped_timer assembly_timer(this->iteration_stats.assembly_time);
+                buildNormalEquations(A, b);
+                assembly_timer.stop();
+                b_max = abs(b.maxCoeff());
+
+                mu = mu * std::max(1.0 / 3, 1 - std::pow(2 * rho - 1, 3));
+                v = 2;
+                accepted_mu = mu;
+
+                if (b_max < th1) {
+					LOG_DEBUG("b_max is less than threshold: " << b_max << " < " << th1);
+                    this->summary.termination = "gradient below threshold";
+                    stop = b_max < th1;
+				}
+            }
+            else {
+                scoped_timer revert_timer(this->iteration_stats.step_time);
+                this->revertEstimates();
+                revert_timer.stop();
+                mu = mu * v;
+                v = 2 * v;
+            }
+            recordIteration();
+            if(rho > 0 || stop) break;
+        }
+    }
+    //rejections at the noise floor inflate mu, keep the damping of the last accepted step instead
+    if (accepted_mu > 0)
+        this->last_mu = accepted_mu;
+    this->implicit_solve = false;
+    this->sparse_solve = false;
+    finishSummary(solve_start);
+    LOG_INFO("Optimization finished: " << this->summary.termination << " | b max: " << b_max << " | update_norm: " << update_norm << " | Iterations: " << current_iteration);
+    LOG_INFO("Vertex jacobians differentiated: " << this->jacobian_relinearizations << " of " << this->jacobian_evaluations << " | model evaluations: " << this->model_evaluations);
+}
+
+
+void Optimization_General::initialize() {
+
+    if (BA_LOG_ENABLED(LogLevel::Info)) {
+        std::ostringstream sizes;
+        sizes << "edge_sizes: ";
+        for (const auto& edge_size : this->edge_sizes) {
+            sizes << edge_size << ", ";
+        }
+        sizes << " | ";
+        sizes << "vertex_sizes: ";
+        for (const auto& vertex_size : this->vertex_sizes) {
+            sizes << vertex_size << ", ";
+        }
+        LOG_INFO(sizes.str());
+    }
+
+    LOG_INFO("Total Vertices: " << temp_vertices.size()<< " | New Vertices: " << pending_vertices.size() << " | New Edges: " << pending_edges.size());
+
+    vertex_types.resize(vertex_sizes.size());
+    general_vertices.resize(vertex_sizes.size());
 
     int new_vertex_id;
     int fixed_vertex_id;
     int vertex_type;
     general_vertex* vertex_ptr;
 
-    for (auto& pair : temp_vertices) {
-        vertex_ptr = pair.second;
+    //small batches are appended to the existing topology, a rebuild is cheaper once the batch is as large as the graph
+    bool append = !this->dense_vertices.empty() && this->adjacency.getVertexCount() == this->dense_vertices.size()
+        && this->pending_edges.size() < this->general_edges.size();
+
+    //only what was added since the last call, in id order like the staging maps
+    std::sort(pending_vertices.begin(), pending_vertices.end(), [](general_vertex* a, general_vertex* b) { return a->getGlobalId() < b->getGlobalId(); });
+    std::sort(pending_edges.begin(), pending_edges.end(), [](general_edge* a, general_edge* b) { return a->getGlobalId() < b->getGlobalId(); });
+
+    for (general_vertex* pending_vertex : pending_vertices) {
+        vertex_ptr = pending_vertex;
         vertex_type = vertex_ptr->getType();
         vertex_types[vertex_type]++;
 
@@ -763,6 +1653,8 @@ void Optimization_General::initialize() {
 
             this->fixed_vertex_count = this->fixed_vertices.size();
 
+            if (append)
+                appendDenseVertex(vertex_ptr);
         }
         else {
             new_vertex_id = static_cast<int>(this->general_vertices[vertex_ptr->getType()].size());
@@ -771,6 +1663,20 @@ void Optimization_General::initialize() {
 
             // this->general_vertices_map.insert(std::make_pair(vertex_ptr->getGlobalId(), new_vertex_id));
 
+            if (append) {
+                //free vertices stay in front: the first fixed vertex moves to the end and the new one takes its place
+                int slot = static_cast<int>(this->vertex_count);
+                if (slot < static_cast<int>(this->dense_vertices.size())) {
+                    general_vertex* moved_ptr = this->dense_vertices[slot];
+                    appendDenseVertex(moved_ptr);
+                    this->adjacency.moveVertex(slot, moved_ptr->getDenseIndex());
+                    this->dense_vertices[slot] = vertex_ptr;
+                    vertex_ptr->setDenseIndex(slot);
+                }
+                else {
+                    appendDenseVertex(vertex_ptr);
+                }
+            }
             this->vertex_count += 1;
         }
     }
@@ -778,19 +1684,1542 @@ void Optimization_General::initialize() {
     int new_edge_id;
     general_edge* edge_ptr;
 
-    for (auto& pair : temp_edges) {
-        edge_ptr = pair.second;
+    for (general_edge* pending_edge : pending_edges) {
+        edge_ptr = pending_edge;
         new_edge_id = static_cast<int>(this->general_edges.size());
         edge_ptr->initialize(new_edge_id);
         this->general_edges.push_back(edge_ptr);
+        this->incremental_edges.push_back(edge_ptr);
         // this->general_edges_map.insert(std::make_pair(edge_ptr->getGlobalId(), new_edge_id));
         this->general_edge_count = new_edge_id + 1;
+        if (append)
+            this->adjacency.addEdge(edge_ptr->getFirstVertex()->getDenseIndex(), edge_ptr->getSecondVertex()->getDenseIndex());
+    }
+    pending_vertices.clear();
+    pending_edges.clear();
+    this->layout_valid = false;
+
+    //appends skip the problem summary, the memory check stays since new edges are what grows past the budget
+    if (!append) {
+        buildAdjacency();
+        printProblemSummary();
+    }
+    checkMemoryEstimate();
+}
+
+void Optimization_General::appendDenseVertex(general_vertex* vertex_ptr) {
+    vertex_ptr->setDenseIndex(this->adjacency.addVertex());
+    this->dense_vertices.push_back(vertex_ptr);
+}
+
+void Optimization_General::buildAdjacency() {
+    this->dense_vertices.clear();
+    this->dense_vertices.reserve(this->vertex_count + this->fixed_vertex_count);
+    for (auto& vertices : this->general_vertices) {
+        for (general_vertex* vertex_ptr : vertices) {
+            vertex_ptr->setDenseIndex(static_cast<int>(this->dense_vertices.size()));
+            this->dense_vertices.push_back(vertex_ptr);
+        }
+    }
+    for (general_vertex* vertex_ptr : this->fixed_vertices) {
+        vertex_ptr->setDenseIndex(static_cast<int>(this->dense_vertices.size()));
+        this->dense_vertices.push_back(vertex_ptr);
+    }
+
+    std::vector<int> edge_vertices;
+    edge_vertices.reserve(2 * this->general_edges.size());
+    for (general_edge* edge_ptr : this->general_edges) {
+        edge_vertices.push_back(edge_ptr->getFirstVertex()->getDenseIndex());
+        edge_vertices.push_back(edge_ptr->getSecondVertex()->getDenseIndex());
+    }
+    this->adjacency.build(this->dense_vertices.size(), edge_vertices);
+
+    //dense indices were reassigned, columns and the active set of the last layout no longer apply
+    this->vertex_columns.clear();
+    this->active_vertices.clear();
+}
+
+void Optimization_General::buildLayout() {
+    int free_count = static_cast<int>(this->vertex_count);
+    if (this->ordering_type == OrderingType::Natural) {
+        //appended vertices sit behind the others in the dense indices, the type blocks come from general_vertices
+        this->elimination_order.clear();
+        this->elimination_order.reserve(free_count);
+        for (auto& vertices : this->general_vertices) {
+            for (general_vertex* vertex_ptr : vertices)
+                this->elimination_order.push_back(vertex_ptr->getDenseIndex());
+        }
+    }
+    else {
+        this->elimination_order = computeVertexOrdering(this->adjacency, free_count, this->ordering_type);
+    }
+
+    if (!this->type_elimination_groups.empty()) {
+        std::vector<int> groups(free_count, 0);
+        for (int v = 0; v < free_count; v++) {
+            int vertex_type = this->dense_vertices[v]->getType();
+            if (vertex_type < static_cast<int>(this->type_elimination_groups.size()))
+                groups[v] = this->type_elimination_groups[vertex_type];
+        }
+        applyEliminationGroups(this->elimination_order, groups);
+    }
+
+    //columns follow the elimination order, fixed vertices get none
+    this->vertex_columns.assign(this->dense_vertices.size(), -1);
+    int column = 0;
+    for (int v : this->elimination_order) {
+        this->vertex_columns[v] = column;
+        column += this->vertex_sizes[this->dense_vertices[v]->getType()];
+    }
+    this->parameter_count = column;
+    this->active_vertices = this->elimination_order;
+    this->active_edges = this->general_edges;
+    this->layout_valid = true;
+    invalidateWarmStart();
+}
+
+void Optimization_General::invalidateWarmStart() {
+    //the linear system changed shape, nothing of the last solve carries over except the edge jacobians
+    this->last_mu = 0;
+    this->covariance_valid = false;
+    this->symbolic_valid = false;
+}
+
+void Optimization_General::buildIncrementalLayout() {
+    int free_count = static_cast<int>(this->vertex_count);
+    //only the columns of the last layout are set, clearing those keeps a small solve independent of the graph size
+    for (int v : this->active_vertices)
+        this->vertex_columns[v] = -1;
+    this->vertex_columns.resize(this->dense_vertices.size(), -1);
+    this->active_vertices.clear();
+
+    //seed with the free vertices of the new edges, vertex_columns doubles as the visited marker
+    auto activate = [&](int v) {
+        if (v < free_count && this->vertex_columns[v] < 0) {
+            this->vertex_columns[v] = 0;
+            this->active_vertices.push_back(v);
+        }
+        };
+    for (general_edge* edge_ptr : this->incremental_edges) {
+        activate(edge_ptr->getFirstVertex()->getDenseIndex());
+        activate(edge_ptr->getSecondVertex()->getDenseIndex());
+    }
+
+    //grow the affected region ring by ring
+    size_t ring_begin = 0;
+    for (int depth = 0; depth < this->incremental_depth; depth++) {
+        size_t ring_end = this->active_vertices.size();
+        for (size_t i = ring_begin; i < ring_end; i++) {
+            int v = this->active_vertices[i];
+            const int* neighbors = this->adjacency.getNeighbors(v);
+            for (int n = 0; n < this->adjacency.getNeighborCount(v); n++)
+                activate(neighbors[n]);
+        }
+        ring_begin = ring_end;
+    }
+
+    std::sort(this->active_vertices.begin(), this->active_vertices.end());
+    int column = 0;
+    for (int v : this->active_vertices) {
+        this->vertex_columns[v] = column;
+        column += this->vertex_sizes[this->dense_vertices[v]->getType()];
+    }
+    this->parameter_count = column;
+
+    //every edge touching an active vertex, the inactive end is held at its current estimate
+    std::vector<int> edge_indices;
+    for (int v : this->active_vertices) {
+        const int* edges = this->adjacency.getIncidentEdges(v);
+        edge_indices.insert(edge_indices.end(), edges, edges + this->adjacency.getDegree(v));
     }
+    std::sort(edge_indices.begin(), edge_indices.end());
+    edge_indices.erase(std::unique(edge_indices.begin(), edge_indices.end()), edge_indices.end());
+
+    this->active_edges.clear();
+    for (int e : edge_indices)
+        this->active_edges.push_back(this->general_edges[e]);
+
+    //a partial layout must never be reused by a full solve
+    this->layout_valid = false;
+    invalidateWarmStart();
+}
+
+size_t Optimization_General::getResidualRows() {
+    return this->edge_size * this->active_edges.size() + this->prior.getRows();
+}
 
-    std::cout << "Fixed vertices: " << this->fixed_vertex_count << "   |   Total Edges: " << this->general_edge_count << "\n";
-    std::cout << "#Vertex types: "<< this->general_vertices.size()<<" \n";
-    for (int i = 0; i < this->general_vertices.size(); i++) {
-		std::cout << "type " <<i << ": " << this->general_vertices[i].size() << "\n";
+void Optimization_General::appendPriorRows(Eigen::VectorXd* eVec, Eigen::MatrixXd* J, Eigen::MatrixXf* J_float) {
+    if (this->prior.isEmpty())
+        return;
+
+    int row_location = this->edge_size * static_cast<int>(this->active_edges.size());
+    int rows = this->prior.getRows();
+    if (eVec != nullptr) {
+        Eigen::VectorXd residual;
+        this->prior.computeResidual(residual);
+        eVec->segment(row_location, rows) = residual;
+    }
+    if (J == nullptr && J_float == nullptr)
+        return;
+
+    //vertices of the prior outside the active set are held at their estimate like any inactive vertex
+    const std::vector<general_vertex*>& vertices = this->prior.getVertices();
+    for (size_t i = 0; i < vertices.size(); i++) {
+        int column_location = this->vertex_columns[vertices[i]->getDenseIndex()];
+        if (column_location < 0)
+            continue;
+        int vertex_size = this->vertex_sizes[vertices[i]->getType()];
+        auto prior_block = this->prior.getJacobian().middleCols(this->prior.getVertexOffset(static_cast<int>(i)), vertex_size);
+        if (J != nullptr)
+            J->block(row_location, column_location, rows, vertex_size) = prior_block;
+        else
+            J_float->block(row_location, column_location, rows, vertex_size) = prior_block.cast<float>();
+    }
+}
+
+void Optimization_General::prepareCovariance() {
+    //the precision may have changed since the weights were built, e.g. marginal covariances are recovered in double
+    bool low_precision = lowPrecision();
+    bool held = low_precision ? this->weights_float.size() > 0 : this->weights.size() > 0;
+    if (this->warm_start && this->covariance_valid && held)
+        return;
+    if (low_precision) {
+        Eigen::VectorXd row_weights;
+        buildWeightVector(row_weights);
+        this->weights_float = row_weights.cast<float>();
+        this->weights.resize(0);
+    }
+    else {
+        buildWeightVector(this->weights);
+        this->weights_float.resize(0);
+    }
+    this->covariance_valid = true;
+}
+
+void Optimization_General::buildSparsePattern() {
+    //lower triangle of every hessian block the graph can fill, so the pattern does not depend on the values
+    std::vector<Eigen::Triplet<double>> entries;
+    auto addBlock = [&](general_vertex* row_vertex, general_vertex* col_vertex) {
+        int row = this->vertex_columns[row_vertex->getDenseIndex()];
+        int col = this->vertex_columns[col_vertex->getDenseIndex()];
+        if (row < 0 || col < 0 || row < col)
+            return;
+        int rows = this->vertex_sizes[row_vertex->getType()];
+        int cols = this->vertex_sizes[col_vertex->getType()];
+        for (int j = 0; j < cols; j++) {
+            for (int i = (row == col ? j : 0); i < rows; i++)
+                entries.emplace_back(row + i, col + j, 0.0);
+        }
+        };
+    for (int v : this->active_vertices) {
+        addBlock(this->dense_vertices[v], this->dense_vertices[v]);
+        const int* neighbors = this->adjacency.getNeighbors(v);
+        for (int n = 0; n < this->adjacency.getNeighborCount(v); n++)
+            addBlock(this->dense_vertices[neighbors[n]], this->dense_vertices[v]);
+    }
+    const std::vector<general_vertex*>& prior_vertices = this->prior.getVertices();
+    for (general_vertex* first : prior_vertices) {
+        for (general_vertex* second : prior_vertices)
+            addBlock(first, second);
+    }
+
+    this->sparse_A.resize(this->parameter_count, this->parameter_count);
+    this->sparse_A.setFromTriplets(entries.begin(), entries.end());
+    this->sparse_A.makeCompressed();
+}
+
+void Optimization_General::recordIteration() {
+    const iteration_statistics& stats = this->iteration_stats;
+    LOG_DEBUG("iteration " << stats.iteration << (stats.accepted ? " | accepted" : " | rejected") << " | cost: " << stats.cost
+        << " | b_max: " << stats.gradient_max << " | update_norm: " << stats.step_norm << " | mu: " << stats.mu << " | rho: " << stats.rho
+        << " | " << 1e3 * stats.totalTime() << " ms");
+    if (BA_LOG_ENABLED(LogLevel::Trace)) {
+        std::ostringstream parameters;
+        parameters << "Estimated param: ";
+        for (size_t i = 0; i < general_vertices.size(); i++) {
+            for (size_t j = 0; j < general_vertices[i].size(); j++) {
+                parameters << general_vertices[i][j]->getParameters().transpose() << ", ";
+            }
+        }
+        LOG_TRACE(parameters.str());
+    }
+    this->summary.iterations.push_back(this->iteration_stats);
+    if (this->callback)
+        this->callback(this->iteration_stats);
+}
+
+void Optimization_General::finishSummary(std::chrono::steady_clock::time_point solve_start) {
+    if (this->summary.termination.empty())
+        this->summary.termination = "maximum iterations reached";
+    this->summary.final_cost = this->errorVec.squaredNorm();
+    this->summary.jacobian_evaluations = this->jacobian_evaluations;
+    this->summary.jacobian_relinearizations = this->jacobian_relinearizations;
+    this->summary.model_evaluations = this->model_evaluations;
+    this->summary.total_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - solve_start).count();
+}
+
+void Optimization_General::buildNormalEquations(Eigen::MatrixXd& A, Eigen::VectorXd& b) {
+    if (this->implicit_solve || this->sparse_solve) {
+        //b and the diagonal of A over the edge blocks, every edge adds to the columns of its free vertices in edge order
+        A.resize(0, 0);
+        this->A_float.resize(0, 0);
+        b.setZero(this->parameter_count);
+        this->A_diagonal.setZero(this->parameter_count);
+        bool sparse = this->sparse_solve;
+        if (sparse) {
+            //the values are written into the fixed pattern, so it is analysed before the first assembly
+            if (!this->symbolic_valid) {
+                buildSparsePattern();
+                this->sparse_solver.analyzePattern(this->sparse_A);
+                this->symbolic_valid = true;
+            }
+            Eigen::Map<Eigen::VectorXd>(this->sparse_A.valuePtr(), this->sparse_A.nonZeros()).setZero();
+        }
+        //J_row^T W J_col into the lower triangle of sparse_A, the columns of a block are contiguous runs of its rows
+        auto addSparseBlock = [&](const Eigen::MatrixXd& J_row, int row_column, const Eigen::MatrixXd& J_col, int column, const Eigen::Ref<const Eigen::VectorXd>& row_weights) {
+            Eigen::MatrixXd block = J_row.transpose() * row_weights.asDiagonal() * J_col;
+            const int* inner = this->sparse_A.innerIndexPtr();
+            const int* outer = this->sparse_A.outerIndexPtr();
+            double* values = this->sparse_A.valuePtr();
+            for (int j = 0; j < block.cols(); j++) {
+                int first = row_column == column ? j : 0;
+                const int* position = std::lower_bound(inner + outer[column + j], inner + outer[column + j + 1], row_column + first);
+                for (int i = first; i < block.rows(); i++)
+                    values[position - inner + i - first] += block(i, j);
+            }
+            };
+        auto addBlock = [&](const Eigen::MatrixXd& J_block, int column, int row, int rows) {
+            auto row_weights = this->weights.segment(row, rows);
+            b.segment(column, J_block.cols()).noalias() -= J_block.transpose() * row_weights.cwiseProduct(this->errorVec.segment(row, rows));
+            if (!sparse)
+                this->A_diagonal.segment(column, J_block.cols()) += (J_block.array().square().colwise() * row_weights.array()).colwise().sum().matrix().transpose();
+            };
+        for (size_t k = 0; k < this->active_edges.size(); k++) {
+            general_vertex* vertices[2] = { this->active_edges[k]->getFirstVertex(), this->active_edges[k]->getSecondVertex() };
+            int row = static_cast<int>(k) * this->edge_size;
+            for (int s = 0; s < 2; s++) {
+                const Eigen::MatrixXd& J_block = this->edge_jacobians[2 * k + s];
+                if (J_block.size() == 0)
+                    continue;
+                int column = this->vertex_columns[vertices[s]->getDenseIndex()];
+                addBlock(J_block, column, row, this->edge_size);
+                if (!sparse)
+                    continue;
+                //every ordered pair of sides in the lower triangle, both vertices of an edge may share a column
+                for (int t = 0; t < 2; t++) {
+                    const Eigen::MatrixXd& J_other = this->edge_jacobians[2 * k + t];
+                    int other_column = this->vertex_columns[vertices[t]->getDenseIndex()];
+                    if (J_other.size() > 0 && column >= other_column)
+                        addSparseBlock(J_block, column, J_other, other_column, this->weights.segment(row, this->edge_size));
+                }
+            }
+        }
+        const std::vector<general_vertex*>& prior_vertices = this->prior.getVertices();
+        int prior_row = this->edge_size * static_cast<int>(this->active_edges.size());
+        auto priorBlock = [&](size_t i) -> Eigen::MatrixXd {
+            return this->prior.getJacobian().middleCols(this->prior.getVertexOffset(static_cast<int>(i)), this->vertex_sizes[prior_vertices[i]->getType()]);
+            };
+        for (size_t i = 0; i < prior_vertices.size(); i++) {
+            int column = this->vertex_columns[prior_vertices[i]->getDenseIndex()];
+            if (column < 0)
+                continue;
+            Eigen::MatrixXd J_block = priorBlock(i);
+            addBlock(J_block, column, prior_row, this->prior.getRows());
+            if (!sparse)
+                continue;
+            for (size_t j = 0; j < prior_vertices.size(); j++) {
+                int other_column = this->vertex_columns[prior_vertices[j]->getDenseIndex()];
+                if (other_column >= 0 && column >= other_column)
+                    addSparseBlock(J_block, column, priorBlock(j), other_column, this->weights.segment(prior_row, this->prior.getRows()));
+            }
+        }
+        //the undamped diagonal is the first entry of every column
+        if (sparse) {
+            for (int k = 0; k < this->sparse_A.outerSize(); k++)
+                this->A_diagonal[k] = this->sparse_A.valuePtr()[this->sparse_A.outerIndexPtr()[k]];
+        }
+        return;
+    }
+    if (lowPrecision()) {
+        //the products run in float, the gradient is accumulated in double over the float jacobian so the point lm
+        //converges to is not limited by float sums
+        const Eigen::MatrixXf& J = this->Jacobian_float;
+        this->A_float.noalias() = J.transpose() * this->weights_float.asDiagonal() * J;
+        A.resize(0, 0);
+        Eigen::VectorXd weighted_error = this->weights_float.cast<double>().cwiseProduct(this->errorVec);
+        b.resize(J.cols());
+        for (Eigen::Index c = 0; c < J.cols(); c++)
+            b(c) = -J.col(c).cast<double>().dot(weighted_error);
+        return;
+    }
+    this->A_float.resize(0, 0);
+    A.noalias() = this->Jacobian.transpose() * this->weights.asDiagonal() * this->Jacobian;
+    b.noalias() = -this->Jacobian.transpose() * this->weights.cwiseProduct(this->errorVec);
+}
+
+void Optimization_General::solveLinearSystem(const Eigen::MatrixXd& A, const Eigen::VectorXd& b, Eigen::VectorXd& x) {
+    //single and mixed precision solve A_float through solveLinearSystemFloat instead
+    if (this->linear_solver == LinearSolverType::ConjugateGradient) {
+        solveConjugateGradient(A, b, x);
+        return;
+    }
+    scoped_timer factorization_timer(this->iteration_stats.factorization_time);
+    if (this->linear_solver == LinearSolverType::SparseLDLT) {
+        //the columns are already permuted by the elimination order, the symbolic analysis lives as long as the layout
+        if (!this->symbolic_valid) {
+            buildSparsePattern();
+            this->sparse_solver.analyzePattern(this->sparse_A);
+            this->symbolic_valid = true;
+        }
+        for (int k = 0; k < this->sparse_A.outerSize(); k++) {
+            for (Eigen::SparseMatrix<double>::InnerIterator it(this->sparse_A, k); it; ++it)
+                it.valueRef() = A(it.row(), it.col());
+        }
+        this->sparse_solver.factorize(this->sparse_A);
+        factorization_timer.stop();
+
+        scoped_timer solve_timer(this->iteration_stats.solve_time);
+        x = this->sparse_solver.solve(b);
+    }
+    else {
+        Eigen::LDLT<Eigen::MatrixXd> ldlt(A);
+        factorization_timer.stop();
+
+        scoped_timer solve_timer(this->iteration_stats.solve_time);
+        x = ldlt.solve(b);
+    }
+}
+
+void Optimization_General::solveSparseSystem(double damping, const Eigen::VectorXd& b, Eigen::VectorXd& x) {
+    //sparse_A holds the values of buildNormalEquations, only its diagonal changes with the damping
+    scoped_timer factorization_timer(this->iteration_stats.factorization_time);
+    for (int k = 0; k < this->sparse_A.outerSize(); k++)
+        this->sparse_A.valuePtr()[this->sparse_A.outerIndexPtr()[k]] = this->A_diagonal[k] + damping;
+    this->sparse_solver.factorize(this->sparse_A);
+    factorization_timer.stop();
+
+    scoped_timer solve_timer(this->iteration_stats.solve_time);
+    x = this->sparse_solver.solve(b);
+}
+
+void Optimization_General::solveLinearSystemFloat(const Eigen::MatrixXf& A, const Eigen::VectorXd& b, Eigen::VectorXd& x) {
+    scoped_timer factorization_timer(this->iteration_stats.factorization_time);
+    bool sparse = this->linear_solver == LinearSolverType::SparseLDLT;
+    bool factorized;
+    Eigen::LDLT<Eigen::MatrixXf> ldlt;
+    if (sparse) {
+        if (!this->symbolic_valid) {
+            //only the float pattern is kept
+            buildSparsePattern();
+            this->sparse_A_float = this->sparse_A.cast<float>();
+            this->sparse_A = Eigen::SparseMatrix<double>();
+            this->sparse_solver_float.analyzePattern(this->sparse_A_float);
+            this->symbolic_valid = true;
+        }
+        for (int k = 0; k < this->sparse_A_float.outerSize(); k++) {
+            for (Eigen::SparseMatrix<float>::InnerIterator it(this->sparse_A_float, k); it; ++it)
+                it.valueRef() = A(it.row(), it.col());
+        }
+        this->sparse_solver_float.factorize(this->sparse_A_float);
+        factorized = this->sparse_solver_float.info() == Eigen::Success;
+    }
+    else {
+        ldlt.compute(A);
+        factorized = ldlt.info() == Eigen::Success;
+    }
+    factorization_timer.stop();
+
+    scoped_timer solve_timer(this->iteration_stats.solve_time);
+    auto solveFloat = [&](const Eigen::VectorXd& rhs) -> Eigen::VectorXd {
+        Eigen::VectorXf rhs_float = rhs.cast<float>();
+        Eigen::VectorXf x_float = sparse ? Eigen::VectorXf(this->sparse_solver_float.solve(rhs_float)) : Eigen::VectorXf(ldlt.solve(rhs_float));
+        return x_float.cast<double>();
+        };
+    if (factorized) {
+        x = solveFloat(b);
+        factorized = x.allFinite();
+    }
+    if (!factorized) {
+        //float ran out of range or pivots, this step is solved in double
+        LOG_WARNING("The float factorization of the normal equations failed, solving the step in double");
+        Eigen::LDLT<Eigen::MatrixXd> ldlt_double(A.cast<double>());
+        x = ldlt_double.solve(b);
+        if (ldlt_double.info() != Eigen::Success || !x.allFinite()) {
+            LOG_WARNING("The normal equations could not be factorized, no step taken");
+            x.setZero(b.size());
+        }
+        return;
+    }
+
+    //iterative refinement: the residual of the step is accumulated in double over the float matrix, its correction
+    //solved with the float factor
+    if (this->precision == SolverPrecision::Mixed) {
+        double target = 1e-12 * b.norm();
+        Eigen::VectorXd residual(b.size());
+        for (int k = 0; k < this->refinement_steps; k++) {
+            for (Eigen::Index i = 0; i < A.cols(); i++)
+                residual(i) = b(i) - A.col(i).cast<double>().dot(x); // A is symmetric
+            if (residual.norm() <= target)
+                break;
+            x += solveFloat(residual);
+        }
+    }
+}
+
+void Optimization_General::analyzeIterativeSolve() {
+    this->schur_valid = false;
+    this->schur_eliminated.clear();
+    this->schur_reduced.clear();
+    this->schur_offsets.assign(this->dense_vertices.size(), -1);
+    this->schur_size = 0;
+
+    bool schur = this->preconditioner_type == PreconditionerType::SchurJacobi || this->preconditioner_type == PreconditionerType::ClusterJacobi;
+    if (schur) {
+        //same default as buildLayout, types without a group are in group 0
+        auto groupOf = [&](int v) {
+            int vertex_type = this->dense_vertices[v]->getType();
+            return vertex_type < static_cast<int>(this->type_elimination_groups.size()) ? this->type_elimination_groups[vertex_type] : 0;
+            };
+        int lowest = std::numeric_limits<int>::max();
+        int highest = std::numeric_limits<int>::min();
+        for (int v : this->active_vertices) {
+            lowest = std::min(lowest, groupOf(v));
+            highest = std::max(highest, groupOf(v));
+        }
+
+        std::vector<char> eliminated(this->dense_vertices.size(), 0);
+        bool independent = lowest < highest;
+        for (int v : this->active_vertices) {
+            if (groupOf(v) == lowest) {
+                eliminated[v] = 1;
+                this->schur_eliminated.push_back(v);
+            }
+            else {
+                this->schur_reduced.push_back(v);
+            }
+        }
+        //A_ee is block diagonal only if no edge or prior couples two eliminated vertices
+        for (int v : this->schur_eliminated) {
+            const int* neighbors = this->adjacency.getNeighbors(v);
+            for (int n = 0; n < this->adjacency.getNeighborCount(v) && independent; n++)
+                independent = !(eliminated[neighbors[n]] && this->vertex_columns[neighbors[n]] >= 0);
+        }
+        for (general_vertex* vertex_ptr : this->prior.getVertices())
+            independent = independent && !eliminated[vertex_ptr->getDenseIndex()];
+
+        if (independent) {
+            for (int v : this->schur_reduced) {
+                this->schur_offsets[v] = this->schur_size;
+                this->schur_size += this->vertex_sizes[this->dense_vertices[v]->getType()];
+            }
+            this->schur_valid = true;
+        }
+        else {
+            LOG_WARNING("No independent elimination group for the schur preconditioner, using block jacobi on the full system");
+            this->schur_eliminated.clear();
+            this->schur_reduced.clear();
+        }
+    }
+
+    std::vector<std::vector<int>> blocks;
+    auto columnRange = [](int begin, int size) {
+        std::vector<int> indices(size);
+        for (int i = 0; i < size; i++)
+            indices[i] = begin + i;
+        return indices;
+        };
+    if (this->preconditioner_type == PreconditionerType::Jacobi) {
+        for (int i = 0; i < static_cast<int>(this->parameter_count); i++)
+            blocks.push_back({ i });
+    }
+    else if (!this->schur_valid) {
+        for (int v : this->active_vertices)
+            blocks.push_back(columnRange(this->vertex_columns[v], this->vertex_sizes[this->dense_vertices[v]->getType()]));
+    }
+    else if (this->preconditioner_type == PreconditionerType::SchurJacobi) {
+        for (int v : this->schur_reduced)
+            blocks.push_back(columnRange(this->schur_offsets[v], this->vertex_sizes[this->dense_vertices[v]->getType()]));
+    }
+    else {
+        //clusters over the positions in schur_reduced, coupled by the eliminated vertices they share
+        std::vector<int> position(this->dense_vertices.size(), -1);
+        for (size_t i = 0; i < this->schur_reduced.size(); i++)
+            position[this->schur_reduced[i]] = static_cast<int>(i);
+        std::vector<std::vector<int>> observers(this->schur_eliminated.size());
+        for (size_t k = 0; k < this->schur_eliminated.size(); k++) {
+            int l = this->schur_eliminated[k];
+            const int* neighbors = this->adjacency.getNeighbors(l);
+            for (int n = 0; n < this->adjacency.getNeighborCount(l); n++) {
+                if (position[neighbors[n]] >= 0)
+                    observers[k].push_back(position[neighbors[n]]);
+            }
+        }
+        for (const std::vector<int>& cluster : visibilityClusters(static_cast<int>(this->schur_reduced.size()), observers, this->cluster_size)) {
+            std::vector<int> indices;
+            for (int i : cluster) {
+                int v = this->schur_reduced[i];
+                std::vector<int> range = columnRange(this->schur_offsets[v], this->vertex_sizes[this->dense_vertices[v]->getType()]);
+                indices.insert(indices.end(), range.begin(), range.end());
+            }
+            blocks.push_back(indices);
+        }
+    }
+    this->preconditioner.setBlocks(std::move(blocks));
+    LOG_DEBUG("Iterative solve analysed | " << (this->schur_valid ? "reduced system of " + std::to_string(this->schur_size) + " rows, " : std::string("full system, "))
+        << this->preconditioner.getBlocks().size() << " preconditioner blocks");
+}
+
+bool Optimization_General::implicitSchurApplies() {
+    if (this->linear_solver != LinearSolverType::ConjugateGradient || !this->implicit_schur)
+        return false;
+    if (!this->symbolic_valid) {
+        analyzeIterativeSolve();
+        this->symbolic_valid = true;
+    }
+    return this->schur_valid;
+}
+
+void Optimization_General::invertEliminatedBlocks(const std::function<Eigen::MatrixXd(int)>& block, std::vector<Eigen::MatrixXd>& eliminated_inverses) {
+    eliminated_inverses.resize(this->schur_eliminated.size());
+    parallelFor(this->schur_eliminated.size(), this->num_threads, [&](size_t k) {
+        int size = this->vertex_sizes[this->dense_vertices[this->schur_eliminated[k]]->getType()];
+        Eigen::MatrixXd A_ll = block(this->schur_eliminated[k]);
+        Eigen::LLT<Eigen::MatrixXd> llt(A_ll);
+        if (llt.info() == Eigen::Success)
+            eliminated_inverses[k] = llt.solve(Eigen::MatrixXd::Identity(size, size));
+        else
+            eliminated_inverses[k] = A_ll.completeOrthogonalDecomposition().pseudoInverse(); // not observed enough, e.g. gauss newton
+        });
+}
+
+void Optimization_General::buildReducedSystem(const Eigen::MatrixXd& A, const Eigen::VectorXd& b, Eigen::MatrixXd& S, Eigen::VectorXd& b_reduced,
+    std::vector<Eigen::MatrixXd>& eliminated_inverses) {
+    S.resize(this->schur_size, this->schur_size);
+    b_reduced.resize(this->schur_size);
+    invertEliminatedBlocks([&](int l) {
+        int column = this->vertex_columns[l];
+        int size = this->vertex_sizes[this->dense_vertices[l]->getType()];
+        return Eigen::MatrixXd(A.block(column, column, size, size));
+        }, eliminated_inverses);
+
+    //reduced neighbours of every eliminated vertex in adjacency order (sorted by dense index) and W_i = A_il A_ll^-1
+    std::vector<int> eliminated_index(this->dense_vertices.size(), -1);
+    std::vector<size_t> observer_begin(this->schur_eliminated.size() + 1, 0);
+    std::vector<int> observer_vertex;
+    for (size_t k = 0; k < this->schur_eliminated.size(); k++) {
+        int l = this->schur_eliminated[k];
+        eliminated_index[l] = static_cast<int>(k);
+        const int* neighbors = this->adjacency.getNeighbors(l);
+        for (int n = 0; n < this->adjacency.getNeighborCount(l); n++) {
+            if (this->schur_offsets[neighbors[n]] >= 0)
+                observer_vertex.push_back(neighbors[n]);
+        }
+        observer_begin[k + 1] = observer_vertex.size();
+    }
+    std::vector<Eigen::MatrixXd> observer_W(observer_vertex.size());
+    parallelFor(this->schur_eliminated.size(), this->num_threads, [&](size_t k) {
+        int column = this->vertex_columns[this->schur_eliminated[k]];
+        int size = this->vertex_sizes[this->dense_vertices[this->schur_eliminated[k]]->getType()];
+        for (size_t p = observer_begin[k]; p < observer_begin[k + 1]; p++) {
+            int vi = observer_vertex[p];
+            int rows = this->vertex_sizes[this->dense_vertices[vi]->getType()];
+            observer_W[p].noalias() = A.block(this->vertex_columns[vi], column, rows, size) * eliminated_inverses[k];
+        }
+        });
+
+    //every reduced vertex owns its block row: S_ij = A_ij - sum_l W_il A_lj for the blocks left of the diagonal is summed
+    //by one thread over its eliminated neighbours in adjacency order and mirrored above the diagonal (column i, which no
+    //other row owner writes). no block has two writers and the order of every sum is fixed, so S is bitwise the same
+    //for any thread count
+    parallelFor(this->schur_reduced.size(), this->num_threads, [&](size_t r) {
+        int vi = this->schur_reduced[r];
+        int row = this->vertex_columns[vi];
+        int rows = this->vertex_sizes[this->dense_vertices[vi]->getType()];
+        int offset = this->schur_offsets[vi];
+        b_reduced.segment(offset, rows) = b.segment(row, rows);
+        for (int vj : this->schur_reduced) {
+            if (this->schur_offsets[vj] > offset)
+                continue;
+            int cols = this->vertex_sizes[this->dense_vertices[vj]->getType()];
+            S.block(offset, this->schur_offsets[vj], rows, cols) = A.block(row, this->vertex_columns[vj], rows, cols);
+        }
+
+        const int* neighbors = this->adjacency.getNeighbors(vi);
+        for (int n = 0; n < this->adjacency.getNeighborCount(vi); n++) {
+            int k = eliminated_index[neighbors[n]];
+            if (k < 0)
+                continue;
+            int column = this->vertex_columns[neighbors[n]];
+            int size = this->vertex_sizes[this->dense_vertices[neighbors[n]]->getType()];
+            const int* first = observer_vertex.data() + observer_begin[k];
+            const int* last = observer_vertex.data() + observer_begin[k + 1];
+            const Eigen::MatrixXd& W_i = observer_W[std::lower_bound(first, last, vi) - observer_vertex.data()];
+            b_reduced.segment(offset, rows).noalias() -= W_i * b.segment(column, size);
+            for (const int* vj = first; vj != last; vj++) {
+                if (this->schur_offsets[*vj] > offset)
+                    continue;
+                int cols = this->vertex_sizes[this->dense_vertices[*vj]->getType()];
+                S.block(offset, this->schur_offsets[*vj], rows, cols).noalias() -= W_i * A.block(column, this->vertex_columns[*vj], size, cols);
+            }
+        }
+
+        for (int vj : this->schur_reduced) {
+            if (this->schur_offsets[vj] >= offset)
+                continue;
+            int cols = this->vertex_sizes[this->dense_vertices[vj]->getType()];
+            S.block(this->schur_offsets[vj], offset, cols, rows) = S.block(offset, this->schur_offsets[vj], rows, cols).transpose();
+        }
+        });
+}
+
+void Optimization_General::solveConjugateGradient(const Eigen::MatrixXd& A, const Eigen::VectorXd& b, Eigen::VectorXd& x) {
+    //the analysis, the elimination and the preconditioner count as factorization, the cg iterations as solve
+    scoped_timer factorization_timer(this->iteration_stats.factorization_time);
+    if (!this->symbolic_valid) {
+        analyzeIterativeSolve();
+        this->symbolic_valid = true;
+    }
+    auto precondition = [this](const Eigen::VectorXd& r, Eigen::VectorXd& z) { this->preconditioner.apply(r, z); };
+
+    cg_summary result;
+    if (!this->schur_valid) {
+        this->preconditioner.compute(A, this->num_threads);
+        factorization_timer.stop();
+        scoped_timer solve_timer(this->iteration_stats.solve_time);
+        x.setZero(b.size());
+        result = conjugateGradient([&A](const Eigen::VectorXd& p, Eigen::VectorXd& Ap) { Ap.noalias() = A * p; }, precondition,
+            b, x, this->cg_max_iterations, this->cg_tolerance);
+    }
+    else {
+        Eigen::MatrixXd S;
+        Eigen::VectorXd b_reduced, x_reduced;
+        std::vector<Eigen::MatrixXd> eliminated_inverses;
+        buildReducedSystem(A, b, S, b_reduced, eliminated_inverses);
+        this->preconditioner.compute(S, this->num_threads);
+        factorization_timer.stop();
+
+        scoped_timer solve_timer(this->iteration_stats.solve_time);
+        result = conjugateGradient([&S](const Eigen::VectorXd& p, Eigen::VectorXd& Sp) { Sp.noalias() = S * p; }, precondition,
+            b_reduced, x_reduced, this->cg_max_iterations, this->cg_tolerance);
+
+        //back substitution: x_l = A_ll^-1 (b_l - sum_i A_li x_i)
+        x.setZero(b.size());
+        for (int v : this->schur_reduced) {
+            int size = this->vertex_sizes[this->dense_vertices[v]->getType()];
+            x.segment(this->vertex_columns[v], size) = x_reduced.segment(this->schur_offsets[v], size);
+        }
+        //every eliminated vertex writes only its own segment
+        parallelFor(this->schur_eliminated.size(), this->num_threads, [&](size_t k) {
+            int l = this->schur_eliminated[k];
+            int column = this->vertex_columns[l];
+            int size = this->vertex_sizes[this->dense_vertices[l]->getType()];
+            Eigen::VectorXd rhs = b.segment(column, size);
+            const int* neighbors = this->adjacency.getNeighbors(l);
+            for (int n = 0; n < this->adjacency.getNeighborCount(l); n++) {
+                int v = neighbors[n];
+                if (this->schur_offsets[v] < 0)
+                    continue;
+                int cols = this->vertex_sizes[this->dense_vertices[v]->getType()];
+                rhs.noalias() -= A.block(column, this->vertex_columns[v], size, cols) * x.segment(this->vertex_columns[v], cols);
+            }
+            x.segment(column, size).noalias() = eliminated_inverses[k] * rhs;
+            });
+    }
+    this->iteration_stats.linear_iterations += result.iterations;
+    if (!result.converged)
+        LOG_DEBUG("Conjugate gradients stopped after " << result.iterations << " iterations at relative residual " << result.relative_residual);
+}
+
+void Optimization_General::solveImplicitSchur(const Eigen::VectorXd& weights, const Eigen::VectorXd& damping, const Eigen::VectorXd& b, Eigen::VectorXd& x) {
+    scoped_timer factorization_timer(this->iteration_stats.factorization_time);
+    const std::vector<Eigen::MatrixXd>& J = this->edge_jacobians; // 2 e + side
+    int edge_rows = this->edge_size;
+
+    //role of both vertices of every active edge: offset in the reduced system, or offset among the eliminated vertices
+    std::vector<int> eliminated_offsets(this->dense_vertices.size(), -1);
+    std::vector<int> eliminated_index(this->dense_vertices.size(), -1);
+    int eliminated_size = 0;
+    for (size_t k = 0; k < this->schur_eliminated.size(); k++) {
+        int l = this->schur_eliminated[k];
+        eliminated_offsets[l] = eliminated_size;
+        eliminated_index[l] = static_cast<int>(k);
+        eliminated_size += this->vertex_sizes[this->dense_vertices[l]->getType()];
+    }
+    struct edge_block { int vertex, column, size, reduced, eliminated; };
+    std::vector<std::array<edge_block, 2>> edge_blocks(this->active_edges.size());
+    //edges at every free vertex in edge order as 2 e + side. the sums into a vertex block run over its own edges on one
+    //thread in this order, so the products do not depend on the thread count
+    std::vector<int> incidence_begin(this->dense_vertices.size() + 1, 0);
+    for (size_t e = 0; e < this->active_edges.size(); e++) {
+        general_vertex* vertices[2] = { this->active_edges[e]->getFirstVertex(), this->active_edges[e]->getSecondVertex() };
+        for (int s = 0; s < 2; s++) {
+            int v = vertices[s]->getDenseIndex();
+            int column = this->vertex_columns[v];
+            edge_blocks[e][s] = { v, column, this->vertex_sizes[vertices[s]->getType()], column < 0 ? -1 : this->schur_offsets[v], column < 0 ? -1 : eliminated_offsets[v] };
+            if (column >= 0)
+                incidence_begin[v + 1]++;
+        }
+    }
+    for (size_t v = 0; v < this->dense_vertices.size(); v++)
+        incidence_begin[v + 1] += incidence_begin[v];
+    std::vector<int> incidence(incidence_begin.back());
+    std::vector<int> incidence_next(incidence_begin.begin(), incidence_begin.end() - 1);
+    for (size_t e = 0; e < this->active_edges.size(); e++) {
+        for (int s = 0; s < 2; s++) {
+            int v = edge_blocks[e][s].vertex;
+            if (edge_blocks[e][s].column >= 0)
+                incidence[incidence_next[v]++] = static_cast<int>(2 * e) + s;
+        }
+    }
+    const size_t chunk_size = 64;
+    size_t edge_chunks = (edge_blocks.size() + chunk_size - 1) / chunk_size;
+    //prior rows only couple reduced vertices, analyzeIterativeSolve falls back otherwise. column is the one in the prior
+    int prior_row = edge_rows * static_cast<int>(this->active_edges.size());
+    int prior_rows = this->prior.getRows();
+    const Eigen::MatrixXd& J_prior = this->prior.getJacobian();
+    auto prior_weights = weights.segment(prior_row, prior_rows);
+    std::vector<edge_block> prior_blocks;
+    const std::vector<general_vertex*>& prior_vertices = this->prior.getVertices();
+    for (size_t i = 0; i < prior_vertices.size(); i++) {
+        int v = prior_vertices[i]->getDenseIndex();
+        if (this->vertex_columns[v] >= 0)
+            prior_blocks.push_back({ v, this->prior.getVertexOffset(static_cast<int>(i)), this->vertex_sizes[prior_vertices[i]->getType()], this->schur_offsets[v], -1 });
+    }
+
+    //A_ll = sum_e J_el^T W_e J_el + damping over the edges of every eliminated vertex. both sides of an edge on the same
+    //vertex add their cross terms, like the blocks summed into one column range of J
+    std::vector<Eigen::MatrixXd> eliminated_inverses;
+    invertEliminatedBlocks([&](int l) {
+        int column = this->vertex_columns[l];
+        int size = this->vertex_sizes[this->dense_vertices[l]->getType()];
+        Eigen::MatrixXd A_ll = damping.segment(column, size).asDiagonal();
+        for (int i = incidence_begin[l]; i < incidence_begin[l + 1]; i++) {
+            size_t e = incidence[i] / 2;
+            auto W_e = weights.segment(e * edge_rows, edge_rows).asDiagonal();
+            for (int s = 0; s < 2; s++) {
+                if (edge_blocks[e][s].vertex == l)
+                    A_ll.noalias() += J[incidence[i]].transpose() * W_e * J[2 * e + s];
+            }
+        }
+        return A_ll;
+        }, eliminated_inverses);
+
+    Eigen::VectorXd reduced_damping(this->schur_size);
+    for (int v : this->schur_reduced) {
+        int size = this->vertex_sizes[this->dense_vertices[v]->getType()];
+        reduced_damping.segment(this->schur_offsets[v], size) = damping.segment(this->vertex_columns[v], size);
+    }
+
+    //u_e = W_e J_er p_r over the edges and z = A_er p_r = sum_e J_el^T u_e over the edges of every eliminated vertex
+    Eigen::VectorXd u(edge_rows * edge_blocks.size()), w(edge_rows * edge_blocks.size()), z(eliminated_size), t(eliminated_size);
+    auto eliminatedProduct = [&](const Eigen::VectorXd& p) {
+        parallelFor(edge_chunks, this->num_threads, [&](size_t chunk) {
+            for (size_t e = chunk * chunk_size; e < std::min((chunk + 1) * chunk_size, edge_blocks.size()); e++) {
+                auto u_e = u.segment(e * edge_rows, edge_rows);
+                u_e.setZero();
+                for (int s = 0; s < 2; s++) {
+                    const edge_block& block = edge_blocks[e][s];
+                    if (block.reduced >= 0)
+                        u_e.noalias() += J[2 * e + s] * p.segment(block.reduced, block.size);
+                }
+                u_e.array() *= weights.segment(e * edge_rows, edge_rows).array();
+            }
+            });
+        parallelFor(this->schur_eliminated.size(), this->num_threads, [&](size_t k) {
+            int l = this->schur_eliminated[k];
+            auto z_l = z.segment(eliminated_offsets[l], this->vertex_sizes[this->dense_vertices[l]->getType()]);
+            z_l.setZero();
+            for (int i = incidence_begin[l]; i < incidence_begin[l + 1]; i++)
+                z_l.noalias() += J[incidence[i]].transpose() * u.segment(incidence[i] / 2 * edge_rows, edge_rows);
+            });
+        };
+    //y_r = sum_e J_er^T (u_e - W_e J_el t_l), the reduced side of the edges for a given t on the eliminated side
+    auto reducedProduct = [&](bool with_u, Eigen::VectorXd& y) {
+        parallelFor(edge_chunks, this->num_threads, [&](size_t chunk) {
+            for (size_t e = chunk * chunk_size; e < std::min((chunk + 1) * chunk_size, edge_blocks.size()); e++) {
+                auto w_e = w.segment(e * edge_rows, edge_rows);
+                w_e.setZero();
+                for (int s = 0; s < 2; s++) {
+                    const edge_block& block = edge_blocks[e][s];
+                    if (block.eliminated >= 0)
+                        w_e.noalias() -= J[2 * e + s] * t.segment(block.eliminated, block.size);
+                }
+                w_e.array() *= weights.segment(e * edge_rows, edge_rows).array();
+                if (with_u)
+                    w_e += u.segment(e * edge_rows, edge_rows);
+            }
+            });
+        parallelFor(this->schur_reduced.size(), this->num_threads, [&](size_t r) {
+            int v = this->schur_reduced[r];
+            for (int i = incidence_begin[v]; i < incidence_begin[v + 1]; i++) {
+                const edge_block& block = edge_blocks[incidence[i] / 2][incidence[i] % 2];
+                y.segment(block.reduced, block.size).noalias() += J[incidence[i]].transpose() * w.segment(incidence[i] / 2 * edge_rows, edge_rows);
+            }
+            });
+        };
+    auto applyInverses = [&](const Eigen::VectorXd& rhs) {
+        parallelFor(this->schur_eliminated.size(), this->num_threads, [&](size_t k) {
+            int offset = eliminated_offsets[this->schur_eliminated[k]];
+            t.segment(offset, eliminated_inverses[k].rows()).noalias() = eliminated_inverses[k] * rhs.segment(offset, eliminated_inverses[k].rows());
+            });
+        };
+    auto multiply = [&](const Eigen::VectorXd& p, Eigen::VectorXd& y) {
+        eliminatedProduct(p);
+        applyInverses(z);
+        y = reduced_damping.cwiseProduct(p);
+        reducedProduct(true, y);
+        if (!prior_blocks.empty()) {
+            Eigen::VectorXd prior_u = Eigen::VectorXd::Zero(prior_rows);
+            for (const edge_block& block : prior_blocks)
+                prior_u.noalias() += J_prior.middleCols(block.column, block.size) * p.segment(block.reduced, block.size);
+            prior_u.array() *= prior_weights.array();
+            for (const edge_block& block : prior_blocks)
+                y.segment(block.reduced, block.size).noalias() += J_prior.middleCols(block.column, block.size).transpose() * prior_u;
+        }
+        };
+
+    //b_r - A_re A_ee^-1 b_e
+    Eigen::VectorXd b_eliminated(eliminated_size), b_reduced(this->schur_size);
+    for (int l : this->schur_eliminated) {
+        int size = this->vertex_sizes[this->dense_vertices[l]->getType()];
+        b_eliminated.segment(eliminated_offsets[l], size) = b.segment(this->vertex_columns[l], size);
+    }
+    for (int v : this->schur_reduced) {
+        int size = this->vertex_sizes[this->dense_vertices[v]->getType()];
+        b_reduced.segment(this->schur_offsets[v], size) = b.segment(this->vertex_columns[v], size);
+    }
+    applyInverses(b_eliminated);
+    reducedProduct(false, b_reduced);
+
+    //preconditioner blocks of S over their reduced vertices: the A blocks of their edges and the prior minus the landmarks
+    //they share, all from the edge blocks. blocks are assembled on several threads, so all scratch is local to a block;
+    //blocks hold a few vertices, members are searched linearly
+    std::vector<int> offset_vertex(this->schur_size);
+    for (int v : this->schur_reduced) {
+        for (int i = 0; i < this->vertex_sizes[this->dense_vertices[v]->getType()]; i++)
+            offset_vertex[this->schur_offsets[v] + i] = v;
+    }
+    this->preconditioner.compute([&](size_t k) {
+        const std::vector<int>& indices = this->preconditioner.getBlocks()[k];
+        std::vector<int> members, positions;
+        auto position = [&](int v) {
+            auto found = std::find(members.begin(), members.end(), v);
+            return found == members.end() ? -1 : positions[found - members.begin()];
+            };
+        for (size_t i = 0; i < indices.size(); i++) {
+            int v = offset_vertex[indices[i]];
+            if (position(v) < 0) {
+                members.push_back(v);
+                positions.push_back(static_cast<int>(i));
+            }
+        }
+        Eigen::MatrixXd block = Eigen::MatrixXd::Zero(indices.size(), indices.size());
+        std::vector<int> touched;
+        for (size_t i = 0; i < members.size(); i++) {
+            int vi = members[i];
+            int rows = this->vertex_sizes[this->dense_vertices[vi]->getType()];
+            block.block(positions[i], positions[i], rows, rows).diagonal() += reduced_damping.segment(this->schur_offsets[vi], rows);
+            for (int a = incidence_begin[vi]; a < incidence_begin[vi + 1]; a++) {
+                size_t e = incidence[a] / 2;
+                auto W_e = weights.segment(e * edge_rows, edge_rows).asDiagonal();
+                for (int s = 0; s < 2; s++) {
+                    const edge_block& other = edge_blocks[e][s];
+                    if (other.eliminated >= 0)
+                        touched.push_back(other.vertex);
+                    int col = other.reduced < 0 ? -1 : position(other.vertex);
+                    if (col >= 0)
+                        block.block(positions[i], col, rows, other.size).noalias() += J[incidence[a]].transpose() * W_e * J[2 * e + s];
+                }
+            }
+        }
+        for (const edge_block& first : prior_blocks) {
+            int row = position(first.vertex);
+            for (const edge_block& second : prior_blocks) {
+                int col = position(second.vertex);
+                if (row >= 0 && col >= 0) {
+                    block.block(row, col, first.size, second.size).noalias() += J_prior.middleCols(first.column, first.size).transpose()
+                        * prior_weights.asDiagonal() * J_prior.middleCols(second.column, second.size);
+                }
+            }
+        }
+
+        std::sort(touched.begin(), touched.end());
+        touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+        for (int l : touched) {
+            //A_il of the members seen by l, summed over the edges of l
+            std::vector<int> rows_of;
+            std::vector<Eigen::MatrixXd> A_il;
+            for (int a = incidence_begin[l]; a < incidence_begin[l + 1]; a++) {
+                size_t e = incidence[a] / 2;
+                auto W_e = weights.segment(e * edge_rows, edge_rows).asDiagonal();
+                for (int s = 0; s < 2; s++) {
+                    const edge_block& other = edge_blocks[e][s];
+                    int row = other.reduced < 0 ? -1 : position(other.vertex);
+                    if (row < 0)
+                        continue;
+                    size_t p = std::find(rows_of.begin(), rows_of.end(), row) - rows_of.begin();
+                    if (p == rows_of.size()) {
+                        rows_of.push_back(row);
+                        A_il.push_back(Eigen::MatrixXd::Zero(other.size, J[incidence[a]].cols()));
+                    }
+                    A_il[p].noalias() += J[2 * e + s].transpose() * W_e * J[incidence[a]];
+                }
+            }
+            const Eigen::MatrixXd& inverse = eliminated_inverses[eliminated_index[l]];
+            for (size_t p = 0; p < rows_of.size(); p++) {
+                Eigen::MatrixXd W_i = A_il[p] * inverse;
+                for (size_t q = 0; q < rows_of.size(); q++)
+                    block.block(rows_of[p], rows_of[q], A_il[p].rows(), A_il[q].rows()).noalias() -= W_i * A_il[q].transpose();
+            }
+        }
+        return block;
+        }, this->num_threads);
+    factorization_timer.stop();
+
+    scoped_timer solve_timer(this->iteration_stats.solve_time);
+    Eigen::VectorXd x_reduced;
+    cg_summary result = conjugateGradient(multiply, [this](const Eigen::VectorXd& r, Eigen::VectorXd& z) { this->preconditioner.apply(r, z); },
+        b_reduced, x_reduced, this->cg_max_iterations, this->cg_tolerance);
+
+    //back substitution: x_e = A_ee^-1 (b_e - A_er x_r)
+    eliminatedProduct(x_reduced);
+    applyInverses(b_eliminated - z);
+    x.setZero(b.size());
+    for (int v : this->schur_reduced) {
+        int size = this->vertex_sizes[this->dense_vertices[v]->getType()];
+        x.segment(this->vertex_columns[v], size) = x_reduced.segment(this->schur_offsets[v], size);
+    }
+    for (int l : this->schur_eliminated) {
+        int size = this->vertex_sizes[this->dense_vertices[l]->getType()];
+        x.segment(this->vertex_columns[l], size) = t.segment(eliminated_offsets[l], size);
+    }
+    this->iteration_stats.linear_iterations += result.iterations;
+    if (!result.converged)
+        LOG_DEBUG("Conjugate gradients stopped after " << result.iterations << " iterations at relative residual " << result.relative_residual);
+}
+
+const graph_adjacency& Optimization_General::getAdjacency() {
+    return this->adjacency;
+}
+
+memory_usage Optimization_General::getMemoryUsage() {
+    memory_usage usage;
+    const size_t map_node = sizeof(std::pair<const int, void*>) + 4 * sizeof(void*); // red-black tree node
+
+    //graph objects, including the unused slots of the pools
+    usage.parameters = (this->vertex_pool.capacity() - this->vertex_pool.size()) * sizeof(general_vertex);
+    for (general_vertex* vertex_ptr : this->dense_vertices)
+        usage.parameters += vertex_ptr->getMemoryBytes();
+    for (general_vertex* vertex_ptr : this->pending_vertices)
+        usage.parameters += vertex_ptr->getMemoryBytes();
+    usage.edges = (this->edge_pool.capacity() - this->edge_pool.size()) * sizeof(general_edge);
+    for (general_edge* edge_ptr : this->general_edges)
+        usage.edges += edge_ptr->getMemoryBytes();
+    for (general_edge* edge_ptr : this->pending_edges)
+        usage.edges += edge_ptr->getMemoryBytes();
+
+    usage.graph = this->adjacency.getMemoryBytes() + (this->temp_vertices.size() + this->temp_edges.size()) * map_node
+        + vectorBytes(this->fixed_vertices) + vectorBytes(this->general_edges) + vectorBytes(this->pending_vertices)
+        + vectorBytes(this->pending_edges) + vectorBytes(this->incremental_edges) + vectorBytes(this->vertex_lookup)
+        + vectorBytes(this->edge_lookup) + vectorBytes(this->dense_vertices) + vectorBytes(this->elimination_order)
+        + vectorBytes(this->vertex_columns) + vectorBytes(this->active_vertices) + vectorBytes(this->active_edges)
+        + vectorBytes(this->schur_eliminated) + vectorBytes(this->schur_reduced) + vectorBytes(this->schur_offsets);
+    for (const auto& vertices : this->general_vertices)
+        usage.graph += vectorBytes(vertices);
+
+    //linear system
+    usage.jacobian = matrixBytes(this->Jacobian) + matrixBytes(this->Jacobian_float) + vectorBytes(this->edge_jacobians);
+    for (const Eigen::MatrixXd& J_block : this->edge_jacobians)
+        usage.jacobian += matrixBytes(J_block);
+    usage.covariance = matrixBytes(this->weights) + matrixBytes(this->weights_float);
+    usage.hessian = matrixBytes(this->A) + matrixBytes(this->A_float) + matrixBytes(this->A_diagonal) + this->sparse_A.nonZeros() * (sizeof(double) + sizeof(int)) + (this->sparse_A.outerSize() + 1) * sizeof(int)
+        + this->sparse_A_float.nonZeros() * (sizeof(float) + sizeof(int)) + (this->sparse_A_float.outerSize() + 1) * sizeof(int);
+    if (this->symbolic_valid && this->linear_solver == LinearSolverType::SparseLDLT) {
+        //diagonal, elimination tree and column counts next to L
+        if (!lowPrecision()) {
+            const auto& L = this->sparse_solver.matrixL().nestedExpression();
+            usage.factorization = L.nonZeros() * (sizeof(double) + sizeof(int)) + (L.outerSize() + 1) * sizeof(int) + L.outerSize() * (sizeof(double) + 2 * sizeof(int));
+        }
+        else {
+            const auto& L = this->sparse_solver_float.matrixL().nestedExpression();
+            usage.factorization = L.nonZeros() * (sizeof(float) + sizeof(int)) + (L.outerSize() + 1) * sizeof(int) + L.outerSize() * (sizeof(float) + 2 * sizeof(int));
+        }
+    }
+    usage.factorization += this->preconditioner.getMemoryBytes();
+    usage.workspace = matrixBytes(this->errorVec) + matrixBytes(this->edge_estimates) + matrixBytes(this->b)
+        + matrixBytes(this->deltaX) + this->prior.getMemoryBytes();
+    return usage;
+}
+
+size_t Optimization_General::countHessianEntries() {
+    size_t entries = 0;
+    int free_count = static_cast<int>(this->vertex_count);
+    for (int v = 0; v < free_count; v++) {
+        size_t size = this->vertex_sizes[this->dense_vertices[v]->getType()];
+        entries += size * (size + 1) / 2;
+        const int* neighbors = this->adjacency.getNeighbors(v);
+        for (int n = 0; n < this->adjacency.getNeighborCount(v); n++) {
+            if (neighbors[n] > v && neighbors[n] < free_count)
+                entries += size * this->vertex_sizes[this->dense_vertices[neighbors[n]]->getType()];
+        }
+    }
+    //the prior couples all of its vertices
+    size_t prior_columns = this->prior.getJacobian().cols();
+    return entries + prior_columns * (prior_columns + 1) / 2;
+}
+
+size_t Optimization_General::countFactorEntries() {
+    std::vector<int> position(this->dense_vertices.size(), -1);
+    for (size_t p = 0; p < this->active_vertices.size(); p++)
+        position[this->active_vertices[p]] = static_cast<int>(p);
+    std::vector<char> in_prior(this->dense_vertices.size(), 0);
+    for (general_vertex* vertex_ptr : this->prior.getVertices())
+        in_prior[vertex_ptr->getDenseIndex()] = 1;
+    std::vector<int> prior_positions;
+    for (general_vertex* vertex_ptr : this->prior.getVertices()) {
+        if (position[vertex_ptr->getDenseIndex()] >= 0)
+            prior_positions.push_back(position[vertex_ptr->getDenseIndex()]);
+    }
+
+    //the structure of a vertex is its later neighbours plus the structures of its children in the elimination tree,
+    //a child's structure is dropped once merged so only the frontier is held
+    size_t n = this->active_vertices.size();
+    std::vector<std::vector<int>> structure(n), children(n);
+    size_t entries = 0;
+    for (size_t p = 0; p < n; p++) {
+        int v = this->active_vertices[p];
+        std::vector<int> later;
+        const int* neighbors = this->adjacency.getNeighbors(v);
+        for (int i = 0; i < this->adjacency.getNeighborCount(v); i++) {
+            if (position[neighbors[i]] > static_cast<int>(p))
+                later.push_back(position[neighbors[i]]);
+        }
+        if (in_prior[v]) {
+            for (int q : prior_positions) {
+                if (q > static_cast<int>(p))
+                    later.push_back(q);
+            }
+        }
+        for (int child : children[p]) {
+            for (int q : structure[child]) {
+                if (q > static_cast<int>(p))
+                    later.push_back(q);
+            }
+            std::vector<int>().swap(structure[child]);
+        }
+        std::sort(later.begin(), later.end());
+        later.erase(std::unique(later.begin(), later.end()), later.end());
+
+        size_t size = this->vertex_sizes[this->dense_vertices[v]->getType()];
+        entries += size * (size + 1) / 2;
+        for (int q : later)
+            entries += size * this->vertex_sizes[this->dense_vertices[this->active_vertices[q]]->getType()];
+        if (!later.empty())
+            children[later.front()].push_back(static_cast<int>(p));
+        structure[p].swap(later);
+    }
+    return entries;
+}
+
+memory_usage Optimization_General::estimateSolveMemory(size_t rows, size_t columns) {
+    const size_t d = sizeof(double);
+    memory_usage estimate = this->getMemoryUsage();
+
+    //jacobian blocks of every edge with a free vertex: cached once warm starts or relinearization thresholds keep them,
+    //and held instead of J by the implicit schur and the double precision sparse solve
+    size_t block_bytes = 0;
+    for (general_edge* edge_ptr : this->general_edges) {
+        size_t columns_of_edge = 0;
+        if (!edge_ptr->getFirstVertex()->getFixed())
+            columns_of_edge += this->vertex_sizes[edge_ptr->getFirstVertex()->getType()];
+        if (!edge_ptr->getSecondVertex()->getFixed())
+            columns_of_edge += this->vertex_sizes[edge_ptr->getSecondVertex()->getType()];
+        block_bytes += columns_of_edge * this->edge_size * d;
+    }
+    if (this->warm_start || this->relinearize_threshold > 0)
+        estimate.edges += block_bytes;
+
+    //everything below is (re)allocated by the solve, so it replaces what is held.
+    //single and mixed precision hold J, W, A and the factor in float
+    bool low_precision = lowPrecision();
+    const size_t f = low_precision ? sizeof(float) : d; // scalar of J, W, A and the factor
+    estimate.jacobian = rows * columns * f;
+    estimate.covariance = rows * f; // the diagonal of W
+    estimate.hessian = 2 * columns * columns * f; // A and the damped copy
+    bool blocks = false;
+    if (this->linear_solver == LinearSolverType::SparseLDLT) {
+        size_t entries = this->countHessianEntries();
+        estimate.hessian += entries * (f + sizeof(int)) + (columns + 1) * sizeof(int);
+        if (!low_precision) {
+            //no J or dense A: the edge blocks, sparse_A and the diagonal of A
+            blocks = true;
+            estimate.jacobian = block_bytes;
+            estimate.hessian = entries * (d + sizeof(int)) + (columns + 1) * sizeof(int) + columns * d;
+        }
+        //the fill depends on the elimination order, only known once the layout is built
+        size_t factor_entries = this->layout_valid ? this->countFactorEntries() : entries;
+        estimate.factorization = factor_entries * (f + sizeof(int)) + (columns + 1) * sizeof(int) + columns * (f + 2 * sizeof(int));
+    }
+    else if (this->linear_solver == LinearSolverType::ConjugateGradient) {
+        //no factor: the preconditioner blocks, the reduced system of the schur preconditioners (two vectors per edge row
+        //and the edges at every vertex when it is implicit) and the cg vectors
+        size_t reduced = 0, block_entries = 0, eliminated_entries = 0;
+        int lowest = std::numeric_limits<int>::max();
+        int highest = std::numeric_limits<int>::min();
+        for (size_t t = 0; t < this->general_vertices.size(); t++) {
+            if (this->general_vertices[t].empty())
+                continue;
+            int group = t < this->type_elimination_groups.size() ? this->type_elimination_groups[t] : 0;
+            lowest = std::min(lowest, group);
+            highest = std::max(highest, group);
+        }
+        bool schur = (this->preconditioner_type == PreconditionerType::SchurJacobi || this->preconditioner_type == PreconditionerType::ClusterJacobi) && lowest < highest;
+        for (size_t t = 0; t < this->general_vertices.size(); t++) {
+            size_t size = this->vertex_sizes[t];
+            size_t count = this->general_vertices[t].size();
+            bool eliminated = (t < this->type_elimination_groups.size() ? this->type_elimination_groups[t] : 0) == lowest;
+            if (schur && eliminated) {
+                eliminated_entries += count * size * size;
+            }
+            else {
+                reduced += count * size;
+                block_entries += count * size * size;
+            }
+        }
+        if (this->preconditioner_type == PreconditionerType::Jacobi)
+            block_entries = columns;
+        else if (this->preconditioner_type == PreconditionerType::ClusterJacobi && schur)
+            block_entries *= this->cluster_size; // bound, clusters of at most cluster_size vertices
+        size_t reduced_system = !schur ? 0 : this->implicit_schur ? 2 * rows * d + 2 * this->general_edge_count * sizeof(int) : reduced * reduced * d;
+        estimate.factorization = (block_entries + eliminated_entries) * d + reduced_system + 5 * columns * d;
+        if (schur && this->implicit_schur) {
+            //no J or A: the edge blocks and the diagonal of A
+            blocks = true;
+            estimate.jacobian = block_bytes;
+            estimate.hessian = columns * d;
+        }
+    }
+    else {
+        estimate.factorization = columns * columns * f + columns * (f + sizeof(int));
+    }
+    //J^T W is evaluated into a columns x rows temporary on the way to A and b
+    estimate.workspace = (blocks ? 0 : columns * rows * f) + 4 * rows * d + 4 * columns * d + this->prior.getMemoryBytes();
+    return estimate;
+}
+
+memory_usage Optimization_General::estimateMemory() {
+    size_t rows = this->edge_size * this->general_edges.size() + this->prior.getRows();
+    size_t columns = 0;
+    for (const auto& vertices : this->general_vertices) {
+        for (general_vertex* vertex_ptr : vertices)
+            columns += this->vertex_sizes[vertex_ptr->getType()];
+    }
+    return this->estimateSolveMemory(rows, columns);
+}
+
+void Optimization_General::checkMemoryEstimate() {
+    if (this->memory_budget == 0 && !BA_LOG_ENABLED(LogLevel::Info))
+        return;
+    size_t estimate = this->estimateMemory().total();
+    double mb = 1.0 / (1024 * 1024);
+    LOG_INFO("Estimated solve memory: " << mb * estimate << " MB");
+    if (this->memory_budget > 0 && estimate > this->memory_budget)
+        LOG_WARNING("Estimated solve memory of " << mb * estimate << " MB is over the memory budget of " << mb * this->memory_budget << " MB, solves will be refused");
+}
+
+bool Optimization_General::withinMemoryBudget() {
+    if (this->memory_budget == 0)
+        return true;
+    size_t estimate = this->estimateSolveMemory(this->getResidualRows(), this->parameter_count).total();
+    if (estimate <= this->memory_budget)
+        return true;
+    double mb = 1.0 / (1024 * 1024);
+    LOG_ERROR("Solve needs an estimated " << mb * estimate << " MB, over the memory budget of " << mb * this->memory_budget << " MB");
+    this->summary.termination = "memory budget exceeded";
+    return false;
+}
+
+void Optimization_General::traceLinearSystem(const Eigen::MatrixXd& A, const Eigen::VectorXd& b, bool with_jacobian) {
+    if (this->implicit_solve) {
+        if (with_jacobian)
+            BA_LOG_UNFILTERED(LogLevel::Trace, "\nError vector: \n" << this->errorVec);
+        BA_LOG_UNFILTERED(LogLevel::Trace, "\nimplicit schur solve, the jacobian and the hessian are not assembled\nb vector: \n" << b.transpose());
+        return;
+    }
+    if (this->sparse_solve) {
+        if (with_jacobian)
+            BA_LOG_UNFILTERED(LogLevel::Trace, "\nError vector: \n" << this->errorVec);
+        BA_LOG_UNFILTERED(LogLevel::Trace, "\nHessian matrix (sparse, the jacobian is not assembled): \n" << Eigen::MatrixXd(Eigen::SparseMatrix<double>(this->sparse_A.selfadjointView<Eigen::Lower>()))
+            << "\nb vector: \n" << b.transpose());
+        return;
+    }
+    if (lowPrecision()) {
+        if (with_jacobian)
+            BA_LOG_UNFILTERED(LogLevel::Trace, "\nJacobian matrix (float): \n" << this->Jacobian_float << "\nError vector: \n" << this->errorVec);
+        BA_LOG_UNFILTERED(LogLevel::Trace, "\nHessian matrix (float): \n" << this->A_float << "\nb vector: \n" << b.transpose());
+        return;
+    }
+    if (with_jacobian)
+        BA_LOG_UNFILTERED(LogLevel::Trace, "\nJacobian matrix: \n" << this->Jacobian << "\nError vector: \n" << this->errorVec);
+    BA_LOG_UNFILTERED(LogLevel::Trace, "\nHessian matrix: \n" << A << "\nb vector: \n" << b.transpose());
+}
+
+void Optimization_General::printProblemSummary() {
+    if (!BA_LOG_ENABLED(LogLevel::Info))
+        return;
+    LOG_INFO("Fixed vertices: " << this->fixed_vertex_count << "   |   Total Edges: " << this->general_edge_count);
+    LOG_INFO("Hessian blocks (upper): " << this->adjacency.getHessianBlockCount(static_cast<int>(this->vertex_count)));
+    LOG_INFO("#Vertex types: "<< this->general_vertices.size());
+    for (size_t i = 0; i < this->general_vertices.size(); i++) {
+		LOG_INFO("type " <<i << ": " << this->general_vertices[i].size());
 	}
-    std::cout << "\n";
-}
\ No newline at end of file
+}
+
+bool Optimization_General::holdsProblem() {
+    return !temp_vertices.empty() || !temp_edges.empty() || !general_edges.empty() || !vertex_lookup.empty();
+}
+
+void Optimization_General::buildProblem(const problem_arrays& arrays) {
+    if (holdsProblem()) {
+        throw std::runtime_error("buildProblem: the optimizer already holds a problem");
+    }
+    if (arrays.parameters.size() != this->vertex_sizes.size() || arrays.vertex_counts.size() != this->vertex_sizes.size()) {
+        throw std::runtime_error("buildProblem: expected parameters and counts for " + std::to_string(this->vertex_sizes.size()) + " vertex types");
+    }
+
+    size_t total_vertices = 0;
+    for (size_t t = 0; t < arrays.vertex_counts.size(); t++) {
+        if (arrays.vertex_counts[t] > 0 && arrays.parameters[t] == nullptr) {
+            throw std::runtime_error("buildProblem: missing parameters for vertex type " + std::to_string(t));
+        }
+        total_vertices += arrays.vertex_counts[t];
+    }
+    if (total_vertices > static_cast<size_t>(std::numeric_limits<int>::max())) {
+        throw std::runtime_error("buildProblem: too many vertices");
+    }
+
+    //validate the edges before anything is created, a throw leaves the optimizer empty
+    if (arrays.edge_count > 0 && (arrays.measurements == nullptr || arrays.edge_vertices == nullptr)) {
+        throw std::runtime_error("buildProblem: edge_count is " + std::to_string(arrays.edge_count) + " but measurements or edge_vertices is missing");
+    }
+    for (size_t e = 0; e < arrays.edge_count; e++) {
+        int first = arrays.edge_vertices[2 * e];
+        int second = arrays.edge_vertices[2 * e + 1];
+        if (first < 0 || second < 0 || first >= static_cast<int>(total_vertices) || second >= static_cast<int>(total_vertices)) {
+            throw std::runtime_error("buildProblem: edge " + std::to_string(e) + " refers to a vertex outside the arrays");
+        }
+    }
+
+    //reserve everything up front
+    vertex_types.assign(vertex_sizes.size(), 0);
+    general_vertices.resize(vertex_sizes.size());
+    for (size_t t = 0; t < vertex_sizes.size(); t++)
+        general_vertices[t].reserve(arrays.vertex_counts[t]);
+    std::vector<general_vertex*> indexed_vertices;
+    indexed_vertices.reserve(total_vertices);
+    vertex_pool.reserve(total_vertices);
+    edge_pool.reserve(arrays.edge_count);
+    vertex_lookup.reserve(total_vertices);
+    general_edges.reserve(arrays.edge_count);
+    edge_lookup.reserve(arrays.edge_count);
+
+    //vertices, one linear pass over the type blocks
+    general_vertex* vertex_ptr;
+    size_t index = 0;
+    for (int t = 0; t < static_cast<int>(vertex_sizes.size()); t++) {
+        int size = vertex_sizes[t];
+        for (size_t i = 0; i < arrays.vertex_counts[t]; i++, index++) {
+            int id = arrays.vertex_ids ? arrays.vertex_ids[index] : static_cast<int>(index);
+            vertex_ptr = this->vertex_pool.create(id);
+            vertex_ptr->setType(t);
+            vertex_ptr->setParameters(Eigen::Map<const Eigen::VectorXd>(arrays.parameters[t] + i * size, size));
+            vertex_ptr->setFixed(arrays.vertex_fixed && arrays.vertex_fixed[index]);
+            vertex_types[t]++;
+
+            if (vertex_ptr->getFixed()) {
+                vertex_ptr->setId(-1 * static_cast<int>(this->fixed_vertices.size()) - 1);
+                this->fixed_vertices.push_back(vertex_ptr);
+            }
+            else {
+                vertex_ptr->setId(static_cast<int>(this->general_vertices[t].size()));
+                this->general_vertices[t].push_back(vertex_ptr);
+                this->vertex_count += 1;
+            }
+            indexed_vertices.push_back(vertex_ptr);
+            vertex_lookup.emplace_back(id, vertex_ptr);
+        }
+    }
+    this->fixed_vertex_count = this->fixed_vertices.size();
+
+    //edges, ids are assigned in array order
+    general_edge* edge_ptr;
+    for (size_t e = 0; e < arrays.edge_count; e++) {
+        int first = arrays.edge_vertices[2 * e];
+        int second = arrays.edge_vertices[2 * e + 1];
+        int id = arrays.edge_ids ? arrays.edge_ids[e] : static_cast<int>(e);
+        edge_ptr = this->edge_pool.create(id);
+        edge_ptr->setMeasurement(Eigen::Map<const Eigen::VectorXd>(arrays.measurements + e * this->edge_size, this->edge_size), arrays.w_sigmas ? arrays.w_sigmas[e] : arrays.w_sigma);
+        edge_ptr->setFirstVertex(indexed_vertices[first]);
+        edge_ptr->setSecondVertex(indexed_vertices[second]);
+        edge_ptr->initialize(static_cast<int>(e));
+        this->general_edges.push_back(edge_ptr);
+        edge_lookup.emplace_back(id, edge_ptr);
+    }
+    this->general_edge_count = this->general_edges.size();
+    this->incremental_edges = this->general_edges;
+
+    //ids usually arrive sorted, only sort when they do not
+    auto by_id = [](const auto& a, const auto& b) { return a.first < b.first; };
+    if (!std::is_sorted(vertex_lookup.begin(), vertex_lookup.end(), by_id))
+        std::sort(vertex_lookup.begin(), vertex_lookup.end(), by_id);
+    if (!std::is_sorted(edge_lookup.begin(), edge_lookup.end(), by_id))
+        std::sort(edge_lookup.begin(), edge_lookup.end(), by_id);
+
+    //a duplicated id would resolve to either object in the lookups, the optimizer is left empty like the other throws
+    auto same_id = [](const auto& a, const auto& b) { return a.first == b.first; };
+    auto vertex_duplicate = std::adjacent_find(vertex_lookup.begin(), vertex_lookup.end(), same_id);
+    if (vertex_duplicate != vertex_lookup.end()) {
+        int id = vertex_duplicate->first;
+        reset();
+        throw std::runtime_error("buildProblem: vertex id " + std::to_string(id) + " is used more than once");
+    }
+    auto edge_duplicate = std::adjacent_find(edge_lookup.begin(), edge_lookup.end(), same_id);
+    if (edge_duplicate != edge_lookup.end()) {
+        int id = edge_duplicate->first;
+        reset();
+        throw std::runtime_error("buildProblem: edge id " + std::to_string(id) + " is used more than once");
+    }
+
+    buildAdjacency();
+    this->layout_valid = false;
+    printProblemSummary();
+    checkMemoryEstimate();
+}
+
+void Optimization_General::saveSnapshot(const std::string& path) {
+    problem_snapshot::contents data;
+    data.edge_size = this->edge_size;
+    data.vertex_sizes.assign(this->vertex_sizes.begin(), this->vertex_sizes.end());
+    data.vertex_counts.assign(this->vertex_sizes.size(), 0);
+
+    //staged and bulk built objects, ascending by id
+    std::vector<std::pair<int, general_vertex*>> vertices(temp_vertices.begin(), temp_vertices.end());
+    vertices.insert(vertices.end(), vertex_lookup.begin(), vertex_lookup.end());
+    std::vector<std::pair<int, general_edge*>> edges(temp_edges.begin(), temp_edges.end());
+    edges.insert(edges.end(), edge_lookup.begin(), edge_lookup.end());
+    auto by_id = [](const auto& a, const auto& b) { return a.first < b.first; };
+    std::sort(vertices.begin(), vertices.end(), by_id);
+    std::sort(edges.begin(), edges.end(), by_id);
+
+    //group the vertices by type, ascending by id inside a type
+    std::vector<std::vector<general_vertex*>> vertices_by_type(this->vertex_sizes.size());
+    for (auto& pair : vertices) {
+        general_vertex* vertex_ptr = pair.second;
+        int vertex_type = vertex_ptr->getType();
+        if (vertex_type < 0 || vertex_type >= static_cast<int>(vertices_by_type.size())
+            || vertex_ptr->getParameters().size() != this->vertex_sizes[vertex_type]) {
+            throw std::runtime_error("Snapshot: vertex " + std::to_string(pair.first) + " does not match vertex_sizes");
+        }
+        vertices_by_type[vertex_type].push_back(vertex_ptr);
+    }
+
+    std::unordered_map<general_vertex*, int32_t> vertex_index;
+    vertex_index.reserve(vertices.size());
+    for (size_t t = 0; t < vertices_by_type.size(); t++) {
+        data.vertex_counts[t] = vertices_by_type[t].size();
+        for (general_vertex* vertex_ptr : vertices_by_type[t]) {
+            vertex_index[vertex_ptr] = static_cast<int32_t>(data.vertex_ids.size());
+            data.vertex_ids.push_back(vertex_ptr->getGlobalId());
+            data.vertex_fixed.push_back(vertex_ptr->getFixed() ? 1 : 0);
+            const Eigen::VectorXd& parameters = vertex_ptr->getParameters();
+            data.parameters.insert(data.parameters.end(), parameters.data(), parameters.data() + parameters.size());
+        }
+    }
+
+    for (auto& pair : edges) {
+        general_edge* edge_ptr = pair.second;
+        if (!edge_ptr->getIsInitialized()) {
+            throw std::runtime_error("Snapshot: edge " + std::to_string(pair.first) + " is not initialized, call initialize() first");
+        }
+        auto first = vertex_index.find(edge_ptr->getFirstVertex());
+        auto second = vertex_index.find(edge_ptr->getSecondVertex());
+        if (first == vertex_index.end() || second == vertex_index.end()) {
+            throw std::runtime_error("Snapshot: edge " + std::to_string(pair.first) + " refers to a removed vertex");
+        }
+        Eigen::VectorXd measurement = edge_ptr->getMeasurement();
+        if (measurement.size() != this->edge_size) {
+            throw std::runtime_error("Snapshot: edge " + std::to_string(pair.first) + " does not match edge_size");
+        }
+        data.edge_ids.push_back(edge_ptr->getGlobalId());
+        data.edge_vertices.push_back(first->second);
+        data.edge_vertices.push_back(second->second);
+        data.measurements.insert(data.measurements.end(), measurement.data(), measurement.data() + measurement.size());
+        data.w_sigmas.push_back(edge_ptr->getSigma());
+    }
+
+    //the prior of a sliding window is part of the cost, a reload without it would solve a different problem
+    if (!this->prior.isEmpty()) {
+        for (general_vertex* vertex_ptr : this->prior.getVertices()) {
+            auto index = vertex_index.find(vertex_ptr);
+            if (index == vertex_index.end()) {
+                throw std::runtime_error("Snapshot: the marginal prior refers to a removed vertex");
+            }
+            data.prior_vertices.push_back(index->second);
+        }
+        const Eigen::VectorXd& linearization_point = this->prior.getLinearizationPoint();
+        const Eigen::VectorXd& residual0 = this->prior.getResidual0();
+        problem_snapshot::RowMatrixXd jacobian = this->prior.getJacobian();
+        data.prior_linearization_point.assign(linearization_point.data(), linearization_point.data() + linearization_point.size());
+        data.prior_jacobian.assign(jacobian.data(), jacobian.data() + jacobian.size());
+        data.prior_residual.assign(residual0.data(), residual0.data() + residual0.size());
+    }
+
+    problem_snapshot::write(path, data);
+}
+
+void Optimization_General::loadSnapshot(const problem_snapshot& snapshot) {
+    if (!snapshot.isOpen()) {
+        throw std::runtime_error("Snapshot: not open");
+    }
+    //checked here as well, the size tables below belong to the problem already held
+    if (holdsProblem()) {
+        throw std::runtime_error("loadSnapshot: the optimizer already holds a problem");
+    }
+
+    this->vertex_sizes.clear();
+    for (int t = 0; t < snapshot.getVertexTypeCount(); t++)
+        this->vertex_sizes.push_back(snapshot.getVertexSize(t));
+    this->edge_sizes = { snapshot.getEdgeSize() };
+    this->edge_size = snapshot.getEdgeSize();
+    this->vertex_size = this->vertex_sizes.empty() ? 0 : this->vertex_sizes[0];
+
+    //the builder reads straight from the mapped views
+    problem_arrays arrays;
+    for (int t = 0; t < snapshot.getVertexTypeCount(); t++) {
+        arrays.parameters.push_back(snapshot.getParameters(t).data());
+        arrays.vertex_counts.push_back(snapshot.getVertexCount(t));
+    }
+    arrays.vertex_ids = snapshot.getVertexIds().data();
+    arrays.vertex_fixed = snapshot.getVertexFixed();
+    arrays.edge_count = snapshot.getEdgeCount();
+    arrays.measurements = snapshot.getMeasurements().data();
+    arrays.w_sigmas = snapshot.getSigmas().data();
+    arrays.edge_vertices = snapshot.getEdgeVertices().data();
+    arrays.edge_ids = snapshot.getEdgeIds().data();
+
+    this->buildProblem(arrays);
+
+    auto prior_vertices = snapshot.getPriorVertices();
+    if (prior_vertices.size() > 0) {
+        std::vector<general_vertex*> vertices;
+        for (Eigen::Index i = 0; i < prior_vertices.size(); i++)
+            vertices.push_back(findVertex(snapshot.getVertexIds()[prior_vertices[i]]));
+        this->prior.assign(vertices, snapshot.getPriorLinearizationPoint(), snapshot.getPriorJacobian(), snapshot.getPriorResidual());
+        this->layout_valid = false;
+    }
+}
+
+void Optimization_General::loadSnapshot(const std::string& path) {
+    problem_snapshot snapshot(path);
+    this->loadSnapshot(snapshot);
+}
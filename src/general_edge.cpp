@@ -1,4 +1,5 @@
 #include "../include/general_edge.h"
+#include "../include/logger.h"
 
 general_edge::general_edge(int global_id) : global_id(global_id) {
     this->id = -1;
@@ -69,7 +70,7 @@ Eigen::VectorXd general_edge::getMeasurement()
     }
     else
     {
-        std::cout << "Edge not initialized" << std::endl;
+        LOG_ERROR("Edge not initialized");
         throw std::runtime_error("Edge not initialized");
     }
 }
@@ -82,11 +83,16 @@ double general_edge::getCovariance()
     }
     else
     {
-        std::cout << "Edge not initialized" << std::endl;
+        LOG_ERROR("Edge not initialized");
         throw std::runtime_error("Edge not initialized");
     }
 }
 
+double general_edge::getSigma()
+{
+    return this->w_sigma;
+}
+
 void general_edge::initialize(int id)
 {
     if (!this->isInitialized)
@@ -120,11 +126,40 @@ void general_edge::initialize(int id)
     }
     else
     {
-        std::cout << "Edge " << id << " : already initialized" << std::endl;
+        LOG_WARNING("Edge " << id << " : already initialized");
     }
 }
 
+void general_edge::cacheJacobian(int slot, const Eigen::MatrixXd& J)
+{
+    this->jacobians[slot] = J;
+    this->linearization_travel[slot][0] = this->first_vertex_ptr->getTravel();
+    this->linearization_travel[slot][1] = this->second_vertex_ptr->getTravel();
+    this->jacobian_cached[slot] = true;
+}
+
+bool general_edge::getCachedJacobian(int slot, double threshold, Eigen::MatrixXd& J)
+{
+    if (!this->jacobian_cached[slot])
+        return false;
+    if (this->first_vertex_ptr->getTravel() - this->linearization_travel[slot][0] > threshold
+        || this->second_vertex_ptr->getTravel() - this->linearization_travel[slot][1] > threshold)
+        return false;
+    J = this->jacobians[slot];
+    return true;
+}
+
+void general_edge::clearJacobianCache()
+{
+    this->jacobian_cached[0] = false;
+    this->jacobian_cached[1] = false;
+}
+
 bool general_edge::getIsInitialized()
 {
     return this->isInitialized;
-}
\ No newline at end of file
+}
+size_t general_edge::getMemoryBytes()
+{
+    return sizeof(general_edge) + (this->measurement.size() + this->jacobians[0].size() + this->jacobians[1].size()) * sizeof(double);
+}
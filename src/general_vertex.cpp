@@ -9,7 +9,7 @@ void general_vertex::initialize(int id)
 }
 
 general_vertex::general_vertex(int g_id, int id, int vertex_type) : id(id), global_id(g_id), vertex_type(vertex_type),
-                isInitialized(false),isFixed(false),temp_id(-1){
+                travel(0), previous_travel(0), dense_index(-1), isInitialized(false),isFixed(false),temp_id(-1){
  /*   this->isInitialized = false;
     this->isFixed = false;
     this->temp_id = -1;*/
@@ -18,6 +18,9 @@ general_vertex::general_vertex(int g_id, int id, int vertex_type) : id(id), glob
 general_vertex::general_vertex(int g_id) : global_id(g_id) {
     this->id = std::numeric_limits<int>::min();
     this->vertex_type = -20;
+    this->travel = 0;
+    this->previous_travel = 0;
+    this->dense_index = -1;
     this->isInitialized = false;
     this->isFixed = false;
     this->temp_id = -1;
@@ -49,18 +52,28 @@ int general_vertex::getGlobalId()
 // Parameters
 void general_vertex::setParameters(const Eigen::VectorXd& parameters)
 {
+    if (parameters.size() == this->parameters.size())
+        this->travel += (parameters - this->parameters).norm();
     this->parameters = parameters;
 }
 
 void general_vertex::updateParameters(const Eigen::VectorXd& parametersUpdate)
 {
     this->previous_parameters = this->parameters;
+    this->previous_travel = this->travel;
     this->parameters = this->parameters + parametersUpdate;
+    this->travel += parametersUpdate.norm();
 }
 
 void general_vertex::revertParameters()
 {
     this->parameters = this->previous_parameters;
+    this->travel = this->previous_travel;
+}
+
+double general_vertex::getTravel()
+{
+    return this->travel;
 }
 
 Eigen::VectorXd general_vertex::getParameters()
@@ -72,20 +85,18 @@ Eigen::VectorXd general_vertex::getParameters()
 void general_vertex::addEdge(general_edge* edge, general_vertex* general_vertex_ptr)
 {
     if (!this->isInitialized) {
-        this->attached_edges.insert(std::make_pair(edge->getId(), edge));
-        this->attached_vertices.insert(std::make_pair(general_vertex_ptr->getId(), general_vertex_ptr));
         this->initialize(temp_id);
     }
 }
 
-const std::map<int, general_edge*> general_vertex::getAttachedEdges()
+void general_vertex::setDenseIndex(int dense_index)
 {
-    return this->attached_edges;
+    this->dense_index = dense_index;
 }
 
-const std::map<int, general_vertex*> general_vertex::getAttachedVertices()
+int general_vertex::getDenseIndex()
 {
-    return this->attached_vertices;
+    return this->dense_index;
 }
 
 // Fixedness
@@ -108,4 +119,8 @@ bool general_vertex::getInitialized()
 void general_vertex::setId(int id)
 {
     this->temp_id = id;
-}
\ No newline at end of file
+}
+size_t general_vertex::getMemoryBytes()
+{
+    return sizeof(general_vertex) + (this->parameters.size() + this->previous_parameters.size()) * sizeof(double);
+}
@@ -0,0 +1,196 @@
+#include "graph_adjacency.h"
+#include "memory_usage.h"
+
+#include <algorithm>
+
+graph_adjacency::graph_adjacency() : vertex_count(0), edge_count(0) {}
+
+void graph_adjacency::build(size_t vertex_count, const std::vector<int>& edge_vertices) {
+    this->vertex_count = vertex_count;
+    this->edge_count = edge_vertices.size() / 2;
+
+    //count degrees, prefix sum, then scatter. segments are packed without slack
+    this->degrees.assign(vertex_count, 0);
+    for (int v : edge_vertices)
+        this->degrees[v]++;
+    this->incidence_offsets.resize(vertex_count);
+    int offset = 0;
+    for (size_t v = 0; v < vertex_count; v++) {
+        this->incidence_offsets[v] = offset;
+        offset += this->degrees[v];
+    }
+    this->incidence_capacity = this->degrees;
+
+    this->incident_edges.resize(edge_vertices.size());
+    std::vector<int> fill(this->incidence_offsets);
+    for (size_t e = 0; e < this->edge_count; e++) {
+        this->incident_edges[fill[edge_vertices[2 * e]]++] = static_cast<int>(e);
+        this->incident_edges[fill[edge_vertices[2 * e + 1]]++] = static_cast<int>(e);
+    }
+
+    //unique sorted neighbours per vertex, the other end of every incident edge
+    this->neighbor_offsets.resize(vertex_count);
+    this->neighbor_counts.resize(vertex_count);
+    this->neighbors.clear();
+    this->neighbors.reserve(this->incident_edges.size());
+    for (size_t v = 0; v < vertex_count; v++) {
+        size_t begin = this->neighbors.size();
+        for (int i = this->incidence_offsets[v]; i < this->incidence_offsets[v] + this->degrees[v]; i++) {
+            int e = this->incident_edges[i];
+            int other = edge_vertices[2 * e] == static_cast<int>(v) ? edge_vertices[2 * e + 1] : edge_vertices[2 * e];
+            if (other != static_cast<int>(v))
+                this->neighbors.push_back(other);
+        }
+        std::sort(this->neighbors.begin() + begin, this->neighbors.end());
+        this->neighbors.erase(std::unique(this->neighbors.begin() + begin, this->neighbors.end()), this->neighbors.end());
+        this->neighbor_offsets[v] = static_cast<int>(begin);
+        this->neighbor_counts[v] = static_cast<int>(this->neighbors.size() - begin);
+    }
+    this->neighbor_capacity = this->neighbor_counts;
+}
+
+void graph_adjacency::clear() {
+    this->vertex_count = 0;
+    this->edge_count = 0;
+    this->incidence_offsets.clear();
+    this->degrees.clear();
+    this->incidence_capacity.clear();
+    this->incident_edges.clear();
+    this->neighbor_offsets.clear();
+    this->neighbor_counts.clear();
+    this->neighbor_capacity.clear();
+    this->neighbors.clear();
+}
+
+int graph_adjacency::addVertex() {
+    this->incidence_offsets.push_back(static_cast<int>(this->incident_edges.size()));
+    this->degrees.push_back(0);
+    this->incidence_capacity.push_back(0);
+    this->neighbor_offsets.push_back(static_cast<int>(this->neighbors.size()));
+    this->neighbor_counts.push_back(0);
+    this->neighbor_capacity.push_back(0);
+    return static_cast<int>(this->vertex_count++);
+}
+
+void graph_adjacency::addEdge(int first, int second) {
+    int e = static_cast<int>(this->edge_count++);
+    reserveIncidence(first, this->degrees[first] + 1 + (first == second));
+    this->incident_edges[this->incidence_offsets[first] + this->degrees[first]++] = e;
+    reserveIncidence(second, this->degrees[second] + 1);
+    this->incident_edges[this->incidence_offsets[second] + this->degrees[second]++] = e;
+
+    if (first != second) {
+        insertNeighbor(first, second);
+        insertNeighbor(second, first);
+    }
+}
+
+void graph_adjacency::moveVertex(int from, int to) {
+    //the incident edges keep their ids, only the neighbour lists name vertices
+    for (int n = 0; n < this->neighbor_counts[from]; n++) {
+        int neighbor = this->neighbors[this->neighbor_offsets[from] + n];
+        eraseNeighbor(neighbor, from);
+        insertNeighbor(neighbor, to);
+    }
+
+    std::swap(this->incidence_offsets[from], this->incidence_offsets[to]);
+    std::swap(this->degrees[from], this->degrees[to]);
+    std::swap(this->incidence_capacity[from], this->incidence_capacity[to]);
+    std::swap(this->neighbor_offsets[from], this->neighbor_offsets[to]);
+    std::swap(this->neighbor_counts[from], this->neighbor_counts[to]);
+    std::swap(this->neighbor_capacity[from], this->neighbor_capacity[to]);
+}
+
+void graph_adjacency::reserveIncidence(int vertex, int degree) {
+    if (degree <= this->incidence_capacity[vertex])
+        return;
+    //move the segment to the end, its old place stays unused until the next build()
+    int capacity = std::max(4, 2 * degree);
+    int begin = static_cast<int>(this->incident_edges.size());
+    int offset = this->incidence_offsets[vertex];
+    this->incident_edges.resize(begin + capacity);
+    std::copy_n(this->incident_edges.begin() + offset, this->degrees[vertex], this->incident_edges.begin() + begin);
+    this->incidence_offsets[vertex] = begin;
+    this->incidence_capacity[vertex] = capacity;
+}
+
+void graph_adjacency::reserveNeighbors(int vertex, int count) {
+    if (count <= this->neighbor_capacity[vertex])
+        return;
+    int capacity = std::max(4, 2 * count);
+    int begin = static_cast<int>(this->neighbors.size());
+    int offset = this->neighbor_offsets[vertex];
+    this->neighbors.resize(begin + capacity);
+    std::copy_n(this->neighbors.begin() + offset, this->neighbor_counts[vertex], this->neighbors.begin() + begin);
+    this->neighbor_offsets[vertex] = begin;
+    this->neighbor_capacity[vertex] = capacity;
+}
+
+void graph_adjacency::insertNeighbor(int vertex, int neighbor) {
+    int* first = this->neighbors.data() + this->neighbor_offsets[vertex];
+    int* last = first + this->neighbor_counts[vertex];
+    int* position = std::lower_bound(first, last, neighbor);
+    if (position != last && *position == neighbor)
+        return;
+    int index = static_cast<int>(position - first);
+    reserveNeighbors(vertex, this->neighbor_counts[vertex] + 1);
+    first = this->neighbors.data() + this->neighbor_offsets[vertex];
+    last = first + this->neighbor_counts[vertex]++;
+    std::copy_backward(first + index, last, last + 1);
+    first[index] = neighbor;
+}
+
+void graph_adjacency::eraseNeighbor(int vertex, int neighbor) {
+    int* first = this->neighbors.data() + this->neighbor_offsets[vertex];
+    int* last = first + this->neighbor_counts[vertex];
+    int* position = std::lower_bound(first, last, neighbor);
+    if (position == last || *position != neighbor)
+        return;
+    std::copy(position + 1, last, position);
+    this->neighbor_counts[vertex]--;
+}
+
+size_t graph_adjacency::getVertexCount() const {
+    return this->vertex_count;
+}
+
+size_t graph_adjacency::getEdgeCount() const {
+    return this->edge_count;
+}
+
+// Incidence
+int graph_adjacency::getDegree(int vertex) const {
+    return this->degrees[vertex];
+}
+
+const int* graph_adjacency::getIncidentEdges(int vertex) const {
+    return this->incident_edges.data() + this->incidence_offsets[vertex];
+}
+
+// Neighbours
+int graph_adjacency::getNeighborCount(int vertex) const {
+    return this->neighbor_counts[vertex];
+}
+
+const int* graph_adjacency::getNeighbors(int vertex) const {
+    return this->neighbors.data() + this->neighbor_offsets[vertex];
+}
+
+size_t graph_adjacency::getHessianBlockCount(int free_count) const {
+    size_t blocks = 0;
+    for (int v = 0; v < free_count; v++) {
+        blocks++; // diagonal block
+        const int* n = this->getNeighbors(v);
+        for (int i = 0; i < this->getNeighborCount(v); i++) {
+            if (n[i] > v && n[i] < free_count)
+                blocks++;
+        }
+    }
+    return blocks;
+}
+
+size_t graph_adjacency::getMemoryBytes() const {
+    return vectorBytes(this->incidence_offsets) + vectorBytes(this->degrees) + vectorBytes(this->incidence_capacity)
+        + vectorBytes(this->incident_edges) + vectorBytes(this->neighbor_offsets) + vectorBytes(this->neighbor_counts) + vectorBytes(this->neighbor_capacity)
+        + vectorBytes(this->neighbors);
+}
@@ -0,0 +1,156 @@
+#include "iterative_solver.h"
+
+#include <algorithm>
+#include <map>
+
+#include "parallel_for.h"
+
+cg_summary conjugateGradient(const linear_operator& multiply, const linear_operator& precondition, const Eigen::VectorXd& b, Eigen::VectorXd& x,
+    int max_iterations, double tolerance) {
+    cg_summary summary;
+    double b_norm = b.norm();
+    if (x.size() != b.size())
+        x.setZero(b.size());
+    if (b_norm == 0) {
+        x.setZero();
+        summary.converged = true;
+        return summary;
+    }
+
+    Eigen::VectorXd r = b, z, p, Ap;
+    if (x.squaredNorm() > 0) {
+        multiply(x, Ap);
+        r -= Ap;
+    }
+    summary.relative_residual = r.norm() / b_norm;
+    if (summary.relative_residual <= tolerance) {
+        summary.converged = true;
+        return summary;
+    }
+    precondition(r, z);
+    p = z;
+    double rz = r.dot(z);
+
+    while (summary.iterations < max_iterations) {
+        multiply(p, Ap);
+        double curvature = p.dot(Ap);
+        if (!(curvature > 0))
+            break;
+        double alpha = rz / curvature;
+        x += alpha * p;
+        r -= alpha * Ap;
+        summary.iterations++;
+        summary.relative_residual = r.norm() / b_norm;
+        if (summary.relative_residual <= tolerance) {
+            summary.converged = true;
+            break;
+        }
+        precondition(r, z);
+        double rz_next = r.dot(z);
+        p = z + (rz_next / rz) * p;
+        rz = rz_next;
+    }
+    return summary;
+}
+
+// block_preconditioner
+
+void block_preconditioner::setBlocks(std::vector<std::vector<int>> blocks) {
+    this->blocks = std::move(blocks);
+    this->inverses.clear();
+}
+
+const std::vector<std::vector<int>>& block_preconditioner::getBlocks() const {
+    return this->blocks;
+}
+
+void block_preconditioner::clear() {
+    this->blocks.clear();
+    this->inverses.clear();
+}
+
+bool block_preconditioner::compute(const Eigen::MatrixXd& A, int num_threads) {
+    return this->compute([&](size_t k) { return Eigen::MatrixXd(A(this->blocks[k], this->blocks[k])); }, num_threads);
+}
+
+bool block_preconditioner::compute(const std::function<Eigen::MatrixXd(size_t)>& assemble, int num_threads) {
+    std::atomic<bool> positive(true);
+    this->inverses.resize(this->blocks.size());
+    parallelFor(this->blocks.size(), num_threads, [&](size_t k) {
+        Eigen::MatrixXd block = assemble(k);
+        Eigen::LLT<Eigen::MatrixXd> llt(block);
+        if (llt.info() == Eigen::Success) {
+            this->inverses[k] = llt.solve(Eigen::MatrixXd::Identity(block.rows(), block.cols()));
+            return;
+        }
+        positive = false;
+        Eigen::VectorXd diagonal = block.diagonal().unaryExpr([](double value) { return value > 0 ? 1.0 / value : 1.0; });
+        this->inverses[k] = diagonal.asDiagonal();
+        });
+    return positive;
+}
+
+void block_preconditioner::apply(const Eigen::VectorXd& r, Eigen::VectorXd& z) const {
+    z.resize(r.size());
+    for (size_t k = 0; k < this->blocks.size(); k++) {
+        const std::vector<int>& indices = this->blocks[k];
+        z(indices) = this->inverses[k] * r(indices);
+    }
+}
+
+size_t block_preconditioner::getMemoryBytes() const {
+    size_t bytes = this->blocks.capacity() * sizeof(std::vector<int>) + this->inverses.capacity() * sizeof(Eigen::MatrixXd);
+    for (const std::vector<int>& indices : this->blocks)
+        bytes += indices.capacity() * sizeof(int);
+    for (const Eigen::MatrixXd& inverse : this->inverses)
+        bytes += inverse.size() * sizeof(double);
+    return bytes;
+}
+
+std::vector<std::vector<int>> visibilityClusters(int count, const std::vector<std::vector<int>>& observers, int cluster_size) {
+    //covisibility: number of eliminated vertices two reduced vertices share
+    std::vector<std::map<int, int>> covisible(count);
+    for (const std::vector<int>& seen_by : observers) {
+        for (size_t i = 0; i < seen_by.size(); i++) {
+            for (size_t j = i + 1; j < seen_by.size(); j++) {
+                if (seen_by[i] == seen_by[j])
+                    continue;
+                covisible[seen_by[i]][seen_by[j]]++;
+                covisible[seen_by[j]][seen_by[i]]++;
+            }
+        }
+    }
+
+    std::vector<std::vector<int>> clusters;
+    std::vector<char> assigned(count, 0);
+    for (int seed = 0; seed < count; seed++) {
+        if (assigned[seed])
+            continue;
+        std::vector<int> cluster = { seed };
+        assigned[seed] = 1;
+        std::map<int, int> candidates; // unassigned vertex -> shared with the cluster
+        auto addNeighbors = [&](int v) {
+            for (const auto& entry : covisible[v]) {
+                if (!assigned[entry.first])
+                    candidates[entry.first] += entry.second;
+            }
+            };
+        addNeighbors(seed);
+        while (static_cast<int>(cluster.size()) < cluster_size && !candidates.empty()) {
+            //ties go to the lowest index, the map is ordered
+            auto best = candidates.begin();
+            for (auto it = candidates.begin(); it != candidates.end(); ++it) {
+                if (it->second > best->second)
+                    best = it;
+            }
+            int v = best->first;
+            candidates.erase(best);
+            cluster.push_back(v);
+            assigned[v] = 1;
+            addNeighbors(v);
+        }
+        std::sort(cluster.begin(), cluster.end());
+        clusters.push_back(cluster);
+    }
+    return clusters;
+}
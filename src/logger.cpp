@@ -0,0 +1,131 @@
+#include "logger.h"
+
+#include <iostream>
+
+const char* logLevelName(LogLevel level) {
+    switch (level) {
+    case LogLevel::Trace: return "trace";
+    case LogLevel::Debug: return "debug";
+    case LogLevel::Info: return "info";
+    case LogLevel::Warning: return "warning";
+    case LogLevel::Error: return "error";
+    default: return "off";
+    }
+}
+
+// stream_sink
+
+stream_sink::stream_sink(std::ostream& stream) : stream(stream) {}
+
+void stream_sink::write(LogLevel level, const std::string& message) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (level >= LogLevel::Warning)
+        this->stream << logLevelName(level) << ": ";
+    this->stream << message << "\n";
+}
+
+void stream_sink::flush() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stream.flush();
+}
+
+// async_sink
+
+async_sink::async_sink(std::shared_ptr<log_sink> target) : target(target), stopping(false), writing(false) {
+    this->worker = std::thread(&async_sink::run, this);
+}
+
+async_sink::~async_sink() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->queue_changed.notify_all();
+    this->worker.join();
+    this->target->flush();
+}
+
+void async_sink::run() {
+    std::deque<std::pair<LogLevel, std::string>> batch;
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (true) {
+        this->queue_changed.wait(lock, [this] { return this->stopping || !this->queue.empty(); });
+        if (this->queue.empty() && this->stopping)
+            return;
+
+        //write outside the lock so producers only ever wait for a push
+        batch.swap(this->queue);
+        this->writing = true;
+        lock.unlock();
+        for (const auto& line : batch)
+            this->target->write(line.first, line.second);
+        batch.clear();
+        lock.lock();
+        this->writing = false;
+        this->queue_changed.notify_all();
+    }
+}
+
+void async_sink::write(LogLevel level, const std::string& message) {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->queue.emplace_back(level, message);
+    }
+    this->queue_changed.notify_all();
+}
+
+void async_sink::flush() {
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->queue_changed.wait(lock, [this] { return this->queue.empty() && !this->writing; });
+    }
+    this->target->flush();
+}
+
+// logger
+
+logger::logger() : level(static_cast<int>(LogLevel::Warning)), sink(std::make_shared<stream_sink>(std::cout)) {}
+
+logger& logger::instance() {
+    static logger global_logger;
+    return global_logger;
+}
+
+void logger::setLevel(LogLevel level) {
+    this->level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+LogLevel logger::getLevel() const {
+    return static_cast<LogLevel>(this->level.load(std::memory_order_relaxed));
+}
+
+void logger::setSink(std::shared_ptr<log_sink> sink) {
+    std::shared_ptr<log_sink> previous;
+    {
+        std::lock_guard<std::mutex> lock(this->sink_mutex);
+        previous = this->sink;
+        this->sink = sink;
+    }
+    if (previous)
+        previous->flush();
+}
+
+void logger::write(LogLevel level, const std::string& message) {
+    std::shared_ptr<log_sink> current;
+    {
+        std::lock_guard<std::mutex> lock(this->sink_mutex);
+        current = this->sink;
+    }
+    if (current)
+        current->write(level, message);
+}
+
+void logger::flush() {
+    std::shared_ptr<log_sink> current;
+    {
+        std::lock_guard<std::mutex> lock(this->sink_mutex);
+        current = this->sink;
+    }
+    if (current)
+        current->flush();
+}
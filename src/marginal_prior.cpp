@@ -0,0 +1,111 @@
+#include "marginal_prior.h"
+#include "memory_usage.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "general_vertex.h"
+
+marginal_prior::marginal_prior() {}
+
+void marginal_prior::build(const std::vector<general_vertex*>& vertices, const Eigen::MatrixXd& H, const Eigen::VectorXd& b) {
+    this->vertices = vertices;
+    this->offsets.clear();
+    this->linearization_point.resize(H.rows());
+
+    int offset = 0;
+    for (general_vertex* vertex_ptr : vertices) {
+        Eigen::VectorXd parameters = vertex_ptr->getParameters();
+        this->offsets.push_back(offset);
+        this->linearization_point.segment(offset, parameters.size()) = parameters;
+        offset += static_cast<int>(parameters.size());
+    }
+
+    //H = U S U^T -> J = S^(1/2) U^T and r0 = -S^(-1/2) U^T b, directions without information are dropped
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigen_solver(0.5 * (H + H.transpose()));
+    const Eigen::VectorXd& s = eigen_solver.eigenvalues();
+    const Eigen::MatrixXd& U = eigen_solver.eigenvectors();
+    double eps = 1e-12 * std::max(s.maxCoeff(), 0.0);
+
+    int rank = 0;
+    for (int i = 0; i < s.size(); i++) {
+        if (s[i] > eps)
+            rank++;
+    }
+    this->jacobian.resize(rank, H.cols());
+    this->residual0.resize(rank);
+
+    int row = 0;
+    for (int i = 0; i < s.size(); i++) {
+        if (s[i] <= eps)
+            continue;
+        double root = std::sqrt(s[i]);
+        this->jacobian.row(row) = root * U.col(i).transpose();
+        this->residual0[row] = -U.col(i).dot(b) / root;
+        row++;
+    }
+}
+
+void marginal_prior::assign(const std::vector<general_vertex*>& vertices, const Eigen::VectorXd& linearization_point, const Eigen::MatrixXd& jacobian,
+    const Eigen::VectorXd& residual0) {
+    this->vertices = vertices;
+    this->offsets.clear();
+    int offset = 0;
+    for (general_vertex* vertex_ptr : vertices) {
+        this->offsets.push_back(offset);
+        offset += static_cast<int>(vertex_ptr->getParameters().size());
+    }
+    this->linearization_point = linearization_point;
+    this->jacobian = jacobian;
+    this->residual0 = residual0;
+}
+
+void marginal_prior::clear() {
+    this->vertices.clear();
+    this->offsets.clear();
+    this->linearization_point = Eigen::VectorXd();
+    this->jacobian = Eigen::MatrixXd();
+    this->residual0 = Eigen::VectorXd();
+}
+
+bool marginal_prior::isEmpty() const {
+    return this->jacobian.rows() == 0;
+}
+
+int marginal_prior::getRows() const {
+    return static_cast<int>(this->jacobian.rows());
+}
+
+const std::vector<general_vertex*>& marginal_prior::getVertices() const {
+    return this->vertices;
+}
+
+int marginal_prior::getVertexOffset(int i) const {
+    return this->offsets[i];
+}
+
+const Eigen::MatrixXd& marginal_prior::getJacobian() const {
+    return this->jacobian;
+}
+
+const Eigen::VectorXd& marginal_prior::getLinearizationPoint() const {
+    return this->linearization_point;
+}
+
+const Eigen::VectorXd& marginal_prior::getResidual0() const {
+    return this->residual0;
+}
+
+void marginal_prior::computeResidual(Eigen::VectorXd& residual) const {
+    Eigen::VectorXd dx(this->linearization_point.size());
+    for (size_t i = 0; i < this->vertices.size(); i++) {
+        Eigen::VectorXd parameters = this->vertices[i]->getParameters();
+        dx.segment(this->offsets[i], parameters.size()) = parameters - this->linearization_point.segment(this->offsets[i], parameters.size());
+    }
+    residual = this->residual0 + this->jacobian * dx;
+}
+
+size_t marginal_prior::getMemoryBytes() const {
+    return vectorBytes(this->vertices) + vectorBytes(this->offsets) + matrixBytes(this->linearization_point)
+        + matrixBytes(this->jacobian) + matrixBytes(this->residual0);
+}
@@ -0,0 +1,28 @@
+#include "memory_usage.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <utility>
+
+size_t memory_usage::total() const {
+    return parameters + edges + graph + jacobian + covariance + hessian + factorization + workspace;
+}
+
+void memory_usage::print(std::ostream& stream) const {
+    std::vector<std::pair<const char*, size_t>> fields = {
+        { "parameters", parameters }, { "edges", edges }, { "graph", graph }, { "jacobian", jacobian },
+        { "covariance", covariance }, { "hessian", hessian }, { "factorization", factorization }, { "workspace", workspace } };
+    std::stable_sort(fields.begin(), fields.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+
+    std::ios_base::fmtflags flags = stream.flags();
+    std::streamsize precision = stream.precision();
+    double mb = 1.0 / (1024 * 1024);
+
+    stream << std::fixed << std::setprecision(3);
+    stream << "Memory [MB]  total " << mb * this->total() << "\n";
+    for (const auto& field : fields)
+        stream << "  " << std::left << std::setw(14) << field.first << std::right << std::setw(12) << mb * field.second << "\n";
+
+    stream.flags(flags);
+    stream.precision(precision);
+}
@@ -0,0 +1,384 @@
+#include "problem_snapshot.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const char snapshot_magic[8] = { 'B', 'A', 'S', 'N', 'A', 'P', '\0', '\0' };
+
+    uint64_t align8(uint64_t offset) {
+        return (offset + 7) & ~static_cast<uint64_t>(7);
+    }
+
+    //section of count elements at offset lies inside the file, written without overflowing offset + count * element_size
+    bool sectionFits(uint64_t offset, uint64_t count, uint64_t element_size, uint64_t file_size) {
+        if (offset % 8 != 0 || offset > file_size)
+            return false;
+        return count <= (file_size - offset) / element_size;
+    }
+}
+
+struct problem_snapshot::snapshot_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t edge_size;
+    uint32_t vertex_type_count;
+    uint32_t reserved;
+    uint64_t vertex_count;
+    uint64_t edge_count;
+    uint64_t parameter_count;
+
+    //byte offsets of the sections from the start of the file
+    uint64_t vertex_sizes_offset;
+    uint64_t vertex_counts_offset;
+    uint64_t vertex_ids_offset;
+    uint64_t vertex_fixed_offset;
+    uint64_t parameters_offset;
+    uint64_t edge_ids_offset;
+    uint64_t edge_vertices_offset;
+    uint64_t measurements_offset;
+    uint64_t sigmas_offset;
+
+    uint64_t prior_vertex_count;
+    uint64_t prior_rows;
+    uint64_t prior_columns;
+    uint64_t prior_vertices_offset;
+    uint64_t prior_linearization_offset;
+    uint64_t prior_jacobian_offset;
+    uint64_t prior_residual_offset;
+    uint64_t file_size;
+};
+
+problem_snapshot::problem_snapshot() : data(nullptr), size(0), header(nullptr) {
+#ifdef _WIN32
+    this->file_handle = INVALID_HANDLE_VALUE;
+    this->mapping_handle = nullptr;
+#else
+    this->file_descriptor = -1;
+#endif
+}
+
+problem_snapshot::problem_snapshot(const std::string& path) : problem_snapshot() {
+    this->open(path);
+}
+
+problem_snapshot::~problem_snapshot() {
+    this->close();
+}
+
+void problem_snapshot::write(const std::string& path, const contents& data) {
+    size_t vertex_type_count = data.vertex_sizes.size();
+    size_t vertex_count = data.vertex_ids.size();
+    size_t edge_count = data.edge_ids.size();
+
+    if (data.vertex_counts.size() != vertex_type_count || data.vertex_fixed.size() != vertex_count
+        || data.edge_vertices.size() != 2 * edge_count || data.w_sigmas.size() != edge_count
+        || data.measurements.size() != edge_count * static_cast<size_t>(data.edge_size)
+        || data.prior_jacobian.size() != data.prior_residual.size() * data.prior_linearization_point.size()) {
+        throw std::runtime_error("Snapshot: inconsistent contents for " + path);
+    }
+
+    snapshot_header header = {};
+    std::memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+    header.version = version;
+    header.edge_size = static_cast<uint32_t>(data.edge_size);
+    header.vertex_type_count = static_cast<uint32_t>(vertex_type_count);
+    header.vertex_count = vertex_count;
+    header.edge_count = edge_count;
+    header.parameter_count = data.parameters.size();
+    header.prior_vertex_count = data.prior_vertices.size();
+    header.prior_rows = data.prior_residual.size();
+    header.prior_columns = data.prior_linearization_point.size();
+
+    uint64_t offset = align8(sizeof(snapshot_header));
+    auto place = [&offset](uint64_t& section_offset, uint64_t bytes) {
+        section_offset = offset;
+        offset = align8(offset + bytes);
+        };
+    place(header.vertex_sizes_offset, vertex_type_count * sizeof(int32_t));
+    place(header.vertex_counts_offset, vertex_type_count * sizeof(uint64_t));
+    place(header.vertex_ids_offset, vertex_count * sizeof(int32_t));
+    place(header.vertex_fixed_offset, vertex_count * sizeof(uint8_t));
+    place(header.parameters_offset, data.parameters.size() * sizeof(double));
+    place(header.edge_ids_offset, edge_count * sizeof(int32_t));
+    place(header.edge_vertices_offset, 2 * edge_count * sizeof(int32_t));
+    place(header.measurements_offset, data.measurements.size() * sizeof(double));
+    place(header.sigmas_offset, edge_count * sizeof(double));
+    place(header.prior_vertices_offset, header.prior_vertex_count * sizeof(int32_t));
+    place(header.prior_linearization_offset, header.prior_columns * sizeof(double));
+    place(header.prior_jacobian_offset, data.prior_jacobian.size() * sizeof(double));
+    place(header.prior_residual_offset, header.prior_rows * sizeof(double));
+    header.file_size = offset;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Snapshot: cannot open " + path + " for writing");
+    }
+
+    uint64_t written = 0;
+    const char zeros[8] = {};
+    auto emit = [&](uint64_t section_offset, const void* bytes, uint64_t count) {
+        file.write(zeros, static_cast<std::streamsize>(section_offset - written));
+        file.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(count));
+        written = section_offset + count;
+        };
+    emit(0, &header, sizeof(header));
+    emit(header.vertex_sizes_offset, data.vertex_sizes.data(), vertex_type_count * sizeof(int32_t));
+    emit(header.vertex_counts_offset, data.vertex_counts.data(), vertex_type_count * sizeof(uint64_t));
+    emit(header.vertex_ids_offset, data.vertex_ids.data(), vertex_count * sizeof(int32_t));
+    emit(header.vertex_fixed_offset, data.vertex_fixed.data(), vertex_count * sizeof(uint8_t));
+    emit(header.parameters_offset, data.parameters.data(), data.parameters.size() * sizeof(double));
+    emit(header.edge_ids_offset, data.edge_ids.data(), edge_count * sizeof(int32_t));
+    emit(header.edge_vertices_offset, data.edge_vertices.data(), 2 * edge_count * sizeof(int32_t));
+    emit(header.measurements_offset, data.measurements.data(), data.measurements.size() * sizeof(double));
+    emit(header.sigmas_offset, data.w_sigmas.data(), edge_count * sizeof(double));
+    emit(header.prior_vertices_offset, data.prior_vertices.data(), header.prior_vertex_count * sizeof(int32_t));
+    emit(header.prior_linearization_offset, data.prior_linearization_point.data(), header.prior_columns * sizeof(double));
+    emit(header.prior_jacobian_offset, data.prior_jacobian.data(), data.prior_jacobian.size() * sizeof(double));
+    emit(header.prior_residual_offset, data.prior_residual.data(), header.prior_rows * sizeof(double));
+    emit(header.file_size, nullptr, 0);
+
+    if (!file) {
+        throw std::runtime_error("Snapshot: failed writing " + path);
+    }
+}
+
+void problem_snapshot::open(const std::string& path) {
+    this->close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Snapshot: cannot open " + path);
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        throw std::runtime_error("Snapshot: cannot stat " + path);
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (view == nullptr) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error("Snapshot: cannot map " + path);
+    }
+    this->file_handle = file;
+    this->mapping_handle = mapping;
+    this->size = static_cast<size_t>(file_size.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Snapshot: cannot open " + path);
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+        ::close(fd);
+        throw std::runtime_error("Snapshot: cannot stat " + path);
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("Snapshot: cannot map " + path);
+    }
+    this->file_descriptor = fd;
+    this->size = static_cast<size_t>(file_stat.st_size);
+#endif
+    this->data = static_cast<const unsigned char*>(view);
+
+    //validate before handing out any view
+    const snapshot_header* h = reinterpret_cast<const snapshot_header*>(this->data);
+    if (this->size < sizeof(snapshot_header) || std::memcmp(h->magic, snapshot_magic, sizeof(snapshot_magic)) != 0) {
+        this->close();
+        throw std::runtime_error("Snapshot: " + path + " is not a problem snapshot");
+    }
+    if (h->version != version) {
+        uint32_t file_version = h->version;
+        this->close();
+        throw std::runtime_error("Snapshot: " + path + " has version " + std::to_string(file_version) + ", expected " + std::to_string(version));
+    }
+    uint64_t file_size = this->size;
+    if (h->file_size != file_size || h->edge_size == 0
+        || !sectionFits(h->vertex_sizes_offset, h->vertex_type_count, sizeof(int32_t), file_size)
+        || !sectionFits(h->vertex_counts_offset, h->vertex_type_count, sizeof(uint64_t), file_size)
+        || !sectionFits(h->vertex_ids_offset, h->vertex_count, sizeof(int32_t), file_size)
+        || !sectionFits(h->vertex_fixed_offset, h->vertex_count, sizeof(uint8_t), file_size)
+        || !sectionFits(h->parameters_offset, h->parameter_count, sizeof(double), file_size)
+        || !sectionFits(h->edge_ids_offset, h->edge_count, sizeof(int32_t), file_size)
+        || !sectionFits(h->edge_vertices_offset, h->edge_count, 2 * sizeof(int32_t), file_size)
+        || !sectionFits(h->measurements_offset, h->edge_count, h->edge_size * sizeof(double), file_size)
+        || !sectionFits(h->sigmas_offset, h->edge_count, sizeof(double), file_size)
+        || !sectionFits(h->prior_vertices_offset, h->prior_vertex_count, sizeof(int32_t), file_size)
+        || !sectionFits(h->prior_linearization_offset, h->prior_columns, sizeof(double), file_size)
+        || (h->prior_columns > 0 && !sectionFits(h->prior_jacobian_offset, h->prior_rows, h->prior_columns * sizeof(double), file_size))
+        || !sectionFits(h->prior_residual_offset, h->prior_rows, sizeof(double), file_size)) {
+        this->close();
+        throw std::runtime_error("Snapshot: " + path + " is truncated");
+    }
+    this->header = h;
+
+    //the counts are bounded by the file size above, so the sums below cannot overflow
+    const int32_t* sizes = this->section<int32_t>(h->vertex_sizes_offset);
+    const uint64_t* counts = this->section<uint64_t>(h->vertex_counts_offset);
+    uint64_t parameter_offset = 0, vertex_offset = 0;
+    bool consistent = true;
+    for (uint32_t t = 0; t < h->vertex_type_count; t++) {
+        this->parameter_offsets.push_back(parameter_offset);
+        this->vertex_offsets.push_back(vertex_offset);
+        if (sizes[t] <= 0 || counts[t] > h->vertex_count - vertex_offset
+            || counts[t] > (h->parameter_count - parameter_offset) / static_cast<uint64_t>(sizes[t])) {
+            consistent = false;
+            break;
+        }
+        parameter_offset += counts[t] * static_cast<uint64_t>(sizes[t]);
+        vertex_offset += counts[t];
+    }
+    if (!consistent || parameter_offset != h->parameter_count || vertex_offset != h->vertex_count) {
+        this->close();
+        throw std::runtime_error("Snapshot: " + path + " has inconsistent vertex tables");
+    }
+
+    const int32_t* edge_vertices = this->section<int32_t>(h->edge_vertices_offset);
+    for (uint64_t i = 0; i < 2 * h->edge_count; i++) {
+        if (edge_vertices[i] < 0 || static_cast<uint64_t>(edge_vertices[i]) >= h->vertex_count) {
+            this->close();
+            throw std::runtime_error("Snapshot: " + path + " has an edge with vertex index out of range");
+        }
+    }
+
+    //the prior spans exactly the parameters of its vertices
+    const int32_t* prior_vertices = this->section<int32_t>(h->prior_vertices_offset);
+    uint64_t prior_columns = 0;
+    for (uint64_t i = 0; i < h->prior_vertex_count && consistent; i++) {
+        if (prior_vertices[i] < 0 || static_cast<uint64_t>(prior_vertices[i]) >= h->vertex_count) {
+            consistent = false;
+            break;
+        }
+        uint32_t t = 0;
+        while (t + 1 < h->vertex_type_count && static_cast<uint64_t>(prior_vertices[i]) >= this->vertex_offsets[t + 1])
+            t++;
+        prior_columns += static_cast<uint64_t>(sizes[t]);
+    }
+    if (!consistent || prior_columns != h->prior_columns || (h->prior_rows > 0) != (h->prior_vertex_count > 0)) {
+        this->close();
+        throw std::runtime_error("Snapshot: " + path + " has an inconsistent marginal prior");
+    }
+}
+
+void problem_snapshot::close() {
+    if (this->data != nullptr) {
+#ifdef _WIN32
+        UnmapViewOfFile(this->data);
+        CloseHandle(this->mapping_handle);
+        CloseHandle(this->file_handle);
+        this->file_handle = INVALID_HANDLE_VALUE;
+        this->mapping_handle = nullptr;
+#else
+        munmap(const_cast<unsigned char*>(this->data), this->size);
+        ::close(this->file_descriptor);
+        this->file_descriptor = -1;
+#endif
+    }
+    this->data = nullptr;
+    this->size = 0;
+    this->header = nullptr;
+    this->parameter_offsets.clear();
+    this->vertex_offsets.clear();
+}
+
+bool problem_snapshot::isOpen() const {
+    return this->header != nullptr;
+}
+
+template <typename T>
+const T* problem_snapshot::section(uint64_t offset) const {
+    return reinterpret_cast<const T*>(this->data + offset);
+}
+
+// Sizes
+int problem_snapshot::getEdgeSize() const {
+    return static_cast<int>(this->header->edge_size);
+}
+
+int problem_snapshot::getVertexTypeCount() const {
+    return static_cast<int>(this->header->vertex_type_count);
+}
+
+int problem_snapshot::getVertexSize(int vertex_type) const {
+    return this->section<int32_t>(this->header->vertex_sizes_offset)[vertex_type];
+}
+
+size_t problem_snapshot::getVertexCount() const {
+    return this->header->vertex_count;
+}
+
+size_t problem_snapshot::getVertexCount(int vertex_type) const {
+    return this->section<uint64_t>(this->header->vertex_counts_offset)[vertex_type];
+}
+
+size_t problem_snapshot::getVertexOffset(int vertex_type) const {
+    return this->vertex_offsets[vertex_type];
+}
+
+size_t problem_snapshot::getEdgeCount() const {
+    return this->header->edge_count;
+}
+
+// Views
+Eigen::Map<const Eigen::Matrix<int32_t, Eigen::Dynamic, 1>> problem_snapshot::getVertexIds() const {
+    return { this->section<int32_t>(this->header->vertex_ids_offset), static_cast<Eigen::Index>(this->header->vertex_count) };
+}
+
+const uint8_t* problem_snapshot::getVertexFixed() const {
+    return this->section<uint8_t>(this->header->vertex_fixed_offset);
+}
+
+Eigen::Map<const problem_snapshot::RowMatrixXd> problem_snapshot::getParameters(int vertex_type) const {
+    const double* block = this->section<double>(this->header->parameters_offset) + this->parameter_offsets[vertex_type];
+    return { block, static_cast<Eigen::Index>(this->getVertexCount(vertex_type)), this->getVertexSize(vertex_type) };
+}
+
+Eigen::Map<const Eigen::Matrix<int32_t, Eigen::Dynamic, 1>> problem_snapshot::getEdgeIds() const {
+    return { this->section<int32_t>(this->header->edge_ids_offset), static_cast<Eigen::Index>(this->header->edge_count) };
+}
+
+Eigen::Map<const problem_snapshot::EdgeVertexMatrix> problem_snapshot::getEdgeVertices() const {
+    return { this->section<int32_t>(this->header->edge_vertices_offset), static_cast<Eigen::Index>(this->header->edge_count), 2 };
+}
+
+Eigen::Map<const problem_snapshot::RowMatrixXd> problem_snapshot::getMeasurements() const {
+    return { this->section<double>(this->header->measurements_offset), static_cast<Eigen::Index>(this->header->edge_count), this->getEdgeSize() };
+}
+
+Eigen::Map<const Eigen::VectorXd> problem_snapshot::getSigmas() const {
+    return { this->section<double>(this->header->sigmas_offset), static_cast<Eigen::Index>(this->header->edge_count) };
+}
+
+Eigen::Map<const Eigen::Matrix<int32_t, Eigen::Dynamic, 1>> problem_snapshot::getPriorVertices() const {
+    return { this->section<int32_t>(this->header->prior_vertices_offset), static_cast<Eigen::Index>(this->header->prior_vertex_count) };
+}
+
+Eigen::Map<const Eigen::VectorXd> problem_snapshot::getPriorLinearizationPoint() const {
+    return { this->section<double>(this->header->prior_linearization_offset), static_cast<Eigen::Index>(this->header->prior_columns) };
+}
+
+Eigen::Map<const problem_snapshot::RowMatrixXd> problem_snapshot::getPriorJacobian() const {
+    return { this->section<double>(this->header->prior_jacobian_offset), static_cast<Eigen::Index>(this->header->prior_rows), static_cast<Eigen::Index>(this->header->prior_columns) };
+}
+
+Eigen::Map<const Eigen::VectorXd> problem_snapshot::getPriorResidual() const {
+    return { this->section<double>(this->header->prior_residual_offset), static_cast<Eigen::Index>(this->header->prior_rows) };
+}
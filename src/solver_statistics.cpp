@@ -0,0 +1,74 @@
+#include "solver_statistics.h"
+
+#include <iomanip>
+
+double iteration_statistics::totalTime() const {
+    return residual_time + jacobian_time + assembly_time + factorization_time + solve_time + step_time;
+}
+
+void solver_summary::clear() {
+    *this = solver_summary();
+}
+
+int solver_summary::acceptedSteps() const {
+    int accepted = 0;
+    for (const iteration_statistics& stats : this->iterations) {
+        if (stats.accepted)
+            accepted++;
+    }
+    return accepted;
+}
+
+iteration_statistics solver_summary::totals() const {
+    iteration_statistics total;
+    for (const iteration_statistics& stats : this->iterations) {
+        total.residual_time += stats.residual_time;
+        total.jacobian_time += stats.jacobian_time;
+        total.assembly_time += stats.assembly_time;
+        total.factorization_time += stats.factorization_time;
+        total.solve_time += stats.solve_time;
+        total.step_time += stats.step_time;
+        total.linear_iterations += stats.linear_iterations;
+    }
+    total.iteration = this->iterations.empty() ? 0 : this->iterations.back().iteration;
+    total.cost = this->final_cost;
+    return total;
+}
+
+void solver_summary::print(std::ostream& stream, bool per_iteration) const {
+    iteration_statistics total = this->totals();
+    int accepted = this->acceptedSteps();
+    double ms = 1e3;
+
+    std::ios_base::fmtflags flags = stream.flags();
+    std::streamsize precision = stream.precision();
+
+    stream << "Solver summary: " << this->termination << "\n";
+    stream << "  steps: " << this->iterations.size() << " (" << accepted << " accepted, " << this->iterations.size() - accepted << " rejected)"
+        << " | cost: " << this->initial_cost << " -> " << this->final_cost << "\n";
+    stream << "  vertex jacobians differentiated: " << this->jacobian_relinearizations << " of " << this->jacobian_evaluations
+        << " | model evaluations: " << this->model_evaluations;
+    if (total.linear_iterations > 0)
+        stream << " | conjugate gradient iterations: " << total.linear_iterations;
+    stream << "\n";
+
+    stream << std::fixed << std::setprecision(3);
+    stream << "  time [ms]  total " << ms * this->total_time << " | setup " << ms * this->setup_time
+        << " | residual " << ms * total.residual_time << " | jacobian " << ms * total.jacobian_time
+        << " | assembly " << ms * total.assembly_time << " | factorization " << ms * total.factorization_time
+        << " | solve " << ms * total.solve_time << " | step " << ms * total.step_time
+        << " | other " << ms * (this->total_time - this->setup_time - total.totalTime()) << "\n";
+
+    if (per_iteration) {
+        stream << "  iter  accepted        cost    gradient   step_norm          mu         rho   time[ms]\n";
+        for (const iteration_statistics& stats : this->iterations) {
+            stream << std::setw(6) << stats.iteration << std::setw(10) << (stats.accepted ? "yes" : "no") << std::scientific << std::setprecision(3)
+                << std::setw(12) << stats.cost << std::setw(12) << stats.gradient_max << std::setw(12) << stats.step_norm
+                << std::setw(12) << stats.mu << std::setw(12) << stats.rho
+                << std::fixed << std::setw(11) << ms * stats.totalTime() << "\n";
+        }
+    }
+
+    stream.flags(flags);
+    stream.precision(precision);
+}
@@ -0,0 +1,192 @@
+#include "vertex_ordering.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include <Eigen/Sparse>
+#include <Eigen/OrderingMethods>
+
+namespace {
+
+    //symmetric pattern of the free vertex graph with the diagonal
+    Eigen::SparseMatrix<double, Eigen::ColMajor, int> vertexPattern(const graph_adjacency& adjacency, int free_count) {
+        std::vector<Eigen::Triplet<double, int>> entries;
+        for (int v = 0; v < free_count; v++) {
+            entries.emplace_back(v, v, 1.0);
+            const int* n = adjacency.getNeighbors(v);
+            for (int i = 0; i < adjacency.getNeighborCount(v); i++) {
+                if (n[i] < free_count)
+                    entries.emplace_back(n[i], v, 1.0);
+            }
+        }
+        Eigen::SparseMatrix<double, Eigen::ColMajor, int> pattern(free_count, free_count);
+        pattern.setFromTriplets(entries.begin(), entries.end());
+        return pattern;
+    }
+
+    std::vector<int> amdOrdering(const graph_adjacency& adjacency, int free_count) {
+        Eigen::SparseMatrix<double, Eigen::ColMajor, int> pattern = vertexPattern(adjacency, free_count);
+        Eigen::AMDOrdering<int>::PermutationType perm;
+        Eigen::AMDOrdering<int>()(pattern.selfadjointView<Eigen::Lower>(), perm);
+        //amd returns the elimination sequence
+        return std::vector<int>(perm.indices().data(), perm.indices().data() + free_count);
+    }
+
+    std::vector<int> colamdOrdering(const graph_adjacency& adjacency, int free_count) {
+        //block jacobian pattern: one row per edge, one column per free vertex
+        std::vector<Eigen::Triplet<double, int>> entries;
+        for (int v = 0; v < free_count; v++) {
+            const int* edges = adjacency.getIncidentEdges(v);
+            for (int i = 0; i < adjacency.getDegree(v); i++)
+                entries.emplace_back(edges[i], v, 1.0);
+        }
+        Eigen::SparseMatrix<double, Eigen::ColMajor, int> jacobian(static_cast<int>(adjacency.getEdgeCount()), free_count);
+        jacobian.setFromTriplets(entries.begin(), entries.end());
+        jacobian.makeCompressed();
+
+        Eigen::COLAMDOrdering<int>::PermutationType perm;
+        Eigen::COLAMDOrdering<int>()(jacobian, perm);
+        //colamd returns the new position of every column
+        std::vector<int> order(free_count);
+        for (int v = 0; v < free_count; v++)
+            order[perm.indices()[v]] = v;
+        return order;
+    }
+
+    // nested dissection on vertex subsets marked by label[v] == subset_label
+    class nested_dissection {
+    public:
+        nested_dissection(const graph_adjacency& adjacency, int free_count)
+            : adjacency(adjacency), free_count(free_count), label(free_count, 0), level(free_count, -1), next_label(1) {
+            order.reserve(free_count);
+        }
+
+        std::vector<int> run() {
+            std::vector<int> all(free_count);
+            std::iota(all.begin(), all.end(), 0);
+            dissect(all, 0);
+            return order;
+        }
+
+    private:
+        static constexpr size_t leaf_size = 64;
+
+        const graph_adjacency& adjacency;
+        int free_count;
+        std::vector<int> label;
+        std::vector<int> level;
+        std::vector<int> order;
+        int next_label;
+
+        //breadth first search inside the subset, fills level[] for the reached vertices and returns them in visiting order
+        std::vector<int> bfs(int root, int subset_label) {
+            std::vector<int> visited = { root };
+            level[root] = 0;
+            for (size_t head = 0; head < visited.size(); head++) {
+                int v = visited[head];
+                const int* n = adjacency.getNeighbors(v);
+                for (int i = 0; i < adjacency.getNeighborCount(v); i++) {
+                    int u = n[i];
+                    if (u < free_count && label[u] == subset_label && level[u] < 0) {
+                        level[u] = level[v] + 1;
+                        visited.push_back(u);
+                    }
+                }
+            }
+            return visited;
+        }
+
+        void resetLevels(const std::vector<int>& vertices) {
+            for (int v : vertices)
+                level[v] = -1;
+        }
+
+        void dissect(const std::vector<int>& subset, int subset_label) {
+            if (subset.size() <= leaf_size) {
+                order.insert(order.end(), subset.begin(), subset.end());
+                return;
+            }
+
+            //split disconnected pieces first
+            std::vector<int> component = bfs(subset[0], subset_label);
+            if (component.size() < subset.size()) {
+                resetLevels(component);
+                std::vector<int> rest;
+                rest.reserve(subset.size() - component.size());
+                int component_label = next_label++;
+                for (int v : component)
+                    label[v] = component_label;
+                for (int v : subset) {
+                    if (label[v] == subset_label)
+                        rest.push_back(v);
+                }
+                dissect(component, component_label);
+                int rest_label = next_label++;
+                for (int v : rest)
+                    label[v] = rest_label;
+                dissect(rest, rest_label);
+                return;
+            }
+
+            //pseudo-peripheral root: restart from the last vertex reached
+            int root = component.back();
+            resetLevels(component);
+            std::vector<int> levels = bfs(root, subset_label);
+            int depth = level[levels.back()];
+            if (depth < 2) {
+                resetLevels(levels);
+                order.insert(order.end(), subset.begin(), subset.end());
+                return;
+            }
+
+            //separator is the level where half of the subset has been reached
+            int separator_level = level[levels[levels.size() / 2]];
+            separator_level = std::max(1, std::min(separator_level, depth - 1));
+
+            std::vector<int> near, far, separator;
+            for (int v : levels) {
+                if (level[v] < separator_level) near.push_back(v);
+                else if (level[v] > separator_level) far.push_back(v);
+                else separator.push_back(v);
+            }
+            resetLevels(levels);
+
+            int near_label = next_label++;
+            for (int v : near)
+                label[v] = near_label;
+            int far_label = next_label++;
+            for (int v : far)
+                label[v] = far_label;
+            for (int v : separator)
+                label[v] = -1;
+
+            dissect(near, near_label);
+            dissect(far, far_label);
+            order.insert(order.end(), separator.begin(), separator.end());
+        }
+    };
+}
+
+std::vector<int> computeVertexOrdering(const graph_adjacency& adjacency, int free_count, OrderingType type) {
+    if (free_count <= 0)
+        return {};
+
+    switch (type) {
+    case OrderingType::AMD:
+        return amdOrdering(adjacency, free_count);
+    case OrderingType::COLAMD:
+        return colamdOrdering(adjacency, free_count);
+    case OrderingType::NestedDissection:
+        return nested_dissection(adjacency, free_count).run();
+    case OrderingType::Natural:
+    default: {
+        std::vector<int> order(free_count);
+        std::iota(order.begin(), order.end(), 0);
+        return order;
+    }
+    }
+}
+
+void applyEliminationGroups(std::vector<int>& order, const std::vector<int>& groups) {
+    std::stable_sort(order.begin(), order.end(), [&groups](int a, int b) { return groups[a] < groups[b]; });
+}